@@ -0,0 +1,1022 @@
+// Throughput benchmarks for the parser, serializer and value operations.
+//
+//   make bench
+//   ./bench_yaml [--json] [--warmup N] [--reps N] [--min-ms N] [--size KB]
+//                [--no-perf] [--filter text] [file.yaml ...]
+//
+// Every corpus is parsed, serialized, looked up, copied and compared. Each
+// repetition repeats the operation until it has run for --min-ms; the table
+// shows the median repetition. Files given on the command line are added to
+// the built-in corpus; a "---" separated stream adds one corpus per document.
+//
+// On Linux the timed repetitions also run under perf_event_open counters,
+// adding cycles/byte, IPC and branch/cache misses per operation. When the
+// counters cannot be opened a note goes to stderr and those columns are
+// left out (JSON reports null); --no-perf skips them on purpose.
+//
+// --latency instead runs parse + lookup loops on N threads for --seconds
+// each and reports per-operation latency percentiles from a log-linear
+// histogram, for each thread count given with --threads (default: powers of
+// two up to the core count). Documents default to 16 KB in this mode.
+
+#include "yaml.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ====================================================================================
+// Allocation counting
+// ====================================================================================
+
+static std::atomic<unsigned long long> g_allocCount(0);
+static std::atomic<unsigned long long> g_allocBytes(0);
+// Cleared before the latency threads start so the shared counters do not
+// add cache-line contention of their own
+static bool g_countAllocs = true;
+
+void *operator new(size_t size)
+{
+    if (g_countAllocs)
+    {
+        g_allocCount.fetch_add(1, std::memory_order_relaxed);
+        g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+// ====================================================================================
+// Corpus
+// ====================================================================================
+
+struct Corpus
+{
+    std::string name;
+    std::string text;
+};
+
+// Many keys in one mapping
+static std::string makeWide(size_t target)
+{
+    std::string out = "root:\n";
+    char line[96];
+    for (size_t i = 0; out.size() < target; ++i)
+    {
+        std::snprintf(line, sizeof(line), "  key_%06zu: value number %zu\n", i, i);
+        out += line;
+    }
+    return out;
+}
+
+// Blocks of mappings nested 24 levels deep
+static std::string makeDeep(size_t target)
+{
+    std::string out;
+    char line[96];
+    for (size_t block = 0; out.size() < target; ++block)
+    {
+        std::snprintf(line, sizeof(line), "block_%zu:\n", block);
+        out += line;
+        for (int depth = 1; depth <= 24; ++depth)
+        {
+            out += std::string(depth * 2, ' ');
+            std::snprintf(line, sizeof(line), "level_%d:\n", depth);
+            out += line;
+        }
+        out += std::string(50, ' ') + "leaf: true\n";
+        out += std::string(2, ' ') + "sibling: 1\n";
+    }
+    return out;
+}
+
+// Long quoted and plain strings
+static std::string makeLongStrings(size_t target)
+{
+    std::string words = "lorem ipsum dolor sit amet consectetur adipiscing elit sed do ";
+    std::string plain;
+    while (plain.size() < 900)
+        plain += words;
+    plain.erase(plain.find_last_not_of(' ') + 1);
+
+    std::string out;
+    char key[64];
+    for (size_t i = 0; out.size() < target; ++i)
+    {
+        std::snprintf(key, sizeof(key), "text_%zu: ", i);
+        out += key;
+        if (i % 2)
+            out += "\"" + plain + "\\twith \\\"escapes\\\"\"\n";
+        else
+            out += plain + "\n";
+    }
+    return out;
+}
+
+// Sequences of integers and decimals
+static std::string makeNumeric(size_t target)
+{
+    std::string out;
+    char line[64];
+    unsigned seed = 12345;
+    for (size_t series = 0; out.size() < target; ++series)
+    {
+        std::snprintf(line, sizeof(line), "series_%zu:\n", series);
+        out += line;
+        for (int i = 0; i < 32; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int v = static_cast<int>(seed >> 8) % 200000 - 100000;
+            if (i % 2)
+                std::snprintf(line, sizeof(line), "  - %d\n", v);
+            else
+                std::snprintf(line, sizeof(line), "  - %d.%03d\n", v, static_cast<int>(seed % 1000));
+            out += line;
+        }
+    }
+    return out;
+}
+
+// One flow mapping with nested flow sequences per line
+static std::string makeFlow(size_t target)
+{
+    std::string out;
+    char line[160];
+    for (size_t i = 0; out.size() < target; ++i)
+    {
+        std::snprintf(line, sizeof(line),
+                      "row_%zu: {id: %zu, name: item %zu, tags: [red, green, blue], pos: [%zu.5, -%zu.25], ok: true}\n",
+                      i, i, i, i % 1000, i % 100);
+        out += line;
+    }
+    return out;
+}
+
+// Comment lines and trailing comments around small entries
+static std::string makeComments(size_t target)
+{
+    std::string out;
+    char line[128];
+    for (size_t i = 0; out.size() < target; ++i)
+    {
+        out += "# ---------------------------------------------------------------\n";
+        std::snprintf(line, sizeof(line), "# section %zu: describes the settings below in detail\n", i);
+        out += line;
+        std::snprintf(line, sizeof(line), "section_%zu:\n", i);
+        out += line;
+        out += "  enabled: true   # can be switched off at runtime\n";
+        out += "  # retries before giving up\n";
+        std::snprintf(line, sizeof(line), "  retries: %zu # per request\n", i % 7);
+        out += line;
+    }
+    return out;
+}
+
+// Service definitions shaped like a typical deployment config
+static std::string makeConfig(size_t target)
+{
+    std::string out = "version: 3\nenvironment: production\nservices:\n";
+    char line[160];
+    for (size_t i = 0; out.size() < target; ++i)
+    {
+        std::snprintf(line, sizeof(line), "  svc_%zu:\n    image: \"registry.local/team/svc-%zu:1.%zu.%zu\"\n",
+                      i, i, i % 40, i % 9);
+        out += line;
+        std::snprintf(line, sizeof(line), "    replicas: %zu\n    enabled: %s\n", 1 + i % 5, i % 3 ? "true" : "false");
+        out += line;
+        out += "    # resource limits per replica\n";
+        std::snprintf(line, sizeof(line), "    resources:\n      cpu: %zu.5\n      memory: %zuMi\n",
+                      i % 4, 128 * (1 + i % 8));
+        out += line;
+        std::snprintf(line, sizeof(line), "    ports: [%zu, %zu]\n", 8000 + i % 100, 9000 + i % 100);
+        out += line;
+        out += "    env:\n      LOG_LEVEL: info\n      TIMEOUT: 30\n";
+        std::snprintf(line, sizeof(line), "      DATABASE_URL: 'postgres://db-%zu.internal:5432/app'\n", i % 6);
+        out += line;
+        out += "    healthcheck:\n      path: /healthz\n      interval: 10\n";
+    }
+    return out;
+}
+
+static bool readFile(const std::string &path, std::string &out)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// ====================================================================================
+// Document helpers
+// ====================================================================================
+
+static size_t countNodes(const yaml::YamlValue &v)
+{
+    size_t n = 1;
+    if (v.isSequence())
+    {
+        for (const auto &item : v.asSequence())
+            n += countNodes(item);
+    }
+    else if (v.isMapping())
+    {
+        for (const auto &pair : v.asMapping())
+            n += countNodes(pair.second);
+    }
+    return n;
+}
+
+// Paths from the root to every mapping value, as key/index steps
+typedef std::vector<yaml::PathStep> KeyPath;
+
+static void collectPaths(const yaml::YamlValue &v, KeyPath &path, std::vector<KeyPath> &out)
+{
+    if (v.isMapping())
+    {
+        for (const auto &pair : v.asMapping())
+        {
+            yaml::PathStep step;
+            step.key = pair.first;
+            path.push_back(step);
+            out.push_back(path);
+            collectPaths(pair.second, path, out);
+            path.pop_back();
+        }
+    }
+    else if (v.isSequence())
+    {
+        const auto &seq = v.asSequence();
+        for (size_t i = 0; i < seq.size(); ++i)
+        {
+            yaml::PathStep step;
+            step.isIndex = true;
+            step.index = i;
+            path.push_back(step);
+            collectPaths(seq[i], path, out);
+            path.pop_back();
+        }
+    }
+}
+
+// Follows every path from root; the sum of the found types keeps it observable
+static size_t lookupAll(const yaml::YamlValue &root, const std::vector<KeyPath> &paths)
+{
+    size_t found = 0;
+    for (const auto &path : paths)
+    {
+        const yaml::YamlValue *v = &root;
+        for (const auto &step : path)
+            v = step.isIndex ? &(*v)[step.index] : &(*v)[step.key];
+        found += static_cast<size_t>(v->getType());
+    }
+    return found;
+}
+
+// ====================================================================================
+// Hardware counters
+// ====================================================================================
+
+// User-space cycles, instructions, branch misses, L1D read misses and LLC
+// misses via perf_event_open. Each event is opened on its own so that a PMU
+// lacking one of them still reports the rest; counts are scaled when the
+// kernel multiplexed an event. Elsewhere, or when perf_event_paranoid or a
+// container forbids access, available() is false and the columns print "-".
+class PerfCounters
+{
+  public:
+    enum Event
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,
+        LLC_MISSES,
+        EVENTS
+    };
+
+    PerfCounters() : open_(0)
+    {
+        for (int i = 0; i < EVENTS; ++i)
+            fds_[i] = -1;
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int i = 0; i < EVENTS; ++i)
+            if (fds_[i] >= 0)
+                close(fds_[i]);
+#endif
+    }
+
+    // Returns false and fills reason when no counter could be opened
+    bool open(std::string &reason)
+    {
+#ifdef __linux__
+        static const unsigned long long cacheL1dReadMiss =
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const unsigned types[EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+        const unsigned long long configs[EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                    PERF_COUNT_HW_BRANCH_MISSES, cacheL1dReadMiss,
+                                                    PERF_COUNT_HW_CACHE_MISSES};
+        int firstErrno = 0;
+        for (int i = 0; i < EVENTS; ++i)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[i] >= 0)
+                ++open_;
+            else if (!firstErrno)
+                firstErrno = errno;
+        }
+        if (open_)
+            return true;
+        reason = std::string("perf_event_open: ") + std::strerror(firstErrno);
+        if (firstErrno == EACCES || firstErrno == EPERM)
+            reason += " (see /proc/sys/kernel/perf_event_paranoid)";
+        else if (firstErrno == ENOENT || firstErrno == ENODEV || firstErrno == EOPNOTSUPP)
+            reason += " (no hardware PMU exposed, e.g. in a VM)";
+        return false;
+#else
+        reason = "hardware counters need Linux perf_event_open";
+        return false;
+#endif
+    }
+
+    bool available() const { return open_ > 0; }
+    bool has(Event e) const { return fds_[e] >= 0; }
+
+    void start()
+    {
+#ifdef __linux__
+        for (int i = 0; i < EVENTS; ++i)
+            if (fds_[i] >= 0)
+            {
+                ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+    }
+
+    // Stops counting and stores the (multiplex-scaled) totals in out
+    void stop(double out[EVENTS])
+    {
+        for (int i = 0; i < EVENTS; ++i)
+            out[i] = -1;
+#ifdef __linux__
+        for (int i = 0; i < EVENTS; ++i)
+            if (fds_[i] >= 0)
+                ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < EVENTS; ++i)
+        {
+            unsigned long long v[3];
+            if (fds_[i] < 0 || read(fds_[i], v, sizeof(v)) != static_cast<ssize_t>(sizeof(v)) || !v[2])
+                continue;
+            out[i] = static_cast<double>(v[0]) * (static_cast<double>(v[1]) / static_cast<double>(v[2]));
+        }
+#endif
+    }
+
+  private:
+    int fds_[EVENTS];
+    int open_;
+
+    PerfCounters(const PerfCounters &);
+    PerfCounters &operator=(const PerfCounters &);
+};
+
+// ====================================================================================
+// Measurement
+// ====================================================================================
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile size_t g_sink;
+
+struct Options
+{
+    int warmup;
+    int reps;
+    double minMs;
+    size_t sizeKb;
+    bool json;
+    bool perf;
+    bool latency;
+    std::vector<int> threads;
+    double seconds;
+    std::string filter;
+    std::vector<std::string> files;
+
+    Options() : warmup(2), reps(7), minMs(50), sizeKb(0), json(false), perf(true), latency(false), seconds(2) {}
+};
+
+struct Result
+{
+    std::string corpus;
+    std::string workload;
+    size_t bytes;       // input (or output) bytes per operation
+    size_t nodes;       // nodes touched per operation
+    size_t units;       // unit operations per operation (lookups)
+    double medianMs;    // per operation
+    double minMs;
+    double allocs;      // per operation
+    double allocBytes;
+    double counters[PerfCounters::EVENTS]; // per operation, -1 when not counted
+};
+
+// Times op(), which must return something derived from its work
+template <typename Op>
+static Result measure(const Options &opt, PerfCounters &perf, Op op)
+{
+    for (int i = 0; i < opt.warmup; ++i)
+        g_sink = g_sink + op();
+
+    // One untimed run for the allocation profile
+    unsigned long long count0 = g_allocCount.load();
+    unsigned long long bytes0 = g_allocBytes.load();
+    g_sink = g_sink + op();
+    Result r = Result();
+    r.allocs = static_cast<double>(g_allocCount.load() - count0);
+    r.allocBytes = static_cast<double>(g_allocBytes.load() - bytes0);
+
+    std::vector<double> samples;
+    size_t totalIterations = 0;
+    if (perf.available())
+        perf.start();
+    for (int rep = 0; rep < opt.reps; ++rep)
+    {
+        size_t iterations = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0;
+        do
+        {
+            g_sink = g_sink + op();
+            ++iterations;
+            elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        } while (elapsed < opt.minMs);
+        samples.push_back(elapsed / iterations);
+        totalIterations += iterations;
+    }
+    perf.stop(r.counters);
+    for (int i = 0; i < PerfCounters::EVENTS; ++i)
+        if (r.counters[i] >= 0)
+            r.counters[i] /= static_cast<double>(totalIterations);
+    std::sort(samples.begin(), samples.end());
+    r.medianMs = samples[samples.size() / 2];
+    r.minMs = samples.front();
+    return r;
+}
+
+static void runCorpus(const Options &opt, PerfCounters &perf, const Corpus &corpus,
+                      std::vector<Result> &results)
+{
+    yaml::YamlValue doc;
+    try
+    {
+        doc = yaml::parse(corpus.text);
+    }
+    catch (const yaml::YamlException &e)
+    {
+        std::fprintf(stderr, "%s: parse error at %d:%d: %s\n",
+                     corpus.name.c_str(), e.line, e.column, e.what());
+        return;
+    }
+
+    size_t nodes = countNodes(doc);
+    std::string serialized = doc.serialize();
+    bool roundTrip = false;
+    try
+    {
+        roundTrip = (yaml::parse(serialized) == doc);
+    }
+    catch (const yaml::YamlException &)
+    {
+    }
+    if (!roundTrip)
+        std::fprintf(stderr, "%s: warning: serialized output does not parse back to the same document\n",
+                     corpus.name.c_str());
+
+    KeyPath scratch;
+    std::vector<KeyPath> paths;
+    collectPaths(doc, scratch, paths);
+    size_t steps = 0;
+    for (const auto &p : paths)
+        steps += p.size();
+
+    Result r;
+
+    r = measure(opt, perf, [&]() { return yaml::parse(corpus.text).size(); });
+    r.workload = "parse";
+    r.bytes = corpus.text.size();
+    r.nodes = nodes;
+    results.push_back(r);
+
+    r = measure(opt, perf, [&]() { return doc.serialize().size(); });
+    r.workload = "serialize";
+    r.bytes = serialized.size();
+    r.nodes = nodes;
+    results.push_back(r);
+
+    if (!paths.empty())
+    {
+        const yaml::YamlValue &root = doc;
+        r = measure(opt, perf, [&]() { return lookupAll(root, paths); });
+        r.workload = "lookup";
+        r.units = steps;
+        results.push_back(r);
+    }
+
+    r = measure(opt, perf, [&]() {
+        yaml::YamlValue copy = doc;
+        return copy.size();
+    });
+    r.workload = "copy";
+    r.nodes = nodes;
+    results.push_back(r);
+
+    yaml::YamlValue other = doc;
+    r = measure(opt, perf, [&]() { return static_cast<size_t>(doc == other); });
+    r.workload = "equality";
+    r.nodes = nodes;
+    results.push_back(r);
+
+    for (size_t i = results.size(); i-- > 0 && results[i].corpus.empty();)
+        results[i].corpus = corpus.name;
+}
+
+// ====================================================================================
+// Concurrent latency
+// ====================================================================================
+
+// Log-linear latency histogram in the HDR style: values below 2^SUB_BITS ns
+// are exact, above that every power of two is split into 2^SUB_BITS buckets,
+// so any recorded value is off by less than 1% over the whole 64-bit range.
+class Histogram
+{
+  public:
+    static const int SUB_BITS = 7;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+
+    Histogram() : counts_((64 - SUB_BITS + 1) * SUB_BUCKETS, 0), total_(0), max_(0) {}
+
+    void record(unsigned long long ns)
+    {
+        counts_[indexOf(ns)]++;
+        total_++;
+        max_ = std::max(max_, ns);
+    }
+
+    void merge(const Histogram &other)
+    {
+        for (size_t i = 0; i < counts_.size(); ++i)
+            counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    unsigned long long count() const { return total_; }
+    unsigned long long max() const { return max_; }
+
+    // Highest value equivalent to the q-quantile sample (q in [0, 1])
+    unsigned long long percentile(double q) const
+    {
+        if (!total_)
+            return 0;
+        unsigned long long rank = static_cast<unsigned long long>(q * static_cast<double>(total_) + 0.5);
+        rank = std::max(1ULL, std::min(rank, total_));
+        unsigned long long seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+                return std::min(highestInBucket(i), max_);
+        }
+        return max_;
+    }
+
+  private:
+    std::vector<unsigned long long> counts_;
+    unsigned long long total_;
+    unsigned long long max_;
+
+    static size_t indexOf(unsigned long long v)
+    {
+        if (v < static_cast<unsigned long long>(SUB_BUCKETS))
+            return static_cast<size_t>(v);
+        int msb = 63;
+        while (!(v >> msb))
+            --msb;
+        int shift = msb - SUB_BITS;
+        return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>((v >> shift) - SUB_BUCKETS);
+    }
+
+    static unsigned long long highestInBucket(size_t index)
+    {
+        if (index < static_cast<size_t>(SUB_BUCKETS))
+            return index;
+        int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+        unsigned long long sub = index % SUB_BUCKETS + SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+struct LatencyDoc
+{
+    std::string name;
+    std::string text;
+    std::vector<KeyPath> paths;
+};
+
+struct LatencyResult
+{
+    int threads;
+    double seconds;
+    Histogram histogram;
+};
+
+// Each worker owns its histogram and is padded away from its neighbours,
+// so the harness itself shares nothing but the start/stop flags
+struct LatencyWorker
+{
+    char padBefore[64];
+    Histogram histogram;
+    size_t sink;
+    char padAfter[64];
+
+    LatencyWorker() : sink(0) {}
+};
+
+static void latencyLoop(const std::vector<LatencyDoc> &docs, size_t first, std::atomic<int> &ready,
+                        const std::atomic<bool> &go, const std::atomic<bool> &stop, LatencyWorker &worker)
+{
+    ready.fetch_add(1);
+    while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    size_t next = first;
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        const LatencyDoc &doc = docs[next++ % docs.size()];
+        Clock::time_point start = Clock::now();
+        {
+            yaml::YamlValue root = yaml::parse(doc.text);
+            worker.sink += lookupAll(root, doc.paths);
+        }
+        Clock::time_point end = Clock::now();
+        worker.histogram.record(static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+    }
+}
+
+// Runs parse + lookup of every key path on `threads` threads for `seconds`;
+// one operation includes destroying the parsed document
+static LatencyResult runLatency(const std::vector<LatencyDoc> &docs, int threads, double seconds)
+{
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false), stop(false);
+    std::vector<std::unique_ptr<LatencyWorker>> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(std::unique_ptr<LatencyWorker>(new LatencyWorker()));
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t)
+        pool.push_back(std::thread(latencyLoop, std::cref(docs), static_cast<size_t>(t), std::ref(ready),
+                                   std::cref(go), std::cref(stop), std::ref(*workers[t])));
+    while (ready.load() < threads)
+        std::this_thread::yield();
+
+    Clock::time_point start = Clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    for (auto &th : pool)
+        th.join();
+
+    LatencyResult r;
+    r.threads = threads;
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const auto &w : workers)
+    {
+        r.histogram.merge(w->histogram);
+        g_sink = g_sink + w->sink;
+    }
+    return r;
+}
+
+// ====================================================================================
+// Reporting
+// ====================================================================================
+
+static void formatCounter(char *buf, size_t size, double value, const char *fmt)
+{
+    if (value >= 0)
+        std::snprintf(buf, size, fmt, value);
+    else
+        std::snprintf(buf, size, "-");
+}
+
+static void printTable(const std::vector<Result> &results, bool counters)
+{
+    std::printf("%-14s %-10s %10s %10s %10s %10s %11s %11s %11s",
+                "corpus", "workload", "bytes", "median ms", "min ms",
+                "MB/s", "Mnodes/s", "ns/lookup", "allocs/op");
+    if (counters)
+        std::printf(" %8s %6s %11s %11s %11s", "cyc/B", "IPC", "brmiss/op", "L1Dmiss/op", "LLCmiss/op");
+    std::printf("\n");
+    for (const auto &r : results)
+    {
+        char mbps[32] = "-", nodes[32] = "-", lookup[32] = "-";
+        double seconds = r.medianMs / 1000.0;
+        if (r.bytes)
+            std::snprintf(mbps, sizeof(mbps), "%.1f", r.bytes / seconds / 1e6);
+        if (r.nodes)
+            std::snprintf(nodes, sizeof(nodes), "%.2f", r.nodes / seconds / 1e6);
+        if (r.units)
+            std::snprintf(lookup, sizeof(lookup), "%.1f", r.medianMs * 1e6 / r.units);
+        std::printf("%-14s %-10s %10zu %10.3f %10.3f %10s %11s %11s %11.0f",
+                    r.corpus.c_str(), r.workload.c_str(), r.bytes, r.medianMs, r.minMs,
+                    mbps, nodes, lookup, r.allocs);
+        if (counters)
+        {
+            const double *c = r.counters;
+            char cpb[32], ipc[32], br[32], l1[32], llc[32];
+            formatCounter(cpb, sizeof(cpb), r.bytes && c[PerfCounters::CYCLES] >= 0
+                                                ? c[PerfCounters::CYCLES] / r.bytes : -1, "%.2f");
+            formatCounter(ipc, sizeof(ipc), c[PerfCounters::CYCLES] > 0 && c[PerfCounters::INSTRUCTIONS] >= 0
+                                                ? c[PerfCounters::INSTRUCTIONS] / c[PerfCounters::CYCLES] : -1, "%.2f");
+            formatCounter(br, sizeof(br), c[PerfCounters::BRANCH_MISSES], "%.0f");
+            formatCounter(l1, sizeof(l1), c[PerfCounters::L1D_MISSES], "%.0f");
+            formatCounter(llc, sizeof(llc), c[PerfCounters::LLC_MISSES], "%.0f");
+            std::printf(" %8s %6s %11s %11s %11s", cpb, ipc, br, l1, llc);
+        }
+        std::printf("\n");
+    }
+}
+
+// A per-operation counter, or null when it was not counted
+static std::string jsonCounter(double value)
+{
+    if (value < 0)
+        return "null";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f", value);
+    return buf;
+}
+
+static void printJson(const std::vector<Result> &results)
+{
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        double seconds = r.medianMs / 1000.0;
+        std::printf("  {\"corpus\": \"%s\", \"workload\": \"%s\", \"bytes\": %zu, \"nodes\": %zu, "
+                    "\"median_ms\": %.6f, \"min_ms\": %.6f, \"mb_per_s\": %.3f, \"nodes_per_s\": %.0f, "
+                    "\"ns_per_lookup\": %.3f, \"allocs_per_op\": %.0f, \"alloc_bytes_per_op\": %.0f, "
+                    "\"cycles_per_op\": %s, \"instructions_per_op\": %s, \"branch_misses_per_op\": %s, "
+                    "\"l1d_misses_per_op\": %s, \"llc_misses_per_op\": %s}%s\n",
+                    r.corpus.c_str(), r.workload.c_str(), r.bytes, r.nodes,
+                    r.medianMs, r.minMs,
+                    r.bytes ? r.bytes / seconds / 1e6 : 0.0,
+                    r.nodes ? r.nodes / seconds : 0.0,
+                    r.units ? r.medianMs * 1e6 / r.units : 0.0,
+                    r.allocs, r.allocBytes,
+                    jsonCounter(r.counters[PerfCounters::CYCLES]).c_str(),
+                    jsonCounter(r.counters[PerfCounters::INSTRUCTIONS]).c_str(),
+                    jsonCounter(r.counters[PerfCounters::BRANCH_MISSES]).c_str(),
+                    jsonCounter(r.counters[PerfCounters::L1D_MISSES]).c_str(),
+                    jsonCounter(r.counters[PerfCounters::LLC_MISSES]).c_str(),
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+static void printLatencyTable(const std::vector<LatencyResult> &results)
+{
+    std::printf("%-8s %12s %12s %10s %10s %10s %10s %10s\n",
+                "threads", "ops", "ops/s", "p50 us", "p90 us", "p99 us", "p999 us", "max us");
+    for (const auto &r : results)
+    {
+        const Histogram &h = r.histogram;
+        std::printf("%-8d %12llu %12.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                    r.threads, h.count(), h.count() / r.seconds,
+                    h.percentile(0.50) / 1e3, h.percentile(0.90) / 1e3, h.percentile(0.99) / 1e3,
+                    h.percentile(0.999) / 1e3, h.max() / 1e3);
+    }
+}
+
+static void printLatencyJson(const std::vector<LatencyResult> &results)
+{
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const LatencyResult &r = results[i];
+        const Histogram &h = r.histogram;
+        std::printf("  {\"threads\": %d, \"ops\": %llu, \"ops_per_s\": %.1f, \"p50_ns\": %llu, "
+                    "\"p90_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+                    r.threads, h.count(), h.count() / r.seconds, h.percentile(0.50), h.percentile(0.90),
+                    h.percentile(0.99), h.percentile(0.999), h.max(), i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: bench_yaml [--json] [--warmup N] [--reps N] [--min-ms N] [--size KB]\n"
+                 "                  [--no-perf] [--filter text] [file.yaml ...]\n"
+                 "       bench_yaml --latency [--threads 1,2,4] [--seconds S] [--size KB] [--json]\n"
+                 "                  [--filter text] [file.yaml ...]\n");
+}
+
+static int runLatencyMode(const Options &opt, const std::vector<Corpus> &corpora)
+{
+    std::vector<LatencyDoc> docs;
+    for (const auto &corpus : corpora)
+    {
+        if (!opt.filter.empty() && corpus.name.find(opt.filter) == std::string::npos)
+            continue;
+        LatencyDoc doc;
+        doc.name = corpus.name;
+        doc.text = corpus.text;
+        try
+        {
+            yaml::YamlValue root = yaml::parse(doc.text);
+            KeyPath scratch;
+            collectPaths(root, scratch, doc.paths);
+        }
+        catch (const yaml::YamlException &e)
+        {
+            std::fprintf(stderr, "%s: parse error at %d:%d: %s\n",
+                         corpus.name.c_str(), e.line, e.column, e.what());
+            continue;
+        }
+        docs.push_back(doc);
+    }
+    if (docs.empty())
+    {
+        std::fprintf(stderr, "bench_yaml: no documents to run\n");
+        return 1;
+    }
+
+    std::vector<int> threads = opt.threads;
+    if (threads.empty())
+    {
+        int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int n = 1; n < cores; n *= 2)
+            threads.push_back(n);
+        threads.push_back(cores);
+    }
+
+    g_countAllocs = false;
+    std::vector<LatencyResult> results;
+    for (int n : threads)
+        results.push_back(runLatency(docs, n, opt.seconds));
+
+    if (opt.json)
+        printLatencyJson(results);
+    else
+    {
+        std::printf("parse + lookup of every key path, round-robin over:");
+        for (const auto &doc : docs)
+            std::printf(" %s (%zu bytes)", doc.name.c_str(), doc.text.size());
+        std::printf("\n");
+        printLatencyTable(results);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json")
+            opt.json = true;
+        else if (arg == "--warmup" && hasValue)
+            opt.warmup = std::atoi(argv[++i]);
+        else if (arg == "--reps" && hasValue)
+            opt.reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-ms" && hasValue)
+            opt.minMs = std::atof(argv[++i]);
+        else if (arg == "--size" && hasValue)
+            opt.sizeKb = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--latency")
+            opt.latency = true;
+        else if (arg == "--threads" && hasValue)
+        {
+            std::string list = argv[++i];
+            for (size_t pos = 0; pos < list.size();)
+            {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos)
+                    comma = list.size();
+                int n = std::atoi(list.substr(pos, comma - pos).c_str());
+                if (n > 0)
+                    opt.threads.push_back(n);
+                pos = comma + 1;
+            }
+        }
+        else if (arg == "--seconds" && hasValue)
+            opt.seconds = std::atof(argv[++i]);
+        else if (arg == "--no-perf")
+            opt.perf = false;
+        else if (arg == "--filter" && hasValue)
+            opt.filter = argv[++i];
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            opt.files.push_back(arg);
+    }
+
+    // Latency runs want many short operations; throughput runs large inputs
+    size_t target = (opt.sizeKb ? opt.sizeKb : (opt.latency ? 16 : 512)) * 1024;
+    std::vector<Corpus> corpora;
+    corpora.push_back(Corpus{"wide", makeWide(target)});
+    corpora.push_back(Corpus{"deep", makeDeep(target)});
+    corpora.push_back(Corpus{"long_strings", makeLongStrings(target)});
+    corpora.push_back(Corpus{"numeric", makeNumeric(target)});
+    corpora.push_back(Corpus{"flow", makeFlow(target)});
+    corpora.push_back(Corpus{"comments", makeComments(target)});
+    corpora.push_back(Corpus{"config", makeConfig(target)});
+    for (const auto &path : opt.files)
+    {
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        std::string text;
+        if (!readFile(path, text))
+        {
+            std::fprintf(stderr, "cannot read %s\n", path.c_str());
+            return 1;
+        }
+        // A "---" stream (e.g. gen_yaml --docs N) is benchmarked per document
+        std::vector<std::string> docs = yaml::splitDocuments(text);
+        if (docs.size() <= 1)
+            corpora.push_back(Corpus{name, text});
+        for (size_t i = 0; docs.size() > 1 && i < docs.size(); ++i)
+            corpora.push_back(Corpus{name + "#" + std::to_string(i + 1), docs[i]});
+    }
+
+    if (opt.latency)
+        return runLatencyMode(opt, corpora);
+
+    PerfCounters perf;
+    std::string reason;
+    if (opt.perf && !perf.open(reason))
+        std::fprintf(stderr, "bench_yaml: hardware counters unavailable: %s\n", reason.c_str());
+
+    std::vector<Result> results;
+    for (const auto &corpus : corpora)
+    {
+        if (!opt.filter.empty() && corpus.name.find(opt.filter) == std::string::npos)
+            continue;
+        runCorpus(opt, perf, corpus, results);
+    }
+
+    if (opt.json)
+        printJson(results);
+    else
+        printTable(results, perf.available());
+    return 0;
+}
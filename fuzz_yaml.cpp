@@ -0,0 +1,761 @@
+// Fuzz and complexity harness.
+//
+// libFuzzer (clang):
+//   make fuzz-libfuzzer && ./fuzz_yaml_libfuzzer corpus_dir
+//
+// Standalone driver (any compiler):
+//   make fuzz-scaling                 scale every built-in input family and
+//                                     fail if one costs super-linear time
+//   ./fuzz_yaml seed.yaml ...         also scale these files (repeated and
+//                                     nested), minimizing any that are flagged
+//   ./fuzz_yaml --save DIR            write flagged cases to DIR as inputs for
+//                                     bench_yaml
+//   ./fuzz_yaml --mutate N [files]    run N mutated inputs through the fuzz target
+//   ./fuzz_yaml --run files...        run files through the fuzz target
+//
+// Cost is wall time per byte: parse time per input byte, serialize time per
+// output byte. A family is flagged when the log-log slope of time against
+// bytes exceeds --threshold (default 1.25; linear is 1.0).
+
+#include "yaml.hpp"
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+// ====================================================================================
+// Fuzz target
+// ====================================================================================
+
+// Input being processed, for the crash handler
+static const std::string *g_current = nullptr;
+
+static void fail(const char *what, const std::string &input)
+{
+    std::fprintf(stderr, "fuzz_yaml: %s (input %zu bytes)\n", what, input.size());
+    std::abort();
+}
+
+// Anything that parses must serialize to text that parses back equal.
+// Returns whether the input parsed.
+static bool fuzzOne(const std::string &text)
+{
+    g_current = &text;
+    yaml::YamlValue doc;
+    try
+    {
+        doc = yaml::parse(text);
+    }
+    catch (const yaml::YamlException &)
+    {
+        g_current = nullptr;
+        return false;
+    }
+
+    std::string out = doc.serialize();
+    try
+    {
+        if (!(yaml::parse(out) == doc))
+            fail("serialized output parses to a different document", text);
+    }
+    catch (const yaml::YamlException &e)
+    {
+        std::fprintf(stderr, "fuzz_yaml: reparse error at %d:%d: %s\n", e.line, e.column, e.what());
+        fail("serialized output does not parse", text);
+    }
+    g_current = nullptr;
+    return true;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    fuzzOne(std::string(reinterpret_cast<const char *>(data), size));
+    return 0;
+}
+
+#ifndef YAML_LIBFUZZER
+
+// ====================================================================================
+// Input families
+// ====================================================================================
+
+// Each builds an input whose size grows with n
+struct Family
+{
+    const char *name;
+    std::string (*build)(size_t n);
+    size_t startN;
+    size_t maxN; // keeps recursive families inside the stack
+};
+
+static std::string deepBlockMapping(size_t n)
+{
+    std::string s;
+    for (size_t i = 0; i < n; ++i)
+        s += std::string(i, ' ') + "k:\n";
+    s += std::string(n, ' ') + "leaf: 1\nafter: 2\n"; // dedents every level at once
+    return s;
+}
+
+static std::string deepBlockSequence(size_t n)
+{
+    std::string s;
+    for (size_t i = 0; i < n; ++i)
+        s += std::string(2 * i, ' ') + "-\n";
+    s += std::string(2 * n, ' ') + "- x\n";
+    return s;
+}
+
+static std::string deepFlowMapping(size_t n)
+{
+    std::string s = "root: ";
+    for (size_t i = 0; i < n; ++i)
+        s += "{a: ";
+    s += "1";
+    s += std::string(n, '}');
+    return s + "\n";
+}
+
+static std::string deepFlowSequence(size_t n)
+{
+    return "root: " + std::string(n, '[') + "1" + std::string(n, ']') + "\n";
+}
+
+static std::string wideMapping(size_t n)
+{
+    std::string s;
+    char line[64];
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::snprintf(line, sizeof(line), "key_%zu: value %zu\n", i, i);
+        s += line;
+    }
+    return s;
+}
+
+static std::string longSequence(size_t n)
+{
+    std::string s = "items:\n";
+    char line[32];
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::snprintf(line, sizeof(line), "  - %zu\n", i);
+        s += line;
+    }
+    return s;
+}
+
+static std::string wideFlowMapping(size_t n)
+{
+    std::string s = "root: {";
+    char item[48];
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::snprintf(item, sizeof(item), "%sk%zu: %zu", i ? ", " : "", i, i);
+        s += item;
+    }
+    return s + "}\n";
+}
+
+static std::string longPlainScalar(size_t n)
+{
+    std::string s = "text: ";
+    for (size_t i = 0; i < n; ++i)
+        s += "word ";
+    return s + "end\n";
+}
+
+static std::string longQuotedScalar(size_t n)
+{
+    std::string s = "text: \"";
+    for (size_t i = 0; i < n; ++i)
+        s += "ab\\\"cd\\n";
+    return s + "\"\n";
+}
+
+static std::string manyComments(size_t n)
+{
+    std::string s;
+    for (size_t i = 0; i < n; ++i)
+        s += "# comment line that the scanner has to skip\n";
+    return s + "key: value\n";
+}
+
+static std::string indentStaircase(size_t n)
+{
+    // Repeated climbs to depth 32 and back, so dedent bursts scale with n
+    std::string s;
+    char key[32];
+    for (size_t block = 0; block < n; ++block)
+    {
+        std::snprintf(key, sizeof(key), "b%zu:\n", block);
+        s += key;
+        for (int d = 1; d < 32; ++d)
+            s += std::string(d, ' ') + "k:\n";
+        s += std::string(32, ' ') + "v: 1\n";
+    }
+    return s;
+}
+
+static const Family FAMILIES[] = {
+    {"deep_block_mapping", deepBlockMapping, 64, 4096},
+    {"deep_block_sequence", deepBlockSequence, 64, 2048},
+    {"deep_flow_mapping", deepFlowMapping, 64, 4096},
+    {"deep_flow_sequence", deepFlowSequence, 64, 4096},
+    {"wide_mapping", wideMapping, 512, 1 << 20},
+    {"long_sequence", longSequence, 512, 1 << 20},
+    {"wide_flow_mapping", wideFlowMapping, 512, 1 << 20},
+    {"long_plain_scalar", longPlainScalar, 1024, 1 << 22},
+    {"long_quoted_scalar", longQuotedScalar, 1024, 1 << 22},
+    {"many_comments", manyComments, 512, 1 << 20},
+    {"indent_staircase", indentStaircase, 8, 1 << 16},
+};
+
+// ====================================================================================
+// Scaling measurement
+// ====================================================================================
+
+struct Settings
+{
+    double threshold;
+    size_t maxBytes;
+    double minMs;
+    int reps;
+    std::string saveDir;
+
+    double maxOpMs; // stop growing once one operation takes this long
+
+    Settings() : threshold(1.25), maxBytes(2 << 20), minMs(10), reps(3), maxOpMs(1000) {}
+};
+
+enum Workload
+{
+    PARSE,
+    SERIALIZE
+};
+
+struct Point
+{
+    size_t n;
+    size_t bytes;
+    double ns;
+};
+
+struct Curve
+{
+    std::vector<Point> points;
+    double slope;
+    bool grows; // false when the measured bytes stay flat (e.g. repeated keys collapse)
+
+    Curve() : slope(0), grows(false) {}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// Fastest of reps, each repeating the operation for at least minMs
+static double timeOp(const Settings &s, Workload w, const std::string &text, const yaml::YamlValue &doc)
+{
+    double best = 1e300;
+    for (int rep = 0; rep < s.reps; ++rep)
+    {
+        size_t iterations = 0;
+        size_t sink = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed;
+        do
+        {
+            if (w == PARSE)
+                sink += yaml::parse(text).size();
+            else
+                sink += doc.serialize().size();
+            ++iterations;
+            elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        } while (elapsed < s.minMs * 1e6);
+        best = std::min(best, elapsed / iterations);
+        if (sink == static_cast<size_t>(-1))
+            std::puts("");
+    }
+    return best;
+}
+
+// Least squares slope of log(ns) over log(bytes)
+static double fitSlope(const std::vector<Point> &points)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    double k = static_cast<double>(points.size());
+    for (const auto &p : points)
+    {
+        double x = std::log(static_cast<double>(p.bytes));
+        double y = std::log(p.ns);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double d = k * sxx - sx * sx;
+    return d > 0 ? (k * sxy - sx * sy) / d : 0;
+}
+
+// Doubles n until the input reaches maxBytes; false if any size fails to parse
+template <typename Build>
+static bool measureCurve(const Settings &s, Workload w, Build build, size_t startN, size_t maxN, Curve &curve)
+{
+    curve.points.clear();
+    for (size_t n = startN; n <= maxN; n *= 2)
+    {
+        std::string text = build(n);
+        if (text.size() > s.maxBytes && !curve.points.empty())
+            break;
+        yaml::YamlValue doc;
+        try
+        {
+            doc = yaml::parse(text);
+        }
+        catch (const yaml::YamlException &)
+        {
+            return false;
+        }
+
+        Point p;
+        p.n = n;
+        p.bytes = (w == PARSE) ? text.size() : doc.serialize().size();
+        p.ns = timeOp(s, w, text, doc);
+        curve.points.push_back(p);
+        if (p.ns > s.maxOpMs * 1e6)
+            break;
+    }
+    if (curve.points.size() < 3)
+        return false;
+    curve.grows = curve.points.back().bytes >= 4 * curve.points.front().bytes;
+    curve.slope = curve.grows ? fitSlope(curve.points) : 0;
+    return true;
+}
+
+static const char *workloadName(Workload w) { return w == PARSE ? "parse" : "serialize"; }
+
+static void printCurve(const std::string &name, Workload w, const Curve &c, bool flagged)
+{
+    const Point &first = c.points.front();
+    const Point &last = c.points.back();
+    if (!c.grows)
+    {
+        std::printf("%-28s %-10s %6zu %12zu  (size does not grow)\n",
+                    name.c_str(), workloadName(w), c.points.size(), last.bytes);
+        return;
+    }
+    std::printf("%-28s %-10s %6zu %12zu %12.2f %12.2f %7.2f  %s\n",
+                name.c_str(), workloadName(w), c.points.size(), last.bytes,
+                first.ns / first.bytes, last.ns / last.bytes, c.slope,
+                flagged ? "SUPER-LINEAR" : "ok");
+}
+
+static bool writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << data;
+    return static_cast<bool>(out);
+}
+
+static void save(const Settings &s, const std::string &name, const std::string &data)
+{
+    if (s.saveDir.empty())
+        return;
+    std::string path = s.saveDir + "/" + name + ".yaml";
+    if (writeFile(path, data))
+        std::printf("  saved %s (%zu bytes)\n", path.c_str(), data.size());
+    else
+        std::fprintf(stderr, "fuzz_yaml: cannot write %s\n", path.c_str());
+}
+
+// ====================================================================================
+// File seeds: scaling transforms and minimization
+// ====================================================================================
+
+static std::string repeatSeed(const std::string &seed, size_t n)
+{
+    std::string unit = seed;
+    if (!unit.empty() && unit.back() != '\n')
+        unit += '\n';
+    std::string s;
+    s.reserve(unit.size() * n);
+    for (size_t i = 0; i < n; ++i)
+        s += unit;
+    return s;
+}
+
+static std::string nestSeed(const std::string &seed, size_t n)
+{
+    std::string s;
+    for (size_t i = 0; i < n; ++i)
+        s += std::string(2 * i, ' ') + "nest:\n";
+    std::string pad(2 * n, ' ');
+    size_t pos = 0;
+    while (pos < seed.size())
+    {
+        size_t end = seed.find('\n', pos);
+        if (end == std::string::npos)
+            end = seed.size();
+        s += pad + seed.substr(pos, end - pos) + "\n";
+        pos = end + 1;
+    }
+    return s;
+}
+
+struct Transform
+{
+    const char *name;
+    std::string (*apply)(const std::string &, size_t);
+    size_t startN;
+    size_t maxN;
+};
+
+static const Transform TRANSFORMS[] = {
+    {"repeat", repeatSeed, 4, 1 << 20},
+    {"nest", nestSeed, 16, 2048},
+};
+
+static bool flaggedSeed(const Settings &s, const Transform &t, Workload w, const std::string &seed, Curve &curve)
+{
+    auto build = [&](size_t n) { return t.apply(seed, n); };
+    size_t startN = t.startN;
+    // Start repeats near 1 KB so tiny seeds still produce measurable inputs
+    if (t.apply == repeatSeed && !seed.empty())
+        startN = std::max<size_t>(startN, 1024 / seed.size() + 1);
+    return measureCurve(s, w, build, startN, t.maxN, curve) && curve.slope > s.threshold;
+}
+
+static std::vector<std::string> splitLines(const std::string &text)
+{
+    std::vector<std::string> lines;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos)
+            end = text.size();
+        lines.push_back(text.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return lines;
+}
+
+static std::string joinLines(const std::vector<std::string> &lines)
+{
+    std::string s;
+    for (const auto &l : lines)
+        s += l + "\n";
+    return s;
+}
+
+// Line-granular delta debugging: drop chunks while the seed stays flagged
+static std::string minimizeSeed(const Settings &s, const Transform &t, Workload w, const std::string &seed)
+{
+    Settings quick = s;
+    quick.minMs = std::min(s.minMs, 5.0);
+    quick.reps = 2;
+
+    std::vector<std::string> lines = splitLines(seed);
+    size_t chunk = lines.size() / 2;
+    while (chunk >= 1)
+    {
+        bool removed = false;
+        for (size_t start = 0; start < lines.size() && lines.size() > 1;)
+        {
+            std::vector<std::string> candidate(lines.begin(), lines.begin() + start);
+            size_t end = std::min(lines.size(), start + chunk);
+            candidate.insert(candidate.end(), lines.begin() + end, lines.end());
+
+            Curve curve;
+            if (!candidate.empty() && flaggedSeed(quick, t, w, joinLines(candidate), curve))
+            {
+                lines.swap(candidate);
+                removed = true;
+            }
+            else
+            {
+                start += chunk;
+            }
+        }
+        if (!removed)
+            chunk /= 2;
+    }
+    return joinLines(lines);
+}
+
+// ====================================================================================
+// Mutation mode
+// ====================================================================================
+
+class Rng
+{
+public:
+    explicit Rng(unsigned long long seed) : state_(seed | 1) {}
+    unsigned long long next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1DULL;
+    }
+    size_t below(size_t n) { return n ? static_cast<size_t>(next() % n) : 0; }
+
+private:
+    unsigned long long state_;
+};
+
+static std::string mutate(Rng &rng, const std::string &input)
+{
+    static const char interesting[] = ":-[]{},#\"'\\\n !&*|> \t0123456789.~";
+    std::string s = input;
+    int edits = 1 + static_cast<int>(rng.below(4));
+    for (int e = 0; e < edits; ++e)
+    {
+        size_t pos = rng.below(s.size() + 1);
+        switch (rng.below(5))
+        {
+        case 0: // overwrite with a structural byte
+            if (!s.empty())
+                s[rng.below(s.size())] = interesting[rng.below(sizeof(interesting) - 1)];
+            break;
+        case 1: // insert a structural byte
+            s.insert(pos, 1, interesting[rng.below(sizeof(interesting) - 1)]);
+            break;
+        case 2: // delete a range
+            if (!s.empty())
+                s.erase(rng.below(s.size()), 1 + rng.below(8));
+            break;
+        case 3: // duplicate a slice
+            if (!s.empty())
+            {
+                size_t from = rng.below(s.size());
+                s.insert(pos, s.substr(from, 1 + rng.below(32)));
+            }
+            break;
+        case 4: // shift indentation of a line
+        {
+            size_t bol = s.rfind('\n', pos ? pos - 1 : 0);
+            bol = (bol == std::string::npos) ? 0 : bol + 1;
+            if (rng.below(2))
+                s.insert(bol, std::string(1 + rng.below(4), ' '));
+            else if (bol < s.size() && s[bol] == ' ')
+                s.erase(bol, 1);
+            break;
+        }
+        }
+    }
+    return s;
+}
+
+extern "C" void onCrash(int sig)
+{
+    if (g_current)
+    {
+        int fd = open("fuzz-crash.yaml", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0)
+        {
+            ssize_t ignored = write(fd, g_current->data(), g_current->size());
+            (void)ignored;
+            close(fd);
+        }
+        const char msg[] = "fuzz_yaml: crashing input written to fuzz-crash.yaml\n";
+        ssize_t ignored = write(2, msg, sizeof(msg) - 1);
+        (void)ignored;
+    }
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+// ====================================================================================
+// Main
+// ====================================================================================
+
+static bool readFile(const std::string &path, std::string &out)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// "dir/big.yaml" is "big"; document 2 of it, "dir/big.yaml#2", is "big-2"
+static std::string baseName(const std::string &path)
+{
+    std::string base = path.substr(path.find_last_of('/') + 1);
+    std::string doc;
+    size_t hash = base.rfind('#');
+    if (hash != std::string::npos && hash + 1 < base.size() &&
+        base.find_first_not_of("0123456789", hash + 1) == std::string::npos)
+    {
+        doc = "-" + base.substr(hash + 1);
+        base.erase(hash);
+    }
+    size_t dot = base.rfind('.');
+    return (dot == std::string::npos || dot == 0 ? base : base.substr(0, dot)) + doc;
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: fuzz_yaml [--threshold X] [--max-bytes N] [--min-ms N] [--save DIR] [files...]\n"
+                 "       fuzz_yaml --mutate N [--seed S] [files...]\n"
+                 "       fuzz_yaml --run files...\n");
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    std::vector<std::string> files;
+    long mutations = 0;
+    unsigned long long seed = 1;
+    bool runOnly = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--threshold" && hasValue)
+            settings.threshold = std::atof(argv[++i]);
+        else if (arg == "--max-bytes" && hasValue)
+            settings.maxBytes = static_cast<size_t>(std::atof(argv[++i]));
+        else if (arg == "--min-ms" && hasValue)
+            settings.minMs = std::atof(argv[++i]);
+        else if (arg == "--save" && hasValue)
+            settings.saveDir = argv[++i];
+        else if (arg == "--mutate" && hasValue)
+            mutations = std::atol(argv[++i]);
+        else if (arg == "--seed" && hasValue)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--run")
+            runOnly = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            files.push_back(arg);
+    }
+
+    std::setvbuf(stdout, nullptr, _IOLBF, 0);
+    std::signal(SIGSEGV, onCrash);
+    std::signal(SIGABRT, onCrash);
+    std::signal(SIGBUS, onCrash);
+
+    std::vector<std::pair<std::string, std::string> > seeds;
+    for (const auto &path : files)
+    {
+        std::string text;
+        if (!readFile(path, text))
+        {
+            std::fprintf(stderr, "fuzz_yaml: cannot read %s\n", path.c_str());
+            return 1;
+        }
+        // Documents of a "---" stream are seeds of their own
+        std::vector<std::string> docs = yaml::splitDocuments(text);
+        if (docs.size() <= 1)
+            seeds.push_back(std::make_pair(path, text));
+        for (size_t i = 0; docs.size() > 1 && i < docs.size(); ++i)
+            seeds.push_back(std::make_pair(path + "#" + std::to_string(i + 1), docs[i]));
+    }
+
+    if (runOnly)
+    {
+        for (const auto &s : seeds)
+            fuzzOne(s.second);
+        std::printf("%zu inputs ok\n", seeds.size());
+        return 0;
+    }
+
+    if (mutations > 0)
+    {
+        std::vector<std::string> pool;
+        for (const auto &s : seeds)
+            pool.push_back(s.second);
+        for (const auto &f : FAMILIES)
+            pool.push_back(f.build(4));
+        Rng rng(seed);
+        long parsed = 0;
+        for (long i = 0; i < mutations; ++i)
+        {
+            std::string input = mutate(rng, pool[rng.below(pool.size())]);
+            if (fuzzOne(input))
+                ++parsed;
+        }
+        std::printf("%ld mutated inputs ok, %ld parsed and round-tripped\n", mutations, parsed);
+        return 0;
+    }
+
+    std::printf("%-28s %-10s %6s %12s %12s %12s %7s\n",
+                "input", "workload", "points", "max bytes", "ns/B first", "ns/B last", "slope");
+
+    int flagged = 0;
+    const Workload workloads[] = {PARSE, SERIALIZE};
+    for (const auto &family : FAMILIES)
+    {
+        for (Workload w : workloads)
+        {
+            Curve curve;
+            if (!measureCurve(settings, w, family.build, family.startN, family.maxN, curve))
+            {
+                std::printf("%-28s %-10s  (does not parse)\n", family.name, workloadName(w));
+                continue;
+            }
+            bool bad = curve.slope > settings.threshold;
+            printCurve(family.name, w, curve, bad);
+            if (bad)
+            {
+                ++flagged;
+                save(settings, std::string(family.name) + "-" + workloadName(w),
+                     family.build(curve.points.back().n));
+            }
+        }
+    }
+
+    for (const auto &s : seeds)
+    {
+        for (const auto &t : TRANSFORMS)
+        {
+            for (Workload w : workloads)
+            {
+                Curve curve;
+                std::string label = baseName(s.first) + "/" + t.name;
+                if (!flaggedSeed(settings, t, w, s.second, curve))
+                {
+                    if (curve.points.size() >= 3)
+                        printCurve(label, w, curve, false);
+                    else
+                        std::printf("%-28s %-10s  (does not parse)\n", label.c_str(), workloadName(w));
+                    continue;
+                }
+                printCurve(label, w, curve, true);
+                ++flagged;
+
+                std::string minimal = minimizeSeed(settings, t, w, s.second);
+                std::printf("  minimized to %zu bytes\n", minimal.size());
+                std::string name = baseName(s.first) + "-" + t.name + "-" + workloadName(w);
+                save(settings, name + "-min", minimal);
+                save(settings, name, t.apply(minimal, curve.points.back().n));
+            }
+        }
+    }
+
+    if (flagged)
+    {
+        std::printf("%d super-linear case(s)\n", flagged);
+        return 1;
+    }
+    return 0;
+}
+
+#endif // YAML_LIBFUZZER
@@ -0,0 +1,533 @@
+// Deterministic YAML corpus generator for scaling tests.
+//
+//   make gen
+//   ./gen_yaml --size 64M --seed 7 --depth 6 --fanout 12 -o big.yaml
+//
+// The same options and seed always produce the same bytes, on any platform:
+// the generator uses its own PRNG and never touches the C library's.
+// Output is streamed, so sizes of several GB need no memory.
+//
+// Options:
+//   --size N[K|M|G]     approximate output size (default 1M)
+//   --seed N            PRNG seed (default 1)
+//   --depth N           maximum nesting depth (default 4)
+//   --fanout N          maximum keys/items per collection (default 8)
+//   --key-len N         key length (default 8)
+//   --str-len N         average plain string length (default 16)
+//   --mix LIST          scalar weights, e.g. str=40,int=20,float=15,bool=10,null=5,quoted=10
+//   --flow R            fraction of collections written in flow style, 0..1 (default 0.2)
+//   --comments R        comment lines per entry, 0..1 (default 0.1)
+//   --anchors R         fraction of scalars given an &anchor or *alias, 0..1 (default 0)
+//   --docs N            documents in the stream, separated by --- (default 1);
+//                       parse() reads one document, so split the stream with
+//                       yaml::splitDocuments or follow it with DocumentTail
+//                       (bench_yaml and fuzz_yaml split their input files)
+//   -o PATH             output file (default stdout)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ====================================================================================
+// PRNG (xorshift64*)
+// ====================================================================================
+
+class Rng
+{
+public:
+    explicit Rng(unsigned long long seed) : state_(seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL)
+    {
+        if (state_ == 0)
+            state_ = 1;
+    }
+
+    unsigned long long next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1DULL;
+    }
+
+    // Uniform in [0, n)
+    unsigned below(unsigned n) { return n ? static_cast<unsigned>(next() % n) : 0; }
+    // Uniform in [0, 1)
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(double p) { return unit() < p; }
+
+private:
+    unsigned long long state_;
+};
+
+// ====================================================================================
+// Options
+// ====================================================================================
+
+enum ScalarKind
+{
+    SCALAR_STR,
+    SCALAR_INT,
+    SCALAR_FLOAT,
+    SCALAR_BOOL,
+    SCALAR_NULL,
+    SCALAR_QUOTED,
+    SCALAR_KINDS
+};
+
+static const char *const SCALAR_NAMES[SCALAR_KINDS] = {"str", "int", "float", "bool", "null", "quoted"};
+
+struct Options
+{
+    unsigned long long size;
+    unsigned long long seed;
+    int depth;
+    int fanout;
+    int keyLen;
+    int strLen;
+    unsigned mix[SCALAR_KINDS];
+    double flow;
+    double comments;
+    double anchors;
+    int docs;
+    std::string output;
+
+    Options()
+        : size(1 << 20), seed(1), depth(4), fanout(8), keyLen(8), strLen(16),
+          flow(0.2), comments(0.1), anchors(0), docs(1)
+    {
+        unsigned defaults[SCALAR_KINDS] = {40, 20, 15, 10, 5, 10};
+        std::memcpy(mix, defaults, sizeof(mix));
+    }
+};
+
+static bool parseSize(const char *text, unsigned long long &out)
+{
+    char *end = nullptr;
+    double value = std::strtod(text, &end);
+    if (end == text || value < 0)
+        return false;
+    switch (*end)
+    {
+    case 'k':
+    case 'K':
+        value *= 1024.0;
+        ++end;
+        break;
+    case 'm':
+    case 'M':
+        value *= 1024.0 * 1024.0;
+        ++end;
+        break;
+    case 'g':
+    case 'G':
+        value *= 1024.0 * 1024.0 * 1024.0;
+        ++end;
+        break;
+    }
+    if (*end != '\0')
+        return false;
+    out = static_cast<unsigned long long>(value);
+    return true;
+}
+
+static bool parseMix(const std::string &text, unsigned mix[SCALAR_KINDS])
+{
+    std::memset(mix, 0, sizeof(unsigned) * SCALAR_KINDS);
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t comma = text.find(',', pos);
+        std::string item = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            return false;
+        std::string name = item.substr(0, eq);
+        int kind = -1;
+        for (int i = 0; i < SCALAR_KINDS; ++i)
+        {
+            if (name == SCALAR_NAMES[i])
+                kind = i;
+        }
+        if (kind < 0)
+            return false;
+        mix[kind] = static_cast<unsigned>(std::atoi(item.c_str() + eq + 1));
+        if (comma == std::string::npos)
+            break;
+        pos = comma + 1;
+    }
+    unsigned total = 0;
+    for (int i = 0; i < SCALAR_KINDS; ++i)
+        total += mix[i];
+    return total > 0;
+}
+
+// ====================================================================================
+// Generator
+// ====================================================================================
+
+static const char *const WORDS[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+    "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa",
+    "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey", "xray",
+    "yankee", "zulu", "service", "replica", "region", "timeout", "endpoint", "cache"};
+static const unsigned WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+class Generator
+{
+public:
+    Generator(const Options &opt, FILE *out)
+        : opt_(opt), out_(out), rng_(opt.seed), written_(0), budget_(0), anchorCount_(0), mixTotal_(0)
+    {
+        for (int i = 0; i < SCALAR_KINDS; ++i)
+            mixTotal_ += opt_.mix[i];
+    }
+
+    void run()
+    {
+        unsigned long long perDoc = opt_.size / (opt_.docs > 0 ? opt_.docs : 1);
+        for (int doc = 0; doc < opt_.docs; ++doc)
+        {
+            if (opt_.docs > 1)
+                put("---\n");
+            budget_ = written_ + perDoc;
+            anchorCount_ = 0; // anchors are scoped to their document
+
+            // Top level: a block mapping that keeps growing until the budget is used
+            for (unsigned i = 0; written_ < budget_; ++i)
+            {
+                comment(0);
+                key(i);
+                value(0, 1);
+            }
+        }
+    }
+
+    unsigned long long written() const { return written_; }
+
+private:
+    const Options &opt_;
+    FILE *out_;
+    Rng rng_;
+    unsigned long long written_;
+    unsigned long long budget_;
+    unsigned anchorCount_;
+    unsigned mixTotal_;
+    std::string scratch_;
+
+    void put(const char *s, size_t n)
+    {
+        std::fwrite(s, 1, n, out_);
+        written_ += n;
+    }
+    void put(const char *s) { put(s, std::strlen(s)); }
+    void put(const std::string &s) { put(s.data(), s.size()); }
+    void indent(int n)
+    {
+        static const char spaces[] = "                                                                ";
+        while (n > 0)
+        {
+            int chunk = n < 64 ? n : 64;
+            put(spaces, chunk);
+            n -= chunk;
+        }
+    }
+
+    bool full() const { return written_ >= budget_; }
+
+    void comment(int ind)
+    {
+        if (!rng_.chance(opt_.comments))
+            return;
+        indent(ind);
+        put("# ");
+        words(4 + rng_.below(8));
+        put("\n");
+    }
+
+    // Letter first, then [a-z0-9_], made unique by the index prefix
+    void key(unsigned index)
+    {
+        scratch_.clear();
+        scratch_ += static_cast<char>('a' + rng_.below(26));
+        char digits[24];
+        std::snprintf(digits, sizeof(digits), "%u_", index);
+        scratch_ += digits;
+        static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+        while (static_cast<int>(scratch_.size()) < opt_.keyLen)
+            scratch_ += chars[rng_.below(sizeof(chars) - 1)];
+        put(scratch_);
+        put(":");
+    }
+
+    void words(unsigned count)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (i)
+                put(" ");
+            put(WORDS[rng_.below(WORD_COUNT)]);
+        }
+    }
+
+    void plainString()
+    {
+        // Average word plus separator is about 6 bytes
+        unsigned count = 1 + rng_.below(static_cast<unsigned>(opt_.strLen / 3 + 1));
+        words(count);
+    }
+
+    void scalar()
+    {
+        unsigned pick = rng_.below(mixTotal_);
+        int kind = 0;
+        while (pick >= opt_.mix[kind])
+            pick -= opt_.mix[kind++];
+
+        // Kept off quoted scalars: readers without anchor support (like
+        // yaml.hpp) then still see one plain scalar
+        if (kind != SCALAR_QUOTED && opt_.anchors > 0 && rng_.chance(opt_.anchors))
+        {
+            char name[32];
+            if (anchorCount_ > 0 && rng_.chance(0.5))
+            {
+                std::snprintf(name, sizeof(name), "*a%u", rng_.below(anchorCount_));
+                put(name);
+                return;
+            }
+            std::snprintf(name, sizeof(name), "&a%u ", anchorCount_++);
+            put(name);
+        }
+
+        char buf[48];
+        switch (kind)
+        {
+        case SCALAR_STR:
+            plainString();
+            break;
+        case SCALAR_INT:
+            std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(rng_.next() % 2000001) - 1000000);
+            put(buf);
+            break;
+        case SCALAR_FLOAT:
+            std::snprintf(buf, sizeof(buf), "%lld.%03u", static_cast<long long>(rng_.next() % 20001) - 10000,
+                          rng_.below(1000));
+            put(buf);
+            break;
+        case SCALAR_BOOL:
+            put(rng_.chance(0.5) ? "true" : "false");
+            break;
+        case SCALAR_NULL:
+            put("null");
+            break;
+        case SCALAR_QUOTED:
+            put("\"");
+            plainString();
+            put(rng_.chance(0.5) ? ": with \\\"escapes\\\"\\t[and, flow] #chars\"" : "\"");
+            break;
+        }
+    }
+
+    // Writes the value after "key:" or "-" (no trailing newline consumed yet)
+    void value(int ind, int depth)
+    {
+        bool container = depth < opt_.depth && !full() && rng_.chance(0.5);
+        if (!container)
+        {
+            put(" ");
+            scalar();
+            if (rng_.chance(opt_.comments / 2))
+                put("  # trailing note");
+            put("\n");
+            return;
+        }
+
+        bool mapping = rng_.chance(0.6);
+        if (rng_.chance(opt_.flow))
+        {
+            put(" ");
+            if (mapping)
+                flowMapping(depth + 1);
+            else
+                flowSequence(depth + 1);
+            put("\n");
+            return;
+        }
+
+        put("\n");
+        if (mapping)
+            blockMapping(ind + 2, depth + 1);
+        else
+            blockSequence(ind + 2, depth + 1);
+    }
+
+    unsigned width() { return 1 + rng_.below(static_cast<unsigned>(opt_.fanout)); }
+
+    void blockMapping(int ind, int depth)
+    {
+        unsigned n = width();
+        for (unsigned i = 0; i < n && (i == 0 || !full()); ++i)
+        {
+            comment(ind);
+            indent(ind);
+            key(i);
+            value(ind, depth);
+        }
+    }
+
+    // Mapping items start on the line after their dash, a form every YAML
+    // reader accepts regardless of what the first value is
+    void blockSequence(int ind, int depth)
+    {
+        unsigned n = width();
+        for (unsigned i = 0; i < n && (i == 0 || !full()); ++i)
+        {
+            comment(ind);
+            indent(ind);
+            put("-");
+            if (depth < opt_.depth && rng_.chance(0.3))
+            {
+                put("\n");
+                blockMapping(ind + 2, depth + 1);
+            }
+            else
+            {
+                value(ind, depth);
+            }
+        }
+    }
+
+    void flowValue(int depth)
+    {
+        if (depth < opt_.depth && !full() && rng_.chance(0.25))
+        {
+            if (rng_.chance(0.5))
+                flowMapping(depth + 1);
+            else
+                flowSequence(depth + 1);
+        }
+        else
+        {
+            scalar();
+        }
+    }
+
+    void flowMapping(int depth)
+    {
+        put("{");
+        unsigned n = width();
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (i)
+                put(", ");
+            key(i);
+            put(" ");
+            flowValue(depth);
+        }
+        put("}");
+    }
+
+    void flowSequence(int depth)
+    {
+        put("[");
+        unsigned n = width();
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (i)
+                put(", ");
+            flowValue(depth);
+        }
+        put("]");
+    }
+};
+
+// ====================================================================================
+// Main
+// ====================================================================================
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: gen_yaml [--size N[K|M|G]] [--seed N] [--depth N] [--fanout N]\n"
+                 "                [--key-len N] [--str-len N] [--mix str=40,int=20,...]\n"
+                 "                [--flow R] [--comments R] [--anchors R] [--docs N] [-o PATH]\n");
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        const char *v = argv[++i];
+        bool ok = true;
+        if (arg == "--size")
+            ok = parseSize(v, opt.size);
+        else if (arg == "--seed")
+            opt.seed = std::strtoull(v, nullptr, 10);
+        else if (arg == "--depth")
+            ok = (opt.depth = std::atoi(v)) >= 1;
+        else if (arg == "--fanout")
+            ok = (opt.fanout = std::atoi(v)) >= 1;
+        else if (arg == "--key-len")
+            ok = (opt.keyLen = std::atoi(v)) >= 1;
+        else if (arg == "--str-len")
+            ok = (opt.strLen = std::atoi(v)) >= 1;
+        else if (arg == "--mix")
+            ok = parseMix(v, opt.mix);
+        else if (arg == "--flow")
+            opt.flow = std::atof(v);
+        else if (arg == "--comments")
+            opt.comments = std::atof(v);
+        else if (arg == "--anchors")
+            opt.anchors = std::atof(v);
+        else if (arg == "--docs")
+            ok = (opt.docs = std::atoi(v)) >= 1;
+        else if (arg == "-o")
+            opt.output = v;
+        else
+            ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "gen_yaml: bad value for %s: %s\n", arg.c_str(), v);
+            usage();
+            return 2;
+        }
+    }
+
+    FILE *out = stdout;
+    if (!opt.output.empty())
+    {
+        out = std::fopen(opt.output.c_str(), "wb");
+        if (!out)
+        {
+            std::perror(opt.output.c_str());
+            return 1;
+        }
+    }
+    static char buffer[1 << 20];
+    std::setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    Generator gen(opt, out);
+    gen.run();
+
+    if (std::fflush(out) != 0 || (out != stdout && std::fclose(out) != 0))
+    {
+        std::perror("gen_yaml: write failed");
+        return 1;
+    }
+    if (out != stdout)
+        std::fprintf(stderr, "gen_yaml: wrote %llu bytes to %s\n", gen.written(), opt.output.c_str());
+    return 0;
+}
@@ -2,8 +2,15 @@
 #include <chrono>
 #include <sstream>
 #include <cassert>
+#include <fstream>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 #define YAML_IMPLEMENTATION
 #include "yaml.hpp"
+#ifdef YAML_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 // Colors
 #define C_RESET "\033[0m"
@@ -78,6 +85,11 @@ int total_tests = 0;
 int passed_tests = 0;
 int failed_tests = 0;
 
+static void write_file(const std::string &path, const std::string &content) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << content;
+}
+
 // Basic parsing tests
 TEST(basic_string) {
     std::string yaml = "name: John Doe";
@@ -162,6 +174,36 @@ phone: 555 123 4567)";
     ASSERT_TRUE(root["version"].isString()); // This should pass now
 }
 
+TEST(scalar_classification) {
+    struct Case {
+        const char *text;
+        yaml::TokenType type;
+    };
+    const Case cases[] = {
+        {"0", yaml::TokenType::TOKEN_NUMBER},       {"-7", yaml::TokenType::TOKEN_NUMBER},
+        {"12   ", yaml::TokenType::TOKEN_NUMBER},   {"-3.25", yaml::TokenType::TOKEN_NUMBER},
+        {"1.", yaml::TokenType::TOKEN_STRING},      {".5", yaml::TokenType::TOKEN_STRING},
+        {"-.5", yaml::TokenType::TOKEN_STRING},     {"1 2", yaml::TokenType::TOKEN_STRING},
+        {"4\t", yaml::TokenType::TOKEN_STRING},     {"1e5", yaml::TokenType::TOKEN_STRING},
+        {"--1", yaml::TokenType::TOKEN_STRING},     {"true", yaml::TokenType::TOKEN_BOOLEAN},
+        {"false ", yaml::TokenType::TOKEN_BOOLEAN}, {"truex", yaml::TokenType::TOKEN_STRING},
+        {"null", yaml::TokenType::TOKEN_NULL},      {"~", yaml::TokenType::TOKEN_NULL},
+        {"nul", yaml::TokenType::TOKEN_STRING},     {"~~", yaml::TokenType::TOKEN_STRING},
+    };
+    for (const Case &c : cases) {
+        std::string text = c.text;
+        yaml::Scanner scanner(text);
+        yaml::Token token = scanner.next();
+        ASSERT_TRUE(token.type == c.type);
+        ASSERT_EQ(token.value, text.substr(0, text.find_last_not_of(' ') + 1));
+    }
+
+    // Without comments '#' is part of the scalar, so it is no longer a number
+    std::string hashed = "12 #x";
+    ASSERT_TRUE(yaml::Scanner(hashed).next().type == yaml::TokenType::TOKEN_NUMBER);
+    ASSERT_TRUE(yaml::BasicScanner<yaml::CompactPolicy>(hashed).next().type == yaml::TokenType::TOKEN_STRING);
+}
+
 // Nested structures
 TEST(nested_mapping) {
     std::string yaml = R"(user:
@@ -210,6 +252,30 @@ TEST(mixed_sequence) {
     ASSERT_TRUE(seq[4].isNumber());
 }
 
+TEST(nested_block_siblings) {
+    std::string yaml = R"(servers:
+  - name: web
+    port: 80
+  - name: db
+    port: 5432
+limits:
+  cpu:
+    max: 4
+  memory: 512
+name: cluster)";
+
+    yaml::YamlValue root = yaml::parse(yaml);
+    ASSERT_EQ(root.size(), 3);
+    ASSERT_EQ(root["servers"].size(), 2);
+    ASSERT_EQ(root["servers"][0]["name"].asString(), "web");
+    ASSERT_EQ(root["servers"][0]["port"].asInt(), 80);
+    ASSERT_EQ(root["servers"][1]["port"].asInt(), 5432);
+    ASSERT_EQ(root["limits"].size(), 2);
+    ASSERT_EQ(root["limits"]["cpu"]["max"].asInt(), 4);
+    ASSERT_EQ(root["limits"]["memory"].asInt(), 512);
+    ASSERT_EQ(root["name"].asString(), "cluster");
+}
+
 // Flow style tests
 TEST(flow_mapping) {
     std::string yaml = "config: {debug: true, port: 8080, host: localhost}";
@@ -297,6 +363,54 @@ number_val: 42)";
     ASSERT_THROWS(root["nonexistent"].asString(), yaml::YamlException);
 }
 
+#ifdef YAML_CPP17
+TEST(cxx17_lookups) {
+    yaml::YamlValue root = yaml::parse("name: demo\nsize: 4294967296\nratio: 0.1\nlimits: {cpu: 2}");
+
+    std::string_view path = "limits.cpu";
+    ASSERT_EQ(root[path.substr(0, 6)][path.substr(7)].get<long>(), 2);
+    ASSERT_TRUE(root.contains(std::string_view("name")));
+    ASSERT_EQ(root["size"].get<long long>(), 4294967296LL);
+    ASSERT_EQ(root["ratio"].get<float>(), 0.1f);
+    ASSERT_TRUE(root["name"].get<std::string_view>() == "demo");
+
+    root[std::string_view("added")] = 1.5;
+    ASSERT_EQ(root["added"].asNumber(), 1.5);
+    ASSERT_TRUE(yaml::parse(root.serialize()) == root);
+}
+#endif
+
+#ifdef YAML_CPP17
+#define DEFAULTS_TEXT \
+    "# built-in defaults\n" \
+    "server:\n  host: \"localhost\"\n  port: 8080\n" \
+    "limits: {cpu: 2, memory: 512, tags: [web, 'edge node']}\n" \
+    "users:\n  - name: ann\n    admin: true\n  - name: bob\n    admin: false\n" \
+    "ratio: -0.25\nunset: ~\n"
+
+static constexpr auto defaults = YAML_LITERAL(DEFAULTS_TEXT);
+static_assert(defaults["server"]["port"].asInt() == 8080, "lookups fold at compile time");
+static_assert(defaults["limits"]["tags"][1].asString() == "edge node", "");
+static_assert(defaults["users"][1]["name"].asString() == "bob", "");
+static_assert(defaults["unset"].isNil() && !defaults.contains("missing"), "");
+
+TEST(literal_documents) {
+    ASSERT_TRUE(defaults.toValue() == yaml::parse(DEFAULTS_TEXT));
+    ASSERT_EQ(defaults["ratio"].asNumber(), -0.25);
+    ASSERT_EQ(defaults["users"].size(), 2u);
+    ASSERT_EQ(defaults["users"][0].key(), "");
+    ASSERT_EQ(defaults["server"][1].key(), "port");
+
+    // Outside constant evaluation the same errors throw
+    ASSERT_THROWS(defaults["server"]["missing"], yaml::YamlException);
+    ASSERT_THROWS(defaults["ratio"].asString(), yaml::YamlException);
+    typedef yaml::LiteralDocument<4, 32> Small;
+    ASSERT_THROWS(Small("a: [1, 2, 3, 4]"), yaml::YamlException);
+    ASSERT_THROWS(Small("a: [1, 2\n"), yaml::YamlException);
+}
+#undef DEFAULTS_TEXT
+#endif
+
 // Serialization tests
 TEST(serialization_roundtrip) {
     std::string yaml = "name: John Doe\nage: 30";
@@ -312,6 +426,258 @@ TEST(serialization_roundtrip) {
     ASSERT_EQ(root["age"].asInt(), root2["age"].asInt());
 }
 
+TEST(serialization_nested_roundtrip) {
+    std::string yaml = R"(app:
+  db:
+    host: localhost
+    port: 5432
+  servers:
+    - name: web
+      roles: [api, "a, b"]
+      limits:
+        cpu: 0.25
+    - name: cache
+quoted: "42"
+flag: "true"
+pi: 3.14159265358979
+big: 3000000000
+dash: "a - b")";
+
+    yaml::YamlValue root = yaml::parse(yaml);
+    yaml::YamlValue root2 = yaml::parse(root.serialize());
+
+    ASSERT_TRUE(root == root2);
+    ASSERT_TRUE(root2["quoted"].isString());
+    ASSERT_EQ(root2["pi"].asNumber(), 3.14159265358979);
+    ASSERT_EQ(root2["app"]["servers"][0]["limits"]["cpu"].asNumber(), 0.25);
+}
+
+TEST(parse_stats) {
+    std::string yaml = "a:\n  b:\n    c: 1\n  d: [1, 2, {x: y}]\ne: hello\n";
+
+    yaml::ParseStats stats;
+    yaml::YamlValue root = yaml::parse(yaml, &stats);
+
+    ASSERT_TRUE(root == yaml::parse(yaml));
+    ASSERT_EQ(stats.bytes, yaml.size());
+    ASSERT_EQ(stats.nodeCount(yaml::YamlType::MAPPING), 4u);
+    ASSERT_EQ(stats.nodeCount(yaml::YamlType::SEQUENCE), 1u);
+    ASSERT_EQ(stats.nodeCount(yaml::YamlType::NUMBER), 3u);
+    ASSERT_EQ(stats.nodeCount(yaml::YamlType::STRING), 2u);
+    ASSERT_EQ(stats.totalNodes(), 10u);
+    ASSERT_EQ(stats.maxDepth, 5u);
+    ASSERT_EQ(stats.maxMappingWidth, 2u);
+    ASSERT_EQ(stats.tokenCount(yaml::TokenType::TOKEN_COLON), 6u);
+    ASSERT_EQ(stats.tokenCount(yaml::TokenType::TOKEN_EOF), 1u);
+    ASSERT_EQ(stats.tokenCount(yaml::TokenType::TOKEN_NEWLINE), 5u);
+    ASSERT_EQ(stats.totalTokens(), 29u); // indentation is carried on tokens, not counted as tokens
+    ASSERT_TRUE(stats.scanMs >= 0 && stats.buildMs >= 0);
+    ASSERT_TRUE(stats.documentBytes >= 10 * sizeof(yaml::YamlValue));
+    ASSERT_TRUE(stats.peakBytes >= stats.bytes + stats.documentBytes);
+
+    // Stats are reset on reuse, and a null pointer is accepted
+    yaml::parse("x: 1", &stats);
+    ASSERT_EQ(stats.totalNodes(), 2u);
+    ASSERT_EQ(yaml::parse("x: 1", nullptr)["x"].asInt(), 1);
+}
+
+TEST(parse_policies) {
+    std::string text =
+        "name: web # primary\n"
+        "ports: [80, 443]\n"
+        "path: \"C:\\tmp\\new\"\n"
+        "replicas: 3\n"
+        "items:\n"
+        "  - a\n"
+        "  - b\n";
+    yaml::YamlValue full = yaml::parse(text);
+    ASSERT_EQ(full["name"].asString(), "web");
+    ASSERT_EQ(full["ports"].size(), 2);
+    ASSERT_EQ(full["path"].asString(), "C:\tmp\new");
+
+    // Compact: '#', flow brackets and backslashes are plain text
+    yaml::YamlValue compact = yaml::parse<yaml::CompactPolicy>(text);
+    ASSERT_EQ(compact["name"].asString(), "web # primary");
+    ASSERT_EQ(compact["ports"].asString(), "[80, 443]");
+    ASSERT_EQ(compact["path"].asString(), "C:\\tmp\\new");
+    ASSERT_EQ(compact["replicas"].asInt(), 3);
+    ASSERT_EQ(compact["items"][1].asString(), "b");
+
+    // Same tree as the full parser on input inside the subset
+    std::string plain = "server:\n  host: localhost\n  port: 8080\nlist:\n  - x: 1\n    y: two\n";
+    ASSERT_TRUE(yaml::parse<yaml::CompactPolicy>(plain) == yaml::parse(plain));
+
+    // No positions: errors still throw, at line 0
+    try {
+        yaml::parse<yaml::CompactPolicy>("a:\n    b: 1\n  c: 2\n");
+        ASSERT_TRUE(false);
+    } catch (const yaml::YamlException &e) {
+        ASSERT_EQ(e.line, 0);
+    }
+
+    std::string repeated = "a: 1\nb: 2\na: 3\n";
+    ASSERT_EQ(yaml::parse(repeated)["a"].asInt(), 3);
+    ASSERT_THROWS(yaml::parse<yaml::StrictPolicy>(repeated), yaml::YamlException);
+    ASSERT_THROWS(yaml::parse<yaml::StrictPolicy>("{a: 1, a: 2}"), yaml::YamlException);
+    ASSERT_TRUE(yaml::parse<yaml::StrictPolicy>(plain) == yaml::parse(plain));
+}
+
+TEST(parse_fast_path) {
+    // parse() must agree with the full Parser whether or not the input
+    // stays inside the block subset
+    const char *docs[] = {
+        "a: 1\nb:\n  c: \"x\\ty\"\n  d: 'q'\ne: [1, 2]\n",
+        "# header\n- a: 1\n  b: ~\n-\n  - x\n  - -2.5\n- true\n",
+        "key:\n- a\n- b\nother: null\n",
+        "a:\n  b:\n    c: 1\n\n  d: 2 # trailing\nf: 3\n",
+        "tagged: !include other.yaml\n",
+        "",
+        "42",
+    };
+    for (const char *doc : docs) {
+        std::string text = doc;
+        ASSERT_TRUE(yaml::parse(text) == yaml::Parser(text).parse());
+    }
+
+    // Errors are reported by the full parser, at the same position
+    const char *bad[] = {"a:\n    b: 1\n  c: 2\n", "a: 1\nb:", "a: {b: 1"};
+    for (const char *doc : bad) {
+        std::string text = doc;
+        int line = -1, column = -1;
+        try {
+            yaml::Parser(text).parse();
+        } catch (const yaml::YamlException &e) {
+            line = e.line;
+            column = e.column;
+        }
+        try {
+            yaml::parse(text);
+            ASSERT_TRUE(false);
+        } catch (const yaml::YamlException &e) {
+            ASSERT_EQ(e.line, line);
+            ASSERT_EQ(e.column, column);
+        }
+    }
+}
+
+TEST(parse_memory_limit) {
+    std::string yaml;
+    for (int i = 0; i < 200; ++i)
+        yaml += "key_" + std::to_string(i) + ": [a fairly long string value number " + std::to_string(i) + ", 2, 3]\n";
+
+    yaml::ParseStats stats;
+    yaml::ParseOptions options;
+    options.stats = &stats;
+    yaml::YamlValue root = yaml::parse(yaml, options);
+    ASSERT_EQ(root.size(), 200u);
+    ASSERT_TRUE(stats.peakBytes >= stats.bytes + stats.documentBytes);
+
+    // A limit at the measured peak is met; one well below it is not
+    options.memoryLimit = stats.peakBytes;
+    ASSERT_EQ(yaml::parse(yaml, options).size(), 200u);
+    options.memoryLimit = stats.bytes + stats.documentBytes / 2;
+    options.stats = nullptr;
+    ASSERT_THROWS(yaml::parse(yaml, options), yaml::YamlException);
+}
+
+#ifdef YAML_ACCESS_PROFILE
+TEST(access_profile) {
+    const yaml::YamlValue doc = yaml::parse(
+        "server:\n  host: localhost\n  port: 8080\n"
+        "limits:\n  cpu: 2\n  memory: 512\n"
+        "ports: [80, 443]\n"
+        "name: demo");
+
+    yaml::AccessProfile profile;
+    doc["name"].asString(); // not recording yet
+    profile.start();
+    ASSERT_TRUE(profile.recording());
+    for (int i = 0; i < 10; ++i)
+        doc["server"]["port"].asInt();
+    for (int i = 0; i < 3; ++i)
+        doc["ports"][1].asInt();
+    doc.contains("missing");
+    doc.contains("missing");
+    for (const auto &pair : doc["limits"].asMapping())
+        doc["limits"][pair.first].asInt();
+    profile.stop();
+    doc["name"].asString();
+    ASSERT_FALSE(profile.recording());
+    ASSERT_EQ(profile.totalHits(), 10 * 2 + 3 * 2 + 2 + 1 + 2 * 2);
+
+    std::vector<yaml::PathHits> hot = profile.hottest(doc);
+    ASSERT_EQ(hot[0].path, "server");
+    ASSERT_EQ(hot[0].subtree, 20);
+    ASSERT_EQ(hot[1].path, "server.port");
+    ASSERT_EQ(hot[1].hits, 10);
+    ASSERT_EQ(hot[1].steps.size(), 2);
+    ASSERT_EQ(hot[1].steps[1].key, "port");
+    ASSERT_EQ(hot[2].path, "ports"); // ties on hits go to the larger subtree
+    ASSERT_EQ(hot[2].subtree, 6);
+    ASSERT_EQ(hot[3].path, "limits");
+    ASSERT_EQ(hot[3].hits, 3);
+    ASSERT_EQ(hot[4].path, "ports[1]");
+    ASSERT_TRUE(hot[4].steps[1].isIndex);
+    bool sawMissing = false;
+    for (const auto &h : hot)
+    {
+        if (h.path == "missing")
+        {
+            sawMissing = true;
+            ASSERT_FALSE(h.present);
+            ASSERT_EQ(h.hits, 2);
+        }
+        ASSERT_TRUE(h.path != "name" && h.path != "server.host");
+    }
+    ASSERT_TRUE(sawMissing);
+    ASSERT_EQ(profile.hottest(doc, 2).size(), 2);
+
+    yaml::YamlValue packed = profile.relayout(doc);
+    ASSERT_TRUE(packed == doc);
+    ASSERT_EQ(packed.serialize(), doc.serialize());
+
+    profile.clear();
+    ASSERT_EQ(profile.totalHits(), 0);
+    ASSERT_TRUE(profile.hottest(doc).empty());
+}
+#endif
+
+#ifdef YAML_ALLOC_STATS
+// Allocation budget for a fixed corpus; raise a bound only with a reason
+TEST(allocation_budget) {
+    std::string yaml;
+    for (int i = 0; i < 100; i++) {
+        std::string n = std::to_string(i);
+        yaml += "svc_" + n + ":\n  image: registry/app:" + n + "\n  replicas: 3\n"
+                "  ports: [80, 443]\n  env:\n    - name: MODE\n      value: production\n";
+    }
+
+    yaml::AllocStats before = yaml::AllocStats::capture();
+    {
+        yaml::YamlValue root = yaml::parse(yaml);
+        yaml::AllocStats parsed = yaml::AllocStats::capture() - before;
+        ASSERT_TRUE(parsed[yaml::AllocPhase::SCANNER].allocations <= 20);
+        ASSERT_TRUE(parsed[yaml::AllocPhase::PARSER].allocations <= 1200);
+        ASSERT_TRUE(parsed[yaml::AllocPhase::VALUE].allocations <= 800);
+        ASSERT_TRUE(parsed[yaml::AllocPhase::VALUE].bytes <= 30000);
+        // Containers the parser built are moved into the document; nothing
+        // from the scanner outlives the parse
+        ASSERT_EQ(parsed[yaml::AllocPhase::SCANNER].allocations, parsed[yaml::AllocPhase::SCANNER].frees);
+
+        yaml::AllocStats mark = yaml::AllocStats::capture();
+        std::string out = root.serialize();
+        yaml::AllocStats serialized = yaml::AllocStats::capture() - mark;
+        ASSERT_TRUE(serialized[yaml::AllocPhase::SERIALIZER].allocations <= 1100);
+        ASSERT_EQ(serialized[yaml::AllocPhase::VALUE].allocations, 0u);
+    }
+
+    yaml::AllocStats after = yaml::AllocStats::capture() - before;
+    ASSERT_EQ(after[yaml::AllocPhase::PARSER].allocations, after[yaml::AllocPhase::PARSER].frees);
+    ASSERT_EQ(after[yaml::AllocPhase::VALUE].allocations, after[yaml::AllocPhase::VALUE].frees);
+    ASSERT_EQ(after[yaml::AllocPhase::VALUE].bytes, after[yaml::AllocPhase::VALUE].freedBytes);
+}
+#endif
+
 // Memory stress test
 TEST(memory_stress_test) {
     const int iterations = 100; // Reduce iterations to make debugging easier
@@ -374,7 +740,559 @@ application:
     std::cout << C_YELLOW " (took " << duration.count() << "ms)" C_RESET;
 }
 
- 
+// File loader tests
+TEST(load_files_batch) {
+    write_file("test_load_a.yaml", "name: alpha\nport: 8080");
+    write_file("test_load_b.yaml", "items: [1, 2, 3]");
+    write_file("test_load_bad.yaml", "obj: {key: value");
+
+    std::vector<std::string> paths;
+    paths.push_back("test_load_a.yaml");
+    paths.push_back("test_load_missing.yaml");
+    paths.push_back("test_load_b.yaml");
+    paths.push_back("test_load_bad.yaml");
+
+    for (int pass = 0; pass < 2; pass++) {
+        yaml::LoadOptions options;
+        options.threads = 2;
+        options.batchSize = 2;
+        options.useIoUring = (pass == 0);
+        std::vector<yaml::LoadedFile> files = yaml::loadFiles(paths, options);
+
+        ASSERT_EQ(files.size(), 4);
+        ASSERT_TRUE(files[0].ok);
+        ASSERT_EQ(files[0].path, "test_load_a.yaml");
+        ASSERT_EQ(files[0].value["name"].asString(), "alpha");
+        ASSERT_EQ(files[0].value["port"].asInt(), 8080);
+        ASSERT_FALSE(files[1].ok);
+        ASSERT_FALSE(files[1].error.empty());
+        ASSERT_TRUE(files[2].ok);
+        ASSERT_EQ(files[2].value["items"].size(), 3);
+        ASSERT_FALSE(files[3].ok);
+        ASSERT_TRUE(files[3].line > 0);
+    }
+
+    std::remove("test_load_a.yaml");
+    std::remove("test_load_b.yaml");
+    std::remove("test_load_bad.yaml");
+}
+
+TEST(load_tree) {
+    mkdir("test_tree", 0755);
+    mkdir("test_tree/sub", 0755);
+    write_file("test_tree/base.yaml", "server:\n  host: localhost\n  port: 80\nname: base");
+    write_file("test_tree/sub/override.yml", "server:\n  port: 8080\nextra: [1, 2]");
+    write_file("test_tree/sub/broken.yaml", "list: [1, 2");
+    write_file("test_tree/notes.txt", "not: yaml");
+
+    yaml::TreeOptions options;
+    options.threads = 2;
+    yaml::TreeResult byPath = yaml::loadTree("test_tree", options);
+    ASSERT_EQ(byPath.files.size(), 3);
+    ASSERT_EQ(byPath.root.size(), 2);
+    ASSERT_EQ(byPath.root["base.yaml"]["name"].asString(), "base");
+    ASSERT_EQ(byPath.root["sub/override.yml"]["server"]["port"].asInt(), 8080);
+    ASSERT_FALSE(byPath.root.contains("sub/broken.yaml"));
+    ASSERT_EQ(byPath.files[1].path, "sub/broken.yaml");
+    ASSERT_FALSE(byPath.files[1].ok);
+
+    options.merge = yaml::MergePolicy::DEEP_MERGE;
+    yaml::TreeResult merged = yaml::loadTree("test_tree/", options);
+    ASSERT_EQ(merged.root["server"]["host"].asString(), "localhost");
+    ASSERT_EQ(merged.root["server"]["port"].asInt(), 8080);
+    ASSERT_EQ(merged.root["extra"].size(), 2);
+    ASSERT_EQ(merged.root["name"].asString(), "base");
+
+    // An empty file is skipped and a scalar root is reported, not merged
+    write_file("test_tree/sub/empty.yaml", "# nothing here yet");
+    write_file("test_tree/sub/scalar.yaml", "just text");
+    merged = yaml::loadTree("test_tree", options);
+    ASSERT_TRUE(merged.root.isMapping());
+    ASSERT_EQ(merged.root["server"]["port"].asInt(), 8080);
+    ASSERT_EQ(merged.root["name"].asString(), "base");
+    ASSERT_EQ(merged.files[2].path, "sub/empty.yaml");
+    ASSERT_TRUE(merged.files[2].ok);
+    ASSERT_EQ(merged.files[4].path, "sub/scalar.yaml");
+    ASSERT_FALSE(merged.files[4].ok);
+    ASSERT_TRUE(merged.files[4].error.find("not a mapping") != std::string::npos);
+
+    ASSERT_THROWS(yaml::loadTree("test_tree_missing"), yaml::YamlException);
+
+    std::remove("test_tree/base.yaml");
+    std::remove("test_tree/sub/override.yml");
+    std::remove("test_tree/sub/broken.yaml");
+    std::remove("test_tree/sub/empty.yaml");
+    std::remove("test_tree/sub/scalar.yaml");
+    std::remove("test_tree/notes.txt");
+    rmdir("test_tree/sub");
+    rmdir("test_tree");
+}
+
+#ifdef YAML_TRACE
+// Spans from a parallel tree load, exported as Chrome trace JSON
+TEST(trace_export) {
+    mkdir("test_trace", 0755);
+    write_file("test_trace/a.yaml", "server:\n  host: localhost\n  port: 80");
+    write_file("test_trace/b.yaml", "server:\n  port: 8080\nname: \"quoted \\\"b\\\"\"");
+
+    yaml::parse("outside: trace");
+    ASSERT_EQ(yaml::Trace::eventCount(), 0);
+
+    yaml::Trace::start();
+    yaml::TreeOptions options;
+    options.threads = 2;
+    options.merge = yaml::MergePolicy::DEEP_MERGE;
+    yaml::TreeResult tree = yaml::loadTree("test_trace", options);
+    tree.root.serialize();
+    yaml::Trace::stop();
+    size_t events = yaml::Trace::eventCount();
+    yaml::parse("after: stop");
+    ASSERT_EQ(yaml::Trace::eventCount(), events);
+
+    // Two files: read + load + parse + scan + build each, plus the tree spans
+    ASSERT_TRUE(events >= 2 * 5 + 5);
+    std::string json = yaml::Trace::json();
+    const char *names[] = {"\"read\"", "\"load\"", "\"parse\"", "\"scan\"", "\"build\"",
+                           "\"discover\"", "\"merge\"", "\"serialize\"", "\"loadFiles\"", "\"loadTree\""};
+    for (const char *name : names)
+        ASSERT_TRUE(json.find(std::string("\"name\": ") + name) != std::string::npos);
+    ASSERT_TRUE(json.find("\"detail\": \"test_trace/a.yaml\"") != std::string::npos);
+    ASSERT_TRUE(json.find("\"thread_name\"") != std::string::npos);
+
+    // One complete event, or one async begin (io_uring reads), per span
+    size_t spans = 0;
+    for (size_t pos = json.find("\"ph\": \""); pos != std::string::npos; pos = json.find("\"ph\": \"", pos + 1))
+        spans += (json[pos + 7] == 'X' || json[pos + 7] == 'b');
+    ASSERT_EQ(spans, events);
+
+    ASSERT_TRUE(yaml::Trace::writeJson("test_trace/trace.json"));
+    ASSERT_FALSE(yaml::Trace::writeJson("test_trace/missing/trace.json"));
+    yaml::Trace::start();
+    ASSERT_EQ(yaml::Trace::eventCount(), 0);
+    yaml::Trace::stop();
+
+    std::remove("test_trace/a.yaml");
+    std::remove("test_trace/b.yaml");
+    std::remove("test_trace/trace.json");
+    rmdir("test_trace");
+}
+#endif
+
+TEST(include_resolution) {
+    mkdir("test_inc", 0755);
+    mkdir("test_inc/sub", 0755);
+    write_file("test_inc/common.yaml", "timeout: 30\nretries: 3");
+    write_file("test_inc/sub/db.yaml", "host: db\nsettings: !include ../common.yaml");
+    write_file("test_inc/app.yaml", "name: app\ndb: !include sub/db.yaml\nextra:\n  - !include common.yaml\n  - plain");
+    write_file("test_inc/cycle_a.yaml", "next: !include cycle_b.yaml");
+    write_file("test_inc/cycle_b.yaml", "next: !include cycle_a.yaml");
+    write_file("test_inc/missing.yaml", "x: !include nowhere.yaml");
+
+    // Without resolution the tag is ignored and the target stays a string
+    ASSERT_EQ(yaml::parse("x: !include common.yaml")["x"].asString(), "common.yaml");
+
+    // Only `!include` is a tag; other '!' words stay plain text as before
+    ASSERT_EQ(yaml::parse("a: !important text")["a"].asString(), "!important text");
+    ASSERT_TRUE(yaml::parse("b: !!str 12")["b"].isString());
+    ASSERT_EQ(yaml::parse("b: !!str 12")["b"].asString(), "!!str 12");
+    ASSERT_EQ(yaml::Parser("a: !important text\nb: !!str 12").parse()["b"].asString(), "!!str 12");
+
+    std::vector<std::string> paths;
+    paths.push_back("test_inc/app.yaml");
+    paths.push_back("test_inc/cycle_a.yaml");
+    paths.push_back("test_inc/missing.yaml");
+
+    yaml::LoadOptions options;
+    options.resolveIncludes = true;
+    std::vector<yaml::LoadedFile> files = yaml::loadFiles(paths, options);
+
+    ASSERT_TRUE(files[0].ok);
+    ASSERT_EQ(files[0].includes.size(), 2);
+    ASSERT_EQ(files[0].value["db"]["host"].asString(), "db");
+    ASSERT_EQ(files[0].value["db"]["settings"]["timeout"].asInt(), 30);
+    ASSERT_EQ(files[0].value["extra"][0]["retries"].asInt(), 3);
+    ASSERT_EQ(files[0].value["extra"][1].asString(), "plain");
+    ASSERT_FALSE(files[1].ok);
+    ASSERT_TRUE(files[1].error.find("Include cycle") != std::string::npos);
+    ASSERT_FALSE(files[2].ok);
+    ASSERT_TRUE(files[2].error.find("nowhere.yaml") != std::string::npos);
+
+    // A changed fragment is parsed again instead of served from the cache
+    write_file("test_inc/common.yaml", "timeout: 45\nretries: 3");
+    files = yaml::loadFiles(paths, options);
+    ASSERT_EQ(files[0].value["db"]["settings"]["timeout"].asInt(), 45);
+    yaml::clearIncludeCache();
+
+    std::remove("test_inc/common.yaml");
+    std::remove("test_inc/sub/db.yaml");
+    std::remove("test_inc/app.yaml");
+    std::remove("test_inc/cycle_a.yaml");
+    std::remove("test_inc/cycle_b.yaml");
+    std::remove("test_inc/missing.yaml");
+    rmdir("test_inc/sub");
+    rmdir("test_inc");
+}
+
+TEST(document_tail) {
+    const char *path = "test_tail.log";
+    write_file(path, "---\nevent: start\nid: 1\n---\nevent: stop\nid: 2\n---\nevent: pa");
+
+    std::vector<yaml::YamlValue> docs;
+    uint64_t saved = 0;
+    {
+        yaml::DocumentTail tail(path);
+        ASSERT_EQ(tail.poll(docs), 2);
+        ASSERT_EQ(docs[0]["event"].asString(), "start");
+        ASSERT_EQ(docs[1]["id"].asInt(), 2);
+
+        // The partial document is held back until its separator arrives
+        ASSERT_EQ(tail.poll(docs), 0);
+        {
+            std::ofstream out(path, std::ios::app);
+            out << "use\nid: 3\n---\n";
+        }
+        ASSERT_EQ(tail.poll(docs, 1000), 1);
+        ASSERT_EQ(docs[2]["event"].asString(), "pause");
+        saved = tail.offset();
+    }
+
+    {
+        std::ofstream out(path, std::ios::app);
+        out << "event: resume\nid: 4\n---\nbroken: [1\n---\nevent: end\n";
+    }
+    yaml::DocumentTail resumed(path, saved);
+    docs.clear();
+    ASSERT_THROWS(resumed.poll(docs), yaml::YamlException);
+    ASSERT_EQ(docs.size(), 1);
+    ASSERT_EQ(docs[0]["id"].asInt(), 4);
+    ASSERT_EQ(resumed.flush(docs), 1);
+    ASSERT_EQ(docs[1]["event"].asString(), "end");
+
+    // Content after "---" belongs to the document the marker opens
+    write_file(path, "--- {event: a}\n--- {event: b}\n---\nevent: c\n--- d\n");
+    yaml::DocumentTail inline_docs(path);
+    docs.clear();
+    ASSERT_EQ(inline_docs.poll(docs), 3);
+    ASSERT_EQ(docs[0]["event"].asString(), "a");
+    ASSERT_EQ(docs[1]["event"].asString(), "b");
+    ASSERT_EQ(docs[2]["event"].asString(), "c");
+    ASSERT_EQ(inline_docs.flush(docs), 1);
+    ASSERT_EQ(docs[3].asString(), "d");
+
+    // A whole stream in memory splits the same way
+    std::vector<std::string> split = yaml::splitDocuments("---\na: 1\n--- {b: 2}\n...\n---\n\nc: 3");
+    ASSERT_EQ(split.size(), 3);
+    ASSERT_EQ(yaml::parse(split[0])["a"].asInt(), 1);
+    ASSERT_EQ(yaml::parse(split[1])["b"].asInt(), 2);
+    ASSERT_EQ(yaml::parse(split[2])["c"].asInt(), 3);
+    ASSERT_EQ(yaml::splitDocuments("a: 1\n").size(), 1);
+
+    std::remove(path);
+}
+
+// Hands out at most `step` bytes per read, to exercise window refills
+class ChunkedSource : public yaml::InputSource {
+public:
+    ChunkedSource(const std::string &text, size_t step) : text_(text), step_(step), pos_(0) {}
+    size_t read(char *buf, size_t n) {
+        n = std::min(std::min(n, step_), text_.size() - pos_);
+        std::memcpy(buf, text_.data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+private:
+    const std::string &text_;
+    size_t step_;
+    size_t pos_;
+};
+
+TEST(stream_parsing) {
+    std::string small = "name: stream\nitems:\n  - 1\n  - two\nflow: {a: [x, y], b: -3.5}\n";
+    ChunkedSource bytewise(small, 1);
+    ASSERT_TRUE(yaml::parseStream(bytewise) == yaml::parse(small));
+
+    // Larger than the scanner window, so consumed input gets discarded
+    std::string big = "entries:\n";
+    for (int i = 0; i < 20000; i++) {
+        big += "  - id: " + std::to_string(i) + "\n    label: entry number " + std::to_string(i) + "\n";
+    }
+    ChunkedSource chunked(big, 4093);
+    yaml::YamlValue streamed = yaml::parseStream(chunked);
+    ASSERT_EQ(streamed["entries"].size(), 20000);
+    ASSERT_EQ(streamed["entries"][19999]["label"].asString(), "entry number 19999");
+    ASSERT_TRUE(streamed == yaml::parse(big));
+
+    // The peak counts the window rather than the whole input
+    yaml::ParseStats stats;
+    yaml::ParseOptions options;
+    options.stats = &stats;
+    ChunkedSource measured(big, 4093);
+    ASSERT_TRUE(yaml::parseStream(measured, options) == streamed);
+    ASSERT_EQ(stats.bytes, big.size());
+    ASSERT_TRUE(stats.peakBytes >= stats.documentBytes);
+    ASSERT_TRUE(stats.peakBytes < stats.documentBytes + big.size() / 4);
+}
+
+TEST(progress_and_cancel) {
+    std::string big = "entries:\n";
+    for (int i = 0; i < 5000; i++) {
+        big += "  - id: " + std::to_string(i) + "\n    label: entry number " + std::to_string(i) + "\n";
+    }
+
+    std::vector<yaml::ParseProgress> calls;
+    yaml::ParseStats stats;
+    yaml::ParseOptions options;
+    options.stats = &stats;
+    options.progressInterval = 16 * 1024;
+    options.progress = [&calls](const yaml::ParseProgress &p) { calls.push_back(p); };
+    ASSERT_EQ(yaml::parse(big, options)["entries"].size(), 5000);
+    ASSERT_TRUE(calls.size() >= big.size() / options.progressInterval);
+    for (size_t i = 1; i < calls.size(); i++) {
+        ASSERT_TRUE(calls[i].bytes > calls[i - 1].bytes);
+        ASSERT_TRUE(calls[i].nodes >= calls[i - 1].nodes);
+    }
+    ASSERT_EQ(calls.back().bytes, big.size());
+    ASSERT_EQ(calls.back().nodes, stats.totalNodes());
+
+    // Cancelled from the progress callback, as another thread would
+    yaml::CancelToken token;
+    options.cancel = &token;
+    options.progress = [&token](const yaml::ParseProgress &) { token.cancel(); };
+    ASSERT_THROWS(yaml::parse(big, options), yaml::ParseCancelled);
+
+    // Streams stop before reading more input
+    ChunkedSource chunked(big, 4096);
+    ASSERT_THROWS(yaml::parseStream(chunked, options), yaml::ParseCancelled);
+    token.reset();
+    options.progress = nullptr;
+    ChunkedSource again(big, 4096);
+    ASSERT_EQ(yaml::parseStream(again, options)["entries"].size(), 5000);
+}
+
+// Rebuilds a document through the pull interface, for comparison with parse()
+static yaml::YamlValue read_value(yaml::Reader &in) {
+    switch (in.peekType()) {
+    case yaml::YamlType::MAPPING: {
+        yaml::YamlValue::Mapping map;
+        std::string key;
+        in.enterMapping();
+        while (in.nextKey(key)) {
+            map[key] = read_value(in);
+        }
+        return yaml::YamlValue(std::move(map));
+    }
+    case yaml::YamlType::SEQUENCE: {
+        yaml::YamlValue::Sequence seq;
+        in.enterSequence();
+        while (in.nextItem()) {
+            seq.push_back(read_value(in));
+        }
+        return yaml::YamlValue(std::move(seq));
+    }
+    case yaml::YamlType::BOOLEAN: {
+        bool b = false;
+        in.read(b);
+        return yaml::YamlValue(b);
+    }
+    case yaml::YamlType::NUMBER: {
+        double d = 0;
+        in.read(d);
+        return yaml::YamlValue(d);
+    }
+    case yaml::YamlType::STRING: {
+        std::string str;
+        in.read(str);
+        return yaml::YamlValue(str);
+    }
+    default:
+        in.skipValue();
+        return yaml::YamlValue();
+    }
+}
+
+TEST(reader_pull) {
+    std::string text =
+        "name: server\n"
+        "ports: [80, 443]\n"
+        "limits:\n"
+        "  cpu: 1.5\n"
+        "  burst: true\n"
+        "pools:\n"
+        "  - name: a\n"
+        "    size: 3\n"
+        "  - {name: b, size: 4}\n"
+        "  -\n"
+        "    - nested\n"
+        "owner: ~\n";
+    yaml::Reader whole(text);
+    ASSERT_TRUE(read_value(whole) == yaml::parse(text));
+
+    yaml::Reader in(text);
+    std::string key;
+    std::string name;
+    double realCpu = 0;
+    std::string owner = "unchanged";
+    ASSERT_TRUE(in.enterMapping());
+    while (in.nextKey(key)) {
+        if (key == "name") {
+            ASSERT_TRUE(in.read(name));
+        } else if (key == "limits") {
+            ASSERT_TRUE(in.enterMapping());
+            while (in.nextKey(key)) {
+                if (key == "cpu") {
+                    ASSERT_TRUE(in.read(realCpu));
+                } else {
+                    in.skipValue();
+                }
+            }
+        } else if (key == "owner") {
+            ASSERT_TRUE(!in.read(owner));
+        } else {
+            in.skipValue();
+        }
+    }
+    ASSERT_EQ(name, "server");
+    ASSERT_EQ(realCpu, 1.5);
+    ASSERT_EQ(owner, "unchanged");
+    ASSERT_TRUE(in.peekType() == yaml::YamlType::NIL);
+
+    std::string sequence = "[1, 2]";
+    yaml::Reader wrong(sequence);
+    ASSERT_THROWS(wrong.enterMapping(), yaml::YamlException);
+    int count = 0;
+    std::string many = "many";
+    yaml::Reader word(many);
+    ASSERT_THROWS(word.read(count), yaml::YamlException);
+    std::string unclosed = "a: [1, 2\n";
+    yaml::Reader broken(unclosed);
+    ASSERT_THROWS(read_value(broken), yaml::YamlException);
+
+    std::string encoded;
+    yaml::appendScalar(encoded, "needs: quotes");
+    encoded += ' ';
+    yaml::appendScalar(encoded, 42.0);
+    ASSERT_EQ(encoded, "\"needs: quotes\" 42");
+
+    // Integers beyond 2^53 are read exactly, as generated encoders write them
+    long long big = 0;
+    std::string exact = "id: " + std::to_string(1234567890123456789LL) + "\nodd: 9007199254740993\n";
+    yaml::Reader ids(exact);
+    ASSERT_TRUE(ids.enterMapping());
+    ASSERT_TRUE(ids.nextKey(key));
+    ASSERT_TRUE(ids.read(big));
+    ASSERT_EQ(big, 1234567890123456789LL);
+    ASSERT_TRUE(ids.nextKey(key));
+    ASSERT_TRUE(ids.read(big));
+    ASSERT_EQ(big, 9007199254740993LL);
+    std::string fraction = "2.5", whole_number = "2.0", overflow = "3000000000";
+    yaml::Reader half(fraction), two(whole_number), tooBig(overflow);
+    ASSERT_THROWS(half.read(count), yaml::YamlException);
+    ASSERT_TRUE(two.read(count));
+    ASSERT_EQ(count, 2);
+    ASSERT_THROWS(tooBig.read(count), yaml::YamlException);
+}
+
+TEST(snapshots) {
+    std::string text =
+        "server:\n"
+        "  host: localhost\n"
+        "  port: 8080\n"
+        "  tls: false\n"
+        "ratio: 0.25\n"
+        "owner: ~\n"
+        "tags: [web, edge, web]\n"
+        "pools:\n"
+        "  - {name: a, size: 3}\n"
+        "  - []\n";
+    yaml::YamlValue value = yaml::parse(text);
+    std::string bytes = yaml::writeSnapshot(value);
+    yaml::SnapshotRef root = yaml::readSnapshot(bytes.data(), bytes.size());
+    ASSERT_TRUE(root.toValue() == value);
+    ASSERT_EQ(root["server"]["port"].asInt(), 8080);
+    ASSERT_EQ(root["server"]["host"].asString(), "localhost");
+    ASSERT_EQ(std::string(root["tags"][2].asCString()), "web");
+    ASSERT_EQ(root["ratio"].asNumber(), 0.25);
+    ASSERT_TRUE(!root["server"]["tls"].asBool());
+    ASSERT_TRUE(root["owner"].isNil());
+    ASSERT_TRUE(root["pools"][1].isSequence() && root["pools"][1].empty());
+    ASSERT_EQ(std::string(root[0].key()), "owner"); // entries in key order
+    ASSERT_TRUE(root.contains("tags") && !root.contains("tag") && !root.contains("tagss"));
+    ASSERT_THROWS(root["missing"], yaml::YamlException);
+    ASSERT_THROWS(root["tags"][3], yaml::YamlException);
+    ASSERT_THROWS(root["ratio"].asString(), yaml::YamlException);
+
+    // Every truncation and any flipped byte is rejected or still reads in bounds
+    for (size_t n = 0; n < bytes.size(); n++) {
+        ASSERT_THROWS(yaml::readSnapshot(bytes.data(), n), yaml::YamlException);
+    }
+    for (size_t i = 4; i < bytes.size(); i++) {
+        std::string bad = bytes;
+        bad[i] = static_cast<char>(bad[i] ^ 0x5a);
+        try {
+            yaml::readSnapshot(bad.data(), bad.size()).toValue();
+        } catch (const yaml::YamlException &) {
+        }
+    }
+
+    static const std::string blob = yaml::writeSnapshot(yaml::parse("level: 3\n"));
+    static const yaml::EmbeddedRegistration registration(
+        "test_defaults", reinterpret_cast<const unsigned char *>(blob.data()), blob.size());
+    ASSERT_EQ(yaml::embedded("test_defaults")["level"].asInt(), 3);
+    std::vector<std::string> names = yaml::embeddedNames();
+    ASSERT_TRUE(std::find(names.begin(), names.end(), "test_defaults") != names.end());
+    ASSERT_THROWS(yaml::embedded("no_such_document"), yaml::YamlException);
+}
+
+#ifdef YAML_HAVE_ZLIB
+TEST(compressed_input) {
+    std::string text = "service: archive\nreplicas: 3\nports: [80, 443]\n";
+    for (int i = 0; i < 5000; i++) {
+        text += "key" + std::to_string(i) + ": value " + std::to_string(i) + "\n";
+    }
+
+    gzFile gz = gzopen("test_input.yaml.gz", "wb");
+    gzwrite(gz, text.data(), static_cast<unsigned>(text.size()));
+    gzclose(gz);
+
+    uLongf zlen = compressBound(text.size());
+    std::string zdata(zlen, '\0');
+    compress2(reinterpret_cast<Bytef *>(&zdata[0]), &zlen,
+              reinterpret_cast<const Bytef *>(text.data()), text.size(), 6);
+    zdata.resize(zlen);
+    write_file("test_input.yaml.z", zdata);
+    write_file("test_input_cut.yaml.z", zdata.substr(0, zdata.size() / 2));
+
+    yaml::YamlValue expected = yaml::parse(text);
+    ASSERT_TRUE(yaml::parseFile("test_input.yaml.gz") == expected);
+    ASSERT_TRUE(yaml::parseFile("test_input.yaml.z") == expected);
+    ASSERT_EQ(yaml::parseFile("test_input.yaml.gz")["key4999"].asString(), "value 4999");
+    ASSERT_THROWS(yaml::parseFile("test_input_cut.yaml.z"), yaml::YamlException);
+
+    // "x^" passes the two-byte zlib header check but does not inflate
+    write_file("test_input_text.yaml", "x^y: 1\nother: two\n");
+    ASSERT_EQ(yaml::parseFile("test_input_text.yaml")["x^y"].asInt(), 1);
+
+    // Zero padding after the gzip member, as tar leaves it
+    std::string padded;
+    {
+        std::ifstream in("test_input.yaml.gz", std::ios::binary);
+        padded.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    write_file("test_input_padded.yaml.gz", padded + std::string(70000, '\0'));
+    ASSERT_TRUE(yaml::parseFile("test_input_padded.yaml.gz") == expected);
+
+    std::vector<std::string> paths(1, "test_input.yaml.gz");
+    std::vector<yaml::LoadedFile> files = yaml::loadFiles(paths);
+    ASSERT_TRUE(files[0].ok);
+    ASSERT_EQ(files[0].value["replicas"].asInt(), 3);
+
+    std::remove("test_input.yaml.gz");
+    std::remove("test_input.yaml.z");
+    std::remove("test_input_cut.yaml.z");
+    std::remove("test_input_text.yaml");
+    std::remove("test_input_padded.yaml.gz");
+}
+#endif
 
 int main()
 {
@@ -396,6 +1314,7 @@ int main()
     RUN_TEST(unquoted_string_with_spaces);
     RUN_TEST(complex_unquoted_strings);
     RUN_TEST(number_vs_string_disambiguation);
+    RUN_TEST(scalar_classification);
     RUN_TEST(quoted_strings);
 
     // Structure tests
@@ -404,6 +1323,7 @@ int main()
     RUN_TEST(nested_mapping);
     RUN_TEST(sequences);
     RUN_TEST(mixed_sequence);
+    RUN_TEST(nested_block_siblings);
     RUN_TEST(flow_mapping);
     RUN_TEST(flow_sequence);
     RUN_TEST(empty_structures);
@@ -413,14 +1333,47 @@ int main()
               << C_BLUE "--- Error Handling Tests ---" C_RESET "\n";
     RUN_TEST(invalid_yaml_throws);
     RUN_TEST(type_conversion_errors);
+#ifdef YAML_CPP17
+    RUN_TEST(cxx17_lookups);
+    RUN_TEST(literal_documents);
+#endif
 
     // Advanced tests
     std::cout << "\n"
               << C_BLUE "--- Advanced Tests ---" C_RESET "\n";
     RUN_TEST(serialization_roundtrip);
+    RUN_TEST(serialization_nested_roundtrip);
+    RUN_TEST(parse_stats);
+    RUN_TEST(parse_memory_limit);
+    RUN_TEST(parse_policies);
+    RUN_TEST(parse_fast_path);
+#ifdef YAML_ALLOC_STATS
+    RUN_TEST(allocation_budget);
+#endif
+#ifdef YAML_ACCESS_PROFILE
+    RUN_TEST(access_profile);
+#endif
     RUN_TEST(memory_stress_test);
     RUN_TEST(performance_test);
 
+    // Loader tests
+    std::cout << "\n"
+              << C_BLUE "--- Loader Tests ---" C_RESET "\n";
+    RUN_TEST(load_files_batch);
+    RUN_TEST(load_tree);
+#ifdef YAML_TRACE
+    RUN_TEST(trace_export);
+#endif
+    RUN_TEST(include_resolution);
+    RUN_TEST(document_tail);
+    RUN_TEST(stream_parsing);
+    RUN_TEST(progress_and_cancel);
+    RUN_TEST(reader_pull);
+    RUN_TEST(snapshots);
+#ifdef YAML_HAVE_ZLIB
+    RUN_TEST(compressed_input);
+#endif
+
     // Final results
     std::cout << "\n"
               << C_MAGENTA "=== FINAL RESULTS ===" C_RESET "\n";
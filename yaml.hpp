@@ -10,6 +10,23 @@
 #include <algorithm>
 #include <iostream>
 #include <cctype>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <functional>
+
+// The exported API is the same at every language level, so the library and
+// its users may be built with different -std flags. Code that is itself
+// built as C++17 also gets inline std::string_view lookups, YAML_LITERAL
+// and an if-constexpr get<T>; a library built as C++17 reads and writes
+// numbers with std::from_chars/to_chars. -DYAML_NO_CPP17 keeps the C++11
+// code paths.
+#if __cplusplus >= 201703L && !defined(YAML_NO_CPP17)
+#define YAML_CPP17 1
+#include <string_view>
+#include <charconv>
+#include <type_traits>
+#endif
 
 namespace yaml
 {
@@ -24,6 +41,30 @@ namespace yaml
             : std::runtime_error(msg), line(ln), column(col) {}
     };
 
+    // Thrown by a parse whose CancelToken was set
+    class ParseCancelled : public YamlException
+    {
+    public:
+        ParseCancelled(int ln = 0, int col = 0) : YamlException("Parse cancelled", ln, col) {}
+    };
+
+    // Set from any thread to stop the parses that were given this token
+    class CancelToken
+    {
+    public:
+        CancelToken() : cancelled_(false) {}
+
+        void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+        void reset() { cancelled_.store(false, std::memory_order_relaxed); }
+        bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<bool> cancelled_;
+
+        CancelToken(const CancelToken &);
+        CancelToken &operator=(const CancelToken &);
+    };
+
     enum class YamlType
     {
         NIL,
@@ -34,10 +75,36 @@ namespace yaml
         MAPPING
     };
 
+    namespace detail
+    {
+        // std::string ordering: bytewise, then the shorter key first
+        inline int compareKeys(const char *a, size_t aLength, const char *b, size_t bLength)
+        {
+            int cmp = std::memcmp(a, b, std::min(aLength, bLength));
+            if (cmp != 0)
+                return cmp;
+            return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+        }
+
+        // Mapping order. Transparent, so from C++14 on a key given as any
+        // type with data() and size() is found without building a std::string.
+        struct KeyLess
+        {
+            typedef void is_transparent;
+
+            bool operator()(const std::string &a, const std::string &b) const { return a < b; }
+            template <typename A, typename B>
+            bool operator()(const A &a, const B &b) const
+            {
+                return compareKeys(a.data(), a.size(), b.data(), b.size()) < 0;
+            }
+        };
+    }
+
     class YamlValue
     {
     public:
-        struct Mapping : public std::map<std::string, YamlValue>
+        struct Mapping : public std::map<std::string, YamlValue, detail::KeyLess>
         {
         };
         struct Sequence : public std::vector<YamlValue>
@@ -62,9 +129,13 @@ namespace yaml
         YamlValue(int value);
         YamlValue(double value);
         YamlValue(const std::string &value);
+        YamlValue(std::string &&value);
         YamlValue(const char *value);
         YamlValue(const Sequence &seq);
         YamlValue(const Mapping &map);
+        // Take over a container without copying its elements
+        YamlValue(Sequence &&seq);
+        YamlValue(Mapping &&map);
 
         // Copy constructor and assignment
         YamlValue(const YamlValue &other);
@@ -96,8 +167,25 @@ namespace yaml
         const Mapping &asMapping() const;
 
         // Template getter
+#ifdef YAML_CPP17
+        template <typename T>
+        T get() const
+        {
+            if constexpr (std::is_same<T, bool>::value)
+                return asBool();
+            else if constexpr (std::is_integral<T>::value)
+                return static_cast<T>(asNumber());
+            else if constexpr (std::is_floating_point<T>::value)
+                return static_cast<T>(asNumber());
+            else if constexpr (std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value)
+                return T(asString());
+            else
+                static_assert(sizeof(T) == 0, "get<T> supports bool, arithmetic and string types");
+        }
+#else
         template <typename T>
         T get() const;
+#endif
 
         // Convenience methods
         size_t size() const;
@@ -113,6 +201,21 @@ namespace yaml
         YamlValue &operator[](size_t index);
         const YamlValue &operator[](size_t index) const;
 
+#ifdef YAML_CPP17
+        // Literals and substrings, looked up without building a std::string.
+        // Inline, so they work against a library built at any level.
+        bool contains(std::string_view key) const { return find_(key.data(), key.size()) != nullptr; }
+        YamlValue &operator[](std::string_view key) { return insert_(key.data(), key.size()); }
+        const YamlValue &operator[](std::string_view key) const { return at_(key.data(), key.size()); }
+        // A string literal converts to both key types; this takes it first
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        bool contains(const C *key) const { return find_(key, std::strlen(key)) != nullptr; }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        YamlValue &operator[](const C *key) { return insert_(key, std::strlen(key)); }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        const YamlValue &operator[](const C *key) const { return at_(key, std::strlen(key)); }
+#endif
+
         // Serialization
         std::string serialize(int indent = 0) const;
 
@@ -124,7 +227,11 @@ namespace yaml
         void cleanup();
         void copyFrom(const YamlValue &other);
         void moveFrom(YamlValue &other);
-        std::string serializeValue(int indent, bool inArray = false) const;
+        void serializeValue(std::ostringstream &oss, int indent, bool inArray = false) const;
+        // Key lookups behind every key overload; find_ is null when missing
+        const YamlValue *find_(const char *key, size_t length) const;
+        const YamlValue &at_(const char *key, size_t length) const;
+        YamlValue &insert_(const char *key, size_t length);
     };
 
     // Token types - Fixed enum
@@ -148,8 +255,7 @@ namespace yaml
         TOKEN_ALIAS,
         TOKEN_EOF,
         TOKEN_ERROR,
-        TOKEN_INDENT,
-        TOKEN_DEDENT
+        TOKEN_TAG
     };
 
     struct Token
@@ -158,55 +264,282 @@ namespace yaml
         std::string value;
         int line;
         int column;
-        int indent;
+        int indent; // the line's indentation on the token that starts it, -1 on the rest
 
         Token();
-        Token(TokenType t, const std::string &val = "", int ln = 0, int col = 0, int ind = 0);
+        Token(TokenType t, std::string val = std::string(), int ln = 0, int col = 0, int ind = -1);
+    };
+
+    namespace detail
+    {
+        // Indentation of the open blocks, innermost last. Parsers compare
+        // the indent of the token that starts a line against it; entering or
+        // leaving a block is a step of its own, taken before that token.
+        class BlockIndents
+        {
+        public:
+            BlockIndents() : levels_(1, 0) {}
+
+            // The line opens a block inside the innermost one
+            bool opens(int indent) const { return indent > levels_.back(); }
+            // The line closes the innermost block
+            bool closes(int indent) const { return indent >= 0 && indent < levels_.back(); }
+            // Neither: not a line start, or level with the innermost block
+            bool inside(int indent) const { return indent < 0 || indent == levels_.back(); }
+
+            // Opens or closes one block towards indent
+            void step(int indent)
+            {
+                if (opens(indent))
+                    levels_.push_back(indent);
+                else
+                    levels_.pop_back();
+            }
+
+            // Whether a line at indent nests deeper or returns to an open block
+            bool aligned(int indent) const
+            {
+                if (indent < 0 || indent >= levels_.back())
+                    return true;
+                return std::find(levels_.begin(), levels_.end(), indent) != levels_.end();
+            }
+
+            size_t heldBytes() const { return levels_.capacity() * sizeof(int); }
+
+        private:
+            std::vector<int> levels_;
+        };
+    }
+
+    // Pull-based byte source for input that is not held in memory at once
+    class InputSource
+    {
+    public:
+        virtual ~InputSource() {}
+        // Copies up to n bytes into buf; returns 0 at end of input
+        virtual size_t read(char *buf, size_t n) = 0;
     };
 
-    class Scanner
+    // Compile-time feature sets for BasicScanner and BasicParser. A feature
+    // that is switched off is folded out of the scanner loop. Derive from
+    // DefaultPolicy and hide the flags to change:
+    //
+    //   struct NoComments : yaml::DefaultPolicy { static const bool comments = false; };
+    struct DefaultPolicy
+    {
+        static const bool comments = true;           // '#' starts a comment; off: it is text
+        static const bool flowCollections = true;    // [ ] { } , are structural; off: text
+        static const bool quotedEscapes = true;      // backslash escapes in quotes; off: kept as written
+        static const bool positions = true;          // line and column in tokens and errors; off: 0
+        static const bool numbers = true;            // numeric scalars become numbers; off: strings
+        static const bool duplicateKeyCheck = false; // a repeated key throws; off: the last one wins
+    };
+
+    // Machine-written block YAML: no comments, flow collections, escapes or
+    // position tracking
+    struct CompactPolicy : DefaultPolicy
+    {
+        static const bool comments = false;
+        static const bool flowCollections = false;
+        static const bool quotedEscapes = false;
+        static const bool positions = false;
+    };
+
+    // Hand-edited configs where a repeated key is a mistake
+    struct StrictPolicy : DefaultPolicy
+    {
+        static const bool duplicateKeyCheck = true;
+    };
+
+    template <typename Policy>
+    class BasicScanner
     {
     public:
-        explicit Scanner(const std::string &src);
+        explicit BasicScanner(const std::string &src);
+        // Scans through a sliding window refilled from source
+        explicit BasicScanner(InputSource &source);
         Token next();
 
+        // Input bytes consumed so far
+        size_t offset() const { return base_ + cur_; }
+        // Heap held by the stream window
+        size_t heldBytes() const;
+        // Checked before each read from the source; throws ParseCancelled
+        void setCancel(const CancelToken *cancel) { cancel_ = cancel; }
+
     private:
-        const std::string &s_;
+        const std::string *s_; // the whole input, or window_ when streaming
+        std::string window_;
+        InputSource *source_;
+        const CancelToken *cancel_;
+        size_t base_; // bytes dropped from the front of window_
         size_t cur_;
         int line_;
         int col_;
         bool bol_;
-        std::vector<int> indents_;
-        std::vector<Token> pending_;
+        int lineIndent_; // for the next token; -1 once the line's first token is out
 
         // helpers
-        bool isAtEnd_() const;
-        char peek_() const;
-        char peekNext_() const;
+        bool fill_();
+        bool isAtEnd_();
+        char peek_();
+        char peekNext_();
         char advance_();
         void skipToEOL_();
         int measureIndent_();
-        void emitIndentChange_(int spaces);
-        static bool isSpace_(char c);
-        static bool isDigit_(char c);
-        static bool isAlpha_(char c);
-        static bool isAlnum_(char c);
-        Token make_(TokenType t, const std::string &v = "");
+        Token make_(TokenType t, std::string v = std::string());
+        // Position for tokens and errors; 0 when the policy does not track it
+        int posLine_() const { return Policy::positions ? line_ : 0; }
+        int posCol_() const { return Policy::positions ? col_ : 0; }
 
         static int countSpaces_(const std::string &s, size_t pos, size_t &outPos);
+
+        // s_ may point at window_
+        BasicScanner(const BasicScanner &);
+        BasicScanner &operator=(const BasicScanner &);
+    };
+
+    typedef BasicScanner<DefaultPolicy> Scanner;
+
+    // One step of the route from a document root to a node
+    struct PathStep
+    {
+        bool isIndex;
+        size_t index;
+        std::string key;
+
+        PathStep() : isIndex(false), index(0) {}
+    };
+
+    // A `!include target` node found while parsing
+    struct IncludeSite
+    {
+        std::vector<PathStep> path;
+        std::string target;
+    };
+
+    // Shape and cost of one parse; see parse(src, stats)
+    struct ParseStats
+    {
+        static const int TOKEN_TYPES = static_cast<int>(TokenType::TOKEN_TAG) + 1;
+        static const int NODE_TYPES = static_cast<int>(YamlType::MAPPING) + 1;
+
+        size_t bytes;                // input size
+        size_t tokens[TOKEN_TYPES];  // indexed by TokenType
+        size_t nodes[NODE_TYPES];    // indexed by YamlType, root included
+        size_t maxDepth;             // root is depth 1
+        size_t maxMappingWidth;      // most keys in one mapping
+        double scanMs;               // inside the scanner
+        double buildMs;              // parsing and tree building, excluding scanMs
+        size_t documentBytes;        // estimated heap + inline size of the result
+        size_t peakBytes;            // high-water mark of the bytes tracked while parsing
+
+        ParseStats();
+
+        size_t tokenCount(TokenType t) const { return tokens[static_cast<int>(t)]; }
+        size_t nodeCount(YamlType t) const { return nodes[static_cast<int>(t)]; }
+        size_t totalTokens() const;
+        size_t totalNodes() const;
+    };
+
+    struct ParseProgress
+    {
+        size_t bytes; // input consumed
+        size_t nodes; // values built, containers included
     };
 
-    class Parser
+    // Per-parse limits and instrumentation; see parse(src, options)
+    struct ParseOptions
+    {
+        // Soft cap on tracked bytes: the input string (or the stream window),
+        // tokens in flight, the tree built so far and the builders' temporaries
+        // such as keys and growing containers. Exceeding it throws
+        // YamlException and releases everything built. 0 = no limit.
+        size_t memoryLimit;
+        ParseStats *stats; // optional, filled as by parse(src, stats)
+
+        // Called from the parsing thread each time another progressInterval
+        // bytes are consumed, and once at the end. May throw to abort.
+        std::function<void(const ParseProgress &)> progress;
+        size_t progressInterval;
+        // Polled per token and per stream read; once set, the parse throws
+        // ParseCancelled
+        const CancelToken *cancel;
+
+        ParseOptions() : memoryLimit(0), stats(nullptr), progressInterval(1 << 20), cancel(nullptr) {}
+    };
+
+    template <typename Policy>
+    class BasicParser
     {
     public:
-        explicit Parser(const std::string &src);
+        explicit BasicParser(const std::string &src);
+        explicit BasicParser(InputSource &source);
         YamlValue parse();
 
+        // Collect `!include` nodes into sites; they parse as their target string
+        void recordIncludes(std::vector<IncludeSite> *sites) { includes_ = sites; }
+
+        // Count tokens and time the scanner into stats during parse()
+        void collectStats(ParseStats *stats);
+        // Enforce options.memoryLimit, collect options.stats and report
+        // progress and cancellation during parse()
+        void applyOptions(const ParseOptions &options);
+
+        // Input bytes consumed so far
+        size_t offset() const { return sc_.offset(); }
+        // Values built so far
+        size_t nodesBuilt() const { return nodes_; }
+        // Highest tracked byte count so far; 0 unless memory is tracked
+        size_t peakBytes() const { return peakBytes_; }
+
     private:
-        Scanner sc_;
+        BasicScanner<Policy> sc_;
         Token cur_, nxt_;
+        std::vector<IncludeSite> *includes_;
+        ParseStats *stats_;
+        std::vector<PathStep> path_;
+
+        // Memory tracking, on while a limit is set or stats are collected
+        bool trackMemory_;
+        size_t memoryLimit_;
+        size_t inputBytes_;     // the caller's string; 0 when streaming
+        size_t transientBytes_; // scanner buffers and the two tokens in flight
+        size_t treeBytes_;      // nodes built so far plus builder temporaries
+        size_t peakBytes_;
+
+        void charge_(size_t bytes);
+        void release_(size_t bytes);
+        void trackTransient_();
+        void append_(YamlValue::Sequence &seq, YamlValue &&value);
+        void insert_(YamlValue::Mapping &map, std::string &&key, YamlValue &&value);
+        // Throws if the key token repeats a key of map (Policy::duplicateKeyCheck)
+        void checkKey_(const YamlValue::Mapping &map);
+
+        // Progress and cancellation, polled from advance_ while watched_
+        bool watched_;
+        const CancelToken *cancel_;
+        std::function<void(const ParseProgress &)> progress_;
+        size_t progressInterval_;
+        size_t nextProgress_;
+        size_t nodes_;
+
+        void poll_();
+
+        void pushKey_(const std::string &key);
+        void pushIndex_(size_t index);
+        void popPath_();
+
+        // Block structure, from the indent of each line's first token
+        detail::BlockIndents indents_;
+        bool opensBlock_() const { return indents_.opens(cur_.indent); }
+        bool closesBlock_() const { return indents_.closes(cur_.indent); }
+        // cur_ is a t, with every block step before it taken
+        bool at_(TokenType t) const { return cur_.type == t && indents_.inside(cur_.indent); }
+        bool isKey_() const { return at_(TokenType::TOKEN_STRING) && nxt_.type == TokenType::TOKEN_COLON; }
 
         void advance_();
+        void checkIndent_();
         bool match_(TokenType t);
         void expect_(TokenType t, const char *msg);
 
@@ -214,12 +547,130 @@ namespace yaml
         YamlValue parseFlowSeq_();
         YamlValue parseFlowMap_();
         YamlValue parseScalar_();
-        YamlValue parseMapping_();
+        YamlValue parseMapping_(bool afterDash = false);
         YamlValue parseSequence_();
     };
 
-    inline YamlValue parse(const std::string &s) { return Parser(s).parse(); }
+    typedef BasicParser<DefaultPolicy> Parser;
+
+    // Instantiated in yaml.cpp. Other policies need the definitions: build
+    // yaml_single.hpp with YAML_IMPLEMENTATION in one file and instantiate
+    // there with `template class yaml::BasicParser<MyPolicy>;` (and the same
+    // for BasicScanner), declaring them extern template elsewhere.
+    extern template class BasicScanner<DefaultPolicy>;
+    extern template class BasicParser<DefaultPolicy>;
+    extern template class BasicScanner<CompactPolicy>;
+    extern template class BasicParser<CompactPolicy>;
+    extern template class BasicScanner<StrictPolicy>;
+    extern template class BasicParser<StrictPolicy>;
+
+    // Block-only documents take a fast path that mirrors Parser without its
+    // token queue and bookkeeping. Flow collections, tags and errors fall
+    // back to Parser, so the result and any exception are the same.
+    YamlValue parse(const std::string &s);
+
+    // parse(s) with the features of Policy, e.g. parse<CompactPolicy>(s)
+    template <typename Policy>
+    YamlValue parse(const std::string &s)
+    {
+        return BasicParser<Policy>(s).parse();
+    }
+
+    // As parse(s), also filling *stats (reset first). A null stats pointer
+    // takes the plain parse path.
+    YamlValue parse(const std::string &s, ParseStats *stats);
+
+    // Streams the input through the scanner window. gzip and zlib input
+    // (YAML_HAVE_ZLIB) and zstd input (YAML_HAVE_ZSTD) are detected from
+    // their magic bytes and decompressed chunk by chunk.
+    YamlValue parseStream(InputSource &source);
+    YamlValue parseFile(const std::string &path);
+
+    // As above, with the limits and instrumentation in options
+    YamlValue parse(const std::string &s, const ParseOptions &options);
+    YamlValue parseStream(InputSource &source, const ParseOptions &options);
+    YamlValue parseFile(const std::string &path, const ParseOptions &options);
+
+    // Pull access to the token stream with Parser's grammar, for decoders
+    // that fill their own types without building YamlValues (yaml2cpp
+    // generates these). Every read consumes one whole value.
+    class Reader
+    {
+    public:
+        // src is read in place and must outlive the Reader
+        explicit Reader(const std::string &src);
+        explicit Reader(InputSource &source);
+
+        // Type of the next value; NIL also for an empty document
+        YamlType peekType();
+
+        // Open the next value; false, with the value consumed, when it is null
+        bool enterMapping();
+        bool enterSequence();
+        // Next key of the innermost open mapping, whose value is read next;
+        // false once the mapping is closed
+        bool nextKey(std::string &key);
+        // Whether the innermost open sequence has another item; false once
+        // the sequence is closed
+        bool nextItem();
+
+        // Scalars. A null leaves out unchanged and returns false; any other
+        // type throws YamlException, as does a fraction or an out-of-range
+        // value read into an integer.
+        bool read(bool &out);
+        bool read(double &out);
+        bool read(int &out);
+        bool read(long long &out);
+        bool read(std::string &out);
+
+        void skipValue();
+
+    private:
+        struct Frame
+        {
+            bool mapping;
+            bool flow;
+            bool afterDash;  // block mapping that started on a "- " line
+            bool ownsBlock;  // ...and opened the block of its second key
+            bool first;
+            int blocks;      // blocks opened before the value
+        };
+
+        Scanner sc_;
+        Token cur_;
+        Token nxt_;
+        detail::BlockIndents indents_;
+        std::vector<Frame> frames_;
+        bool dashMapping_; // the item just opened is a mapping on its dash line
+        bool opened_;      // prelude of the next value already consumed
+        bool openAfterDash_;
+        int openBlocks_;
+
+        Reader(const Reader &);
+        Reader &operator=(const Reader &);
+        Reader(std::string &&); // a temporary would be gone before the first read
+
+        void start_();
+        void advance_();
+        void expect_(TokenType t, const char *msg);
+        void fail_(const char *msg);
+        void prepare_();
+        int take_();
+        void close_(int blocks);
+        bool opensBlock_() const { return indents_.opens(cur_.indent); }
+        bool closesBlock_() const { return indents_.closes(cur_.indent); }
+        bool at_(TokenType t) const { return cur_.type == t && indents_.inside(cur_.indent); }
+        bool isKey_() const;
+        bool scalar_(TokenType t, const char *msg, int &blocks);
+        bool readInteger_(long long &out, long long min, long long max);
+    };
+
+    // Appends a scalar spelled as serialize() spells it, for encoders that
+    // write YAML text directly
+    void appendScalar(std::string &out, const std::string &value);
+    void appendScalar(std::string &out, double value);
 
+#ifndef YAML_CPP17
     // Template specializations for get<T>
     template <>
     inline bool YamlValue::get<bool>() const { return asBool(); }
@@ -229,6 +680,1060 @@ namespace yaml
     inline double YamlValue::get<double>() const { return asNumber(); }
     template <>
     inline std::string YamlValue::get<std::string>() const { return asString(); }
+#endif
+
+    // Batched file loading
+    struct LoadOptions
+    {
+        unsigned threads; // parser threads, 0 = hardware concurrency
+        size_t batchSize; // files per io_uring submission batch
+        bool useIoUring;  // false forces the thread pool reader
+        bool resolveIncludes; // replace `!include path` nodes with the parsed file
+
+        LoadOptions() : threads(0), batchSize(64), useIoUring(true), resolveIncludes(false) {}
+    };
+
+    struct LoadedFile
+    {
+        std::string path;
+        YamlValue value;
+        bool ok;
+        std::string error;
+        int line;
+        int column;
+        size_t bytes;
+        double readMs;
+        double parseMs;
+        std::vector<IncludeSite> includes; // filled when includes are resolved
+
+        LoadedFile() : ok(false), line(0), column(0), bytes(0), readMs(0), parseMs(0) {}
+    };
+
+    // Reads and parses every path; results keep the order of `paths`.
+    // Errors are reported per file instead of being thrown.
+    std::vector<LoadedFile> loadFiles(const std::vector<std::string> &paths,
+                                      const LoadOptions &options = LoadOptions());
+
+    // Drops every fragment cached by include resolution
+    void clearIncludeCache();
+
+    // Directory tree loading
+    enum class MergePolicy
+    {
+        BY_PATH,   // root["sub/file.yaml"] = document
+        DEEP_MERGE // mappings merged recursively, later files (by path order) win;
+                   // empty files are skipped, other non-mapping roots are file errors
+    };
+
+    struct TreeOptions : public LoadOptions
+    {
+        MergePolicy merge;
+
+        TreeOptions() : merge(MergePolicy::BY_PATH) {}
+    };
+
+    struct TreeResult
+    {
+        YamlValue root;
+        std::vector<LoadedFile> files; // relative paths; values are moved into root
+        double discoverMs;
+        double mergeMs;
+
+        TreeResult() : discoverMs(0), mergeMs(0) {}
+    };
+
+    // Recursively finds *.yaml / *.yml under dir, parses them in parallel and
+    // assembles one document. Throws YamlException if dir cannot be opened.
+    TreeResult loadTree(const std::string &dir, const TreeOptions &options = TreeOptions());
+
+    // Merges src into dst: mappings key by key, anything else is replaced
+    void deepMerge(YamlValue &dst, YamlValue &&src);
+
+    // Follows an append-only file of `---` separated documents. A document is
+    // handed out once the next separator (`---` or `...`) has been written.
+    // Bytes before offset() are never read again.
+    class DocumentTail
+    {
+    public:
+        // offset: value previously returned by offset(), 0 for a new log
+        explicit DocumentTail(const std::string &path, uint64_t offset = 0);
+        ~DocumentTail();
+
+        // Appends documents completed since the last call to out. When none
+        // are ready, waits up to timeoutMs for the file to grow (inotify on
+        // Linux, polling elsewhere). Returns the number of documents added.
+        // A malformed document is skipped and reported as YamlException.
+        size_t poll(std::vector<YamlValue> &out, int timeoutMs = 0);
+
+        // Parses the unterminated last document, for when the writer is done
+        size_t flush(std::vector<YamlValue> &out);
+
+        // File offset of the first byte not yet handed out; persist to resume
+        uint64_t offset() const { return base_ + docStart_; }
+
+    private:
+        std::string path_;
+        int fd_;
+        int watch_;
+        uint64_t base_;     // file offset of buffer_[0]
+        uint64_t readPos_;  // file offset of the next byte to read
+        std::string buffer_;
+        size_t docStart_;   // start of the pending document in buffer_
+        size_t scanPos_;    // first line in buffer_ not yet checked for a separator
+
+        DocumentTail(const DocumentTail &);
+        DocumentTail &operator=(const DocumentTail &);
+
+        bool readAvailable_();
+        void waitForData_(int timeoutMs);
+        size_t extract_(std::vector<YamlValue> &out);
+        bool emit_(size_t end, std::vector<YamlValue> &out);
+    };
+
+    // Text of each non-empty document of a "---" separated stream, split as
+    // DocumentTail splits it; parse() reads one document only
+    std::vector<std::string> splitDocuments(const std::string &text);
+
+    // Snapshots: a parsed document flattened into one position-independent
+    // byte block that is read in place, with no parsing and no allocation.
+    // The layout is a 12-byte header ("YSN1", node count, string bytes), a
+    // table of 20-byte little-endian nodes in breadth-first order, so the
+    // children of a container are contiguous, then the NUL-terminated string
+    // pool. Mapping entries keep YamlValue's key order and are found by
+    // binary search.
+    std::string writeSnapshot(const YamlValue &value);
+
+    // Read-only view of one node of a snapshot; the bytes must outlive it
+    class SnapshotRef
+    {
+    public:
+        SnapshotRef() : nodes_(nullptr), pool_(nullptr), index_(0) {}
+
+        YamlType getType() const;
+        bool isNil() const { return getType() == YamlType::NIL; }
+        bool isBool() const { return getType() == YamlType::BOOLEAN; }
+        bool isNumber() const { return getType() == YamlType::NUMBER; }
+        bool isString() const { return getType() == YamlType::STRING; }
+        bool isSequence() const { return getType() == YamlType::SEQUENCE; }
+        bool isMapping() const { return getType() == YamlType::MAPPING; }
+
+        bool asBool() const;
+        double asNumber() const;
+        int asInt() const { return static_cast<int>(asNumber()); }
+        std::string asString() const;
+        // The string in place, NUL-terminated
+        const char *asCString() const;
+
+        // Children of a container; 0 for scalars
+        size_t size() const;
+        bool empty() const { return size() == 0; }
+        bool contains(const std::string &key) const;
+        // Key of a mapping entry reached by index, "" otherwise
+        const char *key() const;
+
+        SnapshotRef operator[](const std::string &key) const;
+        // Sequence items, or mapping entries in key order
+        SnapshotRef operator[](size_t index) const;
+
+#ifdef YAML_CPP17
+        bool contains(std::string_view key) const { return has_(key.data(), key.size()); }
+        SnapshotRef operator[](std::string_view key) const { return at_(key.data(), key.size()); }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        bool contains(const C *key) const { return has_(key, std::strlen(key)); }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        SnapshotRef operator[](const C *key) const { return at_(key, std::strlen(key)); }
+#endif
+
+        YamlValue toValue() const;
+
+    private:
+        const unsigned char *nodes_;
+        const char *pool_;
+        uint32_t index_;
+
+        SnapshotRef(const unsigned char *nodes, const char *pool, uint32_t index)
+            : nodes_(nodes), pool_(pool), index_(index) {}
+
+        uint32_t field_(int i) const;
+        bool find_(const char *key, size_t length, uint32_t &child) const;
+        bool has_(const char *key, size_t length) const;
+        SnapshotRef at_(const char *key, size_t length) const;
+
+        friend SnapshotRef readSnapshot(const void *data, size_t size);
+        friend SnapshotRef embedded(const std::string &name);
+    };
+
+    // Root of a snapshot. Checks the header and every node's ranges, so
+    // untrusted bytes are safe to read; throws YamlException if they are not
+    // a snapshot.
+    SnapshotRef readSnapshot(const void *data, size_t size);
+
+    // Snapshots linked into the executable. yaml_embed generates a source
+    // file whose static EmbeddedRegistration adds each document at startup;
+    // embedded() then returns its root without copying. The bytes come from
+    // writeSnapshot at build time, so only the header is checked. Throws
+    // YamlException for an unknown name.
+    struct EmbeddedRegistration
+    {
+        EmbeddedRegistration(const char *name, const unsigned char *data, size_t size);
+    };
+
+    SnapshotRef embedded(const std::string &name);
+    std::vector<std::string> embeddedNames();
+
+#ifdef YAML_CPP17
+    // Compile-time documents. YAML_LITERAL parses a string literal with a
+    // constexpr parser into a fixed array of nodes; declared static or at
+    // namespace scope, lookups on it are constant expressions:
+    //
+    //   static constexpr auto cfg = YAML_LITERAL("server:\n  port: 8080\n");
+    //   static_assert(cfg["server"]["port"].asInt() == 8080, "");
+    //
+    // The grammar is the one parse() accepts minus anchors, aliases and
+    // block scalars. Syntax errors, type mismatches and missing keys stop the
+    // compilation at a call to detail::literalError, or throw YamlException
+    // when reached at runtime.
+    struct LiteralNode
+    {
+        YamlType type = YamlType::NIL;
+        bool boolean = false;
+        double number = 0;
+        uint32_t key = 0, keyLength = 0;   // mapping entries: the key in chars
+        uint32_t text = 0, textLength = 0; // strings: the value in chars
+        uint32_t firstChild = 0;           // containers; the root is never a child
+        uint32_t nextSibling = 0;
+        uint32_t size = 0;
+    };
+
+    namespace detail
+    {
+        // Not constexpr, so reaching it during constant evaluation is a
+        // compile error that names the call
+        inline void literalError(const char *what)
+        {
+            throw YamlException(std::string("YAML literal: ") + what);
+        }
+
+        class LiteralParser
+        {
+        public:
+            // nodes/chars null: only count the nodes, for sizing the document
+            constexpr LiteralParser(std::string_view src, LiteralNode *nodes, size_t nodeCapacity, char *chars,
+                                    size_t charCapacity)
+                : src_(src), nodes_(nodes), chars_(chars), nodeCapacity_(nodeCapacity),
+                  charCapacity_(charCapacity), pos_(0), lineStart_(0), count_(0), used_(0) {}
+
+            constexpr void parseDocument()
+            {
+                int indent = nextLine_();
+                if (indent < 0)
+                {
+                    node_(YamlType::NIL);
+                    return;
+                }
+                parseBlock_(indent);
+                if (nextLine_() >= 0)
+                    literalError("unexpected text after the document");
+            }
+
+            constexpr uint32_t count() const { return count_; }
+
+        private:
+            struct Span
+            {
+                uint32_t offset;
+                uint32_t length;
+            };
+
+            std::string_view src_;
+            LiteralNode *nodes_;
+            char *chars_;
+            size_t nodeCapacity_;
+            size_t charCapacity_;
+            size_t pos_;
+            size_t lineStart_;
+            uint32_t count_;
+            uint32_t used_;
+
+            static constexpr bool isBlank_(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+            constexpr bool atEnd_() const { return pos_ >= src_.size(); }
+            constexpr char peek_(size_t ahead = 0) const
+            {
+                return pos_ + ahead < src_.size() ? src_[pos_ + ahead] : '\0';
+            }
+            constexpr bool isDash_() const
+            {
+                char next = peek_(1);
+                return peek_() == '-' && (next == '\0' || next == '\n' || isBlank_(next));
+            }
+            constexpr bool atLineEnd_() const { return atEnd_() || peek_() == '\n' || peek_() == '#'; }
+
+            constexpr void skipBlanks_()
+            {
+                while (!atEnd_() && isBlank_(peek_()))
+                    pos_++;
+            }
+
+            constexpr void skipComment_()
+            {
+                while (!atEnd_() && peek_() != '\n')
+                    pos_++;
+            }
+
+            // Moves to the first character of the next line with content and
+            // returns its column, or -1 at the end. A no-op when already there.
+            constexpr int nextLine_()
+            {
+                for (;;)
+                {
+                    skipBlanks_();
+                    if (atEnd_())
+                        return -1;
+                    if (peek_() == '#')
+                        skipComment_();
+                    else if (peek_() == '\n')
+                        lineStart_ = ++pos_;
+                    else
+                        return static_cast<int>(pos_ - lineStart_);
+                }
+            }
+
+            // Blanks, newlines and comments inside [...] and {...}
+            constexpr void skipFlowSpace_()
+            {
+                for (;;)
+                {
+                    skipBlanks_();
+                    if (peek_() == '#')
+                        skipComment_();
+                    else if (peek_() == '\n')
+                        lineStart_ = ++pos_;
+                    else
+                        return;
+                }
+            }
+
+            constexpr void finishLine_()
+            {
+                skipBlanks_();
+                if (peek_() == '#')
+                    skipComment_();
+                if (!atEnd_() && peek_() != '\n')
+                    literalError("unexpected text after a value");
+            }
+
+            constexpr uint32_t node_(YamlType type)
+            {
+                uint32_t index = count_++;
+                if (nodes_ && index >= nodeCapacity_)
+                    literalError("more nodes than the document holds");
+                if (nodes_)
+                    nodes_[index].type = type;
+                return index;
+            }
+
+            constexpr void put_(char c)
+            {
+                if (chars_ && used_ >= charCapacity_)
+                    literalError("more text than the document holds");
+                if (chars_)
+                    chars_[used_] = c;
+                used_++;
+            }
+
+            constexpr Span copy_(size_t begin, size_t end)
+            {
+                Span span{used_, static_cast<uint32_t>(end - begin)};
+                for (size_t i = begin; i < end; ++i)
+                    put_(src_[i]);
+                return span;
+            }
+
+            constexpr std::string_view text_(uint32_t offset, uint32_t length) const
+            {
+                return std::string_view(chars_ + offset, length);
+            }
+
+            // Same escapes as the runtime scanner, for both quote styles
+            constexpr Span quoted_()
+            {
+                char quote = src_[pos_++];
+                Span span{used_, 0};
+                while (!atEnd_() && peek_() != quote)
+                {
+                    char c = src_[pos_++];
+                    if (c == '\\' && !atEnd_())
+                    {
+                        c = src_[pos_++];
+                        c = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+                    }
+                    else if (c == '\n')
+                    {
+                        lineStart_ = pos_;
+                    }
+                    put_(c);
+                }
+                if (atEnd_())
+                    literalError("unterminated quoted string");
+                pos_++;
+                span.length = used_ - span.offset;
+                return span;
+            }
+
+            constexpr bool keyEnd_(bool flow) const
+            {
+                char next = peek_(1);
+                return peek_() == ':' && (next == '\0' || next == '\n' || isBlank_(next) ||
+                                          (flow && (next == ',' || next == '}' || next == ']')));
+            }
+
+            // Whether the current line holds "key:" rather than a bare value
+            constexpr bool isKeyAhead_() const
+            {
+                LiteralParser probe(*this);
+                probe.nodes_ = nullptr;
+                probe.chars_ = nullptr;
+                char c = probe.peek_();
+                if (c == '[' || c == '{')
+                    return false;
+                if (c == '"' || c == '\'')
+                {
+                    probe.quoted_();
+                    probe.skipBlanks_();
+                    return probe.keyEnd_(false);
+                }
+                while (!probe.atEnd_() && probe.peek_() != '\n')
+                {
+                    if (probe.keyEnd_(false))
+                        return true;
+                    if (probe.peek_() == '#' && probe.pos_ > 0 && isBlank_(probe.src_[probe.pos_ - 1]))
+                        return false;
+                    probe.pos_++;
+                }
+                return false;
+            }
+
+            // Consumes "key:" and leaves pos_ after the colon
+            constexpr Span key_(bool flow)
+            {
+                Span key{used_, 0};
+                if (peek_() == '"' || peek_() == '\'')
+                {
+                    key = quoted_();
+                    skipBlanks_();
+                }
+                else
+                {
+                    size_t begin = pos_;
+                    while (!atEnd_() && peek_() != '\n' && !keyEnd_(flow) &&
+                           !(flow && (peek_() == ',' || peek_() == '}')))
+                        pos_++;
+                    size_t end = pos_;
+                    while (end > begin && isBlank_(src_[end - 1]))
+                        end--;
+                    key = copy_(begin, end);
+                }
+                if (peek_() != ':')
+                    literalError("expected ':' after a mapping key");
+                pos_++;
+                return key;
+            }
+
+            constexpr void addChild_(uint32_t parent, uint32_t &last, uint32_t child)
+            {
+                if (!nodes_)
+                    return;
+                if (nodes_[parent].size == 0)
+                    nodes_[parent].firstChild = child;
+                else
+                    nodes_[last].nextSibling = child;
+                nodes_[parent].size++;
+                last = child;
+            }
+
+            constexpr void addEntry_(uint32_t map, uint32_t &last, Span key, uint32_t child)
+            {
+                if (!nodes_)
+                    return;
+                std::string_view name = text_(key.offset, key.length);
+                uint32_t sibling = nodes_[map].firstChild;
+                for (uint32_t i = 0; i < nodes_[map].size; ++i, sibling = nodes_[sibling].nextSibling)
+                {
+                    if (text_(nodes_[sibling].key, nodes_[sibling].keyLength) == name)
+                        literalError("duplicate mapping key");
+                }
+                nodes_[child].key = key.offset;
+                nodes_[child].keyLength = key.length;
+                addChild_(map, last, child);
+            }
+
+            static constexpr double number_(std::string_view text)
+            {
+                bool negative = text[0] == '-';
+                uint64_t mantissa = 0;
+                int digits = 0;
+                int fraction = -1; // digits after the point, once seen
+                double approx = 0;
+                for (size_t i = negative ? 1 : 0; i < text.size(); ++i)
+                {
+                    if (text[i] == '.')
+                    {
+                        fraction = 0;
+                        continue;
+                    }
+                    if (digits < 19)
+                        mantissa = mantissa * 10 + static_cast<uint64_t>(text[i] - '0');
+                    approx = approx * 10 + (text[i] - '0');
+                    digits++;
+                    if (fraction >= 0)
+                        fraction++;
+                }
+                // Exact below 2^53 with at most 22 fraction digits, as 10^22
+                // is the largest exact power of ten
+                double value = digits < 19 ? static_cast<double>(mantissa) : approx;
+                double scale = 1;
+                for (int i = 0; i < fraction; ++i)
+                    scale *= 10;
+                value /= scale;
+                return negative ? -value : value;
+            }
+
+            static constexpr bool isNumber_(std::string_view text)
+            {
+                size_t i = (!text.empty() && text[0] == '-') ? 1 : 0;
+                size_t start = i;
+                while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+                    i++;
+                if (i == start)
+                    return false;
+                if (i < text.size() && text[i] == '.')
+                {
+                    size_t point = ++i;
+                    while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+                        i++;
+                    if (i == point)
+                        return false;
+                }
+                return i == text.size();
+            }
+
+            constexpr uint32_t plain_(bool flow)
+            {
+                size_t begin = pos_;
+                while (!atEnd_() && peek_() != '\n')
+                {
+                    char c = peek_();
+                    if (c == '#' && pos_ > begin && isBlank_(src_[pos_ - 1]))
+                        break;
+                    if (flow && (c == ',' || c == ']' || c == '}' || keyEnd_(true)))
+                        break;
+                    pos_++;
+                }
+                size_t end = pos_;
+                while (end > begin && isBlank_(src_[end - 1]))
+                    end--;
+                std::string_view text = src_.substr(begin, end - begin);
+                if (text.empty())
+                    literalError("expected a value");
+
+                if (text == "null" || text == "~")
+                    return node_(YamlType::NIL);
+                if (text == "true" || text == "false")
+                {
+                    uint32_t index = node_(YamlType::BOOLEAN);
+                    if (nodes_)
+                        nodes_[index].boolean = (text == "true");
+                    return index;
+                }
+                if (isNumber_(text))
+                {
+                    uint32_t index = node_(YamlType::NUMBER);
+                    if (nodes_)
+                        nodes_[index].number = number_(text);
+                    return index;
+                }
+                uint32_t index = node_(YamlType::STRING);
+                Span span = copy_(begin, end);
+                if (nodes_)
+                {
+                    nodes_[index].text = span.offset;
+                    nodes_[index].textLength = span.length;
+                }
+                return index;
+            }
+
+            constexpr uint32_t flowSequence_()
+            {
+                uint32_t seq = node_(YamlType::SEQUENCE);
+                uint32_t last = 0;
+                pos_++; // '['
+                skipFlowSpace_();
+                while (peek_() != ']')
+                {
+                    addChild_(seq, last, inline_(true));
+                    skipFlowSpace_();
+                    if (peek_() == ',')
+                    {
+                        pos_++;
+                        skipFlowSpace_();
+                    }
+                    else if (peek_() != ']')
+                    {
+                        literalError("expected ',' or ']'");
+                    }
+                }
+                pos_++;
+                return seq;
+            }
+
+            constexpr uint32_t flowMapping_()
+            {
+                uint32_t map = node_(YamlType::MAPPING);
+                uint32_t last = 0;
+                pos_++; // '{'
+                skipFlowSpace_();
+                while (peek_() != '}')
+                {
+                    if (atEnd_())
+                        literalError("expected '}'");
+                    Span key = key_(true);
+                    skipFlowSpace_();
+                    addEntry_(map, last, key, inline_(true));
+                    skipFlowSpace_();
+                    if (peek_() == ',')
+                    {
+                        pos_++;
+                        skipFlowSpace_();
+                    }
+                    else if (peek_() != '}')
+                    {
+                        literalError("expected ',' or '}'");
+                    }
+                }
+                pos_++;
+                return map;
+            }
+
+            // A scalar or flow collection
+            constexpr uint32_t inline_(bool flow)
+            {
+                if (flow)
+                    skipFlowSpace_();
+                switch (peek_())
+                {
+                case '[':
+                    return flowSequence_();
+                case '{':
+                    return flowMapping_();
+                case '"':
+                case '\'':
+                {
+                    uint32_t index = node_(YamlType::STRING);
+                    Span span = quoted_();
+                    if (nodes_)
+                    {
+                        nodes_[index].text = span.offset;
+                        nodes_[index].textLength = span.length;
+                    }
+                    return index;
+                }
+                case '!': // tags are accepted and ignored, as by parse()
+                    while (!atEnd_() && !isBlank_(peek_()) && peek_() != '\n')
+                        pos_++;
+                    skipBlanks_();
+                    return inline_(flow);
+                case '&':
+                case '*':
+                    literalError("anchors and aliases are not supported in literals");
+                    return 0;
+                case '|':
+                case '>':
+                    literalError("block scalars are not supported in literals");
+                    return 0;
+                default:
+                    return plain_(flow);
+                }
+            }
+
+            constexpr uint32_t blockMapping_(int indent)
+            {
+                uint32_t map = node_(YamlType::MAPPING);
+                uint32_t last = 0;
+                for (;;)
+                {
+                    Span key = key_(false);
+                    skipBlanks_();
+                    uint32_t child = 0;
+                    if (atLineEnd_())
+                    {
+                        int next = nextLine_();
+                        if (next > indent)
+                            child = parseBlock_(next);
+                        else if (next == indent && isDash_()) // "key:\n- item" at the key's column
+                            child = blockSequence_(next);
+                        else
+                            child = node_(YamlType::NIL);
+                    }
+                    else
+                    {
+                        child = inline_(false);
+                        finishLine_();
+                    }
+                    addEntry_(map, last, key, child);
+
+                    int next = nextLine_();
+                    if (next > indent)
+                        literalError("unexpected indentation");
+                    if (next < indent || isDash_())
+                        return map;
+                }
+            }
+
+            constexpr uint32_t blockSequence_(int indent)
+            {
+                uint32_t seq = node_(YamlType::SEQUENCE);
+                uint32_t last = 0;
+                for (;;)
+                {
+                    pos_++; // '-'
+                    skipBlanks_();
+                    uint32_t child = 0;
+                    if (atLineEnd_())
+                    {
+                        int next = nextLine_();
+                        child = next > indent ? parseBlock_(next) : node_(YamlType::NIL);
+                    }
+                    else
+                    {
+                        child = parseBlock_(static_cast<int>(pos_ - lineStart_));
+                    }
+                    addChild_(seq, last, child);
+
+                    int next = nextLine_();
+                    if (next > indent)
+                        literalError("unexpected indentation");
+                    if (next < indent || !isDash_())
+                        return seq;
+                }
+            }
+
+            constexpr uint32_t parseBlock_(int indent)
+            {
+                if (isDash_())
+                    return blockSequence_(indent);
+                if (isKeyAhead_())
+                    return blockMapping_(indent);
+                uint32_t value = inline_(false);
+                finishLine_();
+                return value;
+            }
+        };
+
+        constexpr size_t literalNodeCount(std::string_view src)
+        {
+            LiteralParser counter(src, nullptr, 0, nullptr, 0);
+            counter.parseDocument();
+            return counter.count();
+        }
+    }
+
+    // A node of a LiteralDocument; cheap to copy, valid while the document is
+    class LiteralRef
+    {
+    public:
+        constexpr LiteralRef(const LiteralNode *nodes, const char *chars, uint32_t index)
+            : nodes_(nodes), chars_(chars), index_(index) {}
+
+        constexpr YamlType getType() const { return node_().type; }
+        constexpr bool isNil() const { return getType() == YamlType::NIL; }
+        constexpr bool isBool() const { return getType() == YamlType::BOOLEAN; }
+        constexpr bool isNumber() const { return getType() == YamlType::NUMBER; }
+        constexpr bool isString() const { return getType() == YamlType::STRING; }
+        constexpr bool isSequence() const { return getType() == YamlType::SEQUENCE; }
+        constexpr bool isMapping() const { return getType() == YamlType::MAPPING; }
+
+        constexpr bool asBool() const
+        {
+            if (!isBool())
+                detail::literalError("value is not a boolean");
+            return node_().boolean;
+        }
+        constexpr double asNumber() const
+        {
+            if (!isNumber())
+                detail::literalError("value is not a number");
+            return node_().number;
+        }
+        constexpr int asInt() const { return static_cast<int>(asNumber()); }
+        constexpr std::string_view asString() const
+        {
+            if (!isString())
+                detail::literalError("value is not a string");
+            return std::string_view(chars_ + node_().text, node_().textLength);
+        }
+
+        // Children of a container; 0 for scalars
+        constexpr size_t size() const { return node_().size; }
+        constexpr bool contains(std::string_view key) const { return isMapping() && find_(key) != 0; }
+        // Key of a mapping entry
+        constexpr std::string_view key() const { return std::string_view(chars_ + node_().key, node_().keyLength); }
+
+        constexpr LiteralRef operator[](std::string_view key) const
+        {
+            if (!isMapping())
+                detail::literalError("value is not a mapping");
+            uint32_t child = find_(key);
+            if (!child)
+                detail::literalError("key not found");
+            return LiteralRef(nodes_, chars_, child);
+        }
+        constexpr LiteralRef operator[](size_t index) const
+        {
+            if (!isSequence() && !isMapping())
+                detail::literalError("value is not a container");
+            if (index >= size())
+                detail::literalError("index out of range");
+            uint32_t child = node_().firstChild;
+            for (size_t i = 0; i < index; ++i)
+                child = nodes_[child].nextSibling;
+            return LiteralRef(nodes_, chars_, child);
+        }
+
+        // Heap copy, for APIs that take a YamlValue
+        YamlValue toValue() const
+        {
+            const LiteralNode &node = node_();
+            switch (node.type)
+            {
+            case YamlType::NIL:
+                return YamlValue();
+            case YamlType::BOOLEAN:
+                return YamlValue(node.boolean);
+            case YamlType::NUMBER:
+                return YamlValue(node.number);
+            case YamlType::STRING:
+                return YamlValue(std::string(chars_ + node.text, node.textLength));
+            case YamlType::SEQUENCE:
+            {
+                YamlValue::Sequence seq;
+                seq.reserve(node.size);
+                uint32_t child = node.firstChild;
+                for (uint32_t i = 0; i < node.size; ++i, child = nodes_[child].nextSibling)
+                    seq.push_back(LiteralRef(nodes_, chars_, child).toValue());
+                return YamlValue(std::move(seq));
+            }
+            case YamlType::MAPPING:
+            {
+                YamlValue::Mapping map;
+                uint32_t child = node.firstChild;
+                for (uint32_t i = 0; i < node.size; ++i, child = nodes_[child].nextSibling)
+                {
+                    LiteralRef entry(nodes_, chars_, child);
+                    map.emplace_hint(map.end(), std::string(entry.key()), entry.toValue());
+                }
+                return YamlValue(std::move(map));
+            }
+            }
+            return YamlValue();
+        }
+
+    private:
+        const LiteralNode *nodes_;
+        const char *chars_;
+        uint32_t index_;
+
+        constexpr const LiteralNode &node_() const { return nodes_[index_]; }
+        constexpr uint32_t find_(std::string_view key) const
+        {
+            uint32_t child = node_().firstChild;
+            for (uint32_t i = 0; i < node_().size; ++i, child = nodes_[child].nextSibling)
+            {
+                if (std::string_view(chars_ + nodes_[child].key, nodes_[child].keyLength) == key)
+                    return child;
+            }
+            return 0;
+        }
+    };
+
+    // Nodes and decoded text of a literal; built by YAML_LITERAL
+    template <size_t Nodes, size_t Chars>
+    class LiteralDocument
+    {
+    public:
+        constexpr explicit LiteralDocument(std::string_view src) : nodes_(), chars_()
+        {
+            detail::LiteralParser(src, nodes_, Nodes, chars_, Chars).parseDocument();
+        }
+
+        constexpr LiteralRef root() const { return LiteralRef(nodes_, chars_, 0); }
+        constexpr LiteralRef operator[](std::string_view key) const { return root()[key]; }
+        constexpr LiteralRef operator[](size_t index) const { return root()[index]; }
+        constexpr bool contains(std::string_view key) const { return root().contains(key); }
+        constexpr size_t size() const { return root().size(); }
+        YamlValue toValue() const { return root().toValue(); }
+
+    private:
+        LiteralNode nodes_[Nodes];
+        char chars_[Chars];
+    };
+
+#define YAML_LITERAL(text) \
+    ::yaml::LiteralDocument<::yaml::detail::literalNodeCount(text), sizeof(text)>(text)
+#endif
+
+#ifdef YAML_ALLOC_STATS
+    // Allocation accounting, compiled in with -DYAML_ALLOC_STATS. The library
+    // then replaces the global operator new/delete; each allocation is charged
+    // to the phase active on the calling thread, and its free to the same phase.
+    enum class AllocPhase
+    {
+        OTHER,     // outside the library
+        SCANNER,   // token text and scanner buffers
+        PARSER,    // parser state and the containers it builds
+        VALUE,     // YamlValue payloads (strings, sequences, mappings)
+        SERIALIZER // serializer output buffers
+    };
+
+    struct AllocCounters
+    {
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t bytes;      // requested by allocations
+        uint64_t freedBytes; // released by frees
+
+        AllocCounters() : allocations(0), frees(0), bytes(0), freedBytes(0) {}
+    };
+
+    struct AllocStats
+    {
+        static const int PHASES = 5;
+        AllocCounters phases[PHASES];
+
+        // Process-wide counters since start (or the last reset)
+        static AllocStats capture();
+        static void reset();
+
+        const AllocCounters &operator[](AllocPhase phase) const { return phases[static_cast<int>(phase)]; }
+        AllocCounters total() const;
+        // Counters accumulated between two captures
+        AllocStats operator-(const AllocStats &before) const;
+    };
+
+    // Charges allocations on this thread to phase until destroyed
+    class AllocScope
+    {
+    public:
+        explicit AllocScope(AllocPhase phase);
+        ~AllocScope();
+
+    private:
+        AllocPhase previous_;
+
+        AllocScope(const AllocScope &);
+        AllocScope &operator=(const AllocScope &);
+    };
+#endif
+
+#ifdef YAML_TRACE
+    // Timeline tracing, compiled in with -DYAML_TRACE. Between start() and
+    // stop() the library records spans on every thread: read, load (decode +
+    // parse of one file), parse with its scan and build shares, include,
+    // discover, merge, serialize and the enclosing loadFiles / loadTree.
+    // json() renders them as Chrome trace-event JSON for ui.perfetto.dev.
+    //
+    // Scanning and building interleave token by token, so their totals are
+    // drawn as two back-to-back children of each parse span (args.aggregate).
+    //
+    // All members may be called from any thread while other threads record.
+    // Each thread appends to its own buffer under that buffer's lock, so
+    // recording threads never wait on each other. stop() returns once spans
+    // being appended have landed, after which json() and eventCount() see a
+    // settled set; called while recording, they see the events appended so far.
+    class Trace
+    {
+    public:
+        // Drops previously recorded events and starts recording
+        static void start();
+        static void stop();
+        static bool active();
+
+        static size_t eventCount();
+        static std::string json();
+        // Returns false when the file cannot be written
+        static bool writeJson(const std::string &path);
+    };
+
+    // Records name (and detail, e.g. a path) as a span on this thread from
+    // construction to destruction; does nothing unless tracing is active
+    class TraceSpan
+    {
+    public:
+        explicit TraceSpan(const char *name, const std::string &detail = std::string());
+        ~TraceSpan();
+
+    private:
+        const char *name_;
+        std::string detail_;
+        bool recording_;
+        std::chrono::steady_clock::time_point start_;
+
+        TraceSpan(const TraceSpan &);
+        TraceSpan &operator=(const TraceSpan &);
+    };
+#endif
+
+#ifdef YAML_ACCESS_PROFILE
+    namespace detail
+    {
+        struct AccessCounts;
+    }
+
+    // Lookup counting, compiled in with -DYAML_ACCESS_PROFILE. While a profile
+    // is recording, every operator[] and contains() call on any thread is
+    // counted against the container it was made on. Each thread counts into
+    // its own table, so concurrent readers do not serialize on the profile;
+    // reports merge the tables and resolve the containers to key paths by
+    // walking the profiled document, which must stay alive and unmodified
+    // in between.
+    struct PathHits
+    {
+        std::vector<PathStep> steps;
+        std::string path;  // e.g. services.web.ports[0]
+        uint64_t hits;     // lookups of this exact path
+        uint64_t subtree;  // hits plus every lookup below it
+        bool present;      // false for keys that were probed but do not exist
+
+        PathHits() : hits(0), subtree(0), present(true) {}
+    };
+
+    class AccessProfile
+    {
+    public:
+        AccessProfile();
+        ~AccessProfile(); // stops recording
+
+        // One profile records at a time; starting another stops this one
+        void start();
+        void stop();
+        bool recording() const;
+        void clear();
+
+        uint64_t totalHits() const;
+
+        // Looked-up paths under root, hottest first (limit 0: all of them)
+        std::vector<PathHits> hottest(const YamlValue &root, size_t limit = 0) const;
+
+        // Equal deep copy of root built hottest subtree first, so that hot
+        // nodes are allocated together instead of in key order
+        YamlValue relayout(const YamlValue &root) const;
+
+    private:
+        std::unique_ptr<detail::AccessCounts> counts_;
+
+        AccessProfile(const AccessProfile &);
+        AccessProfile &operator=(const AccessProfile &);
+    };
+#endif
 
 } // namespace yaml
 
@@ -0,0 +1,753 @@
+// Generates C++ structs with a dedicated decoder and encoder each from a YAML
+// schema, so fixed-schema documents are read straight into typed fields
+// through yaml::Reader, without a YamlValue tree in between.
+//
+//   make yaml2cpp
+//   ./yaml2cpp schema.yaml [-o types.hpp]
+//
+// Schema:
+//
+//   namespace: app                # optional
+//   types:
+//     Server:
+//       host: string = localhost
+//       port: int = 8080
+//       tags: [string]
+//       limits: Limits
+//     Limits:
+//       cpu: double
+//       burst: bool = true
+//
+// Field types are bool, int, int64, double, string, another type of the
+// schema, or [T] for a sequence of T. "= value" sets the default of a scalar
+// field. For every type T the output declares
+//
+//   struct T { ... };
+//   void decode(yaml::Reader &in, T &out);
+//   void decode(const std::string &text, T &out);
+//   void encode(std::string &out, const T &value);
+//   std::string encode(const T &value);
+//
+// Decoders switch on the key length and then on the one character position
+// that tells the keys of that length apart. Where no single position does
+// (abc/abd/aec), they switch on a perfect hash of the key, whose seed and
+// modulus are searched at generation time. Either way a key costs one
+// comparison; unknown keys are skipped and missing ones keep their defaults. Encoders
+// write one line of flow YAML with the keys spelled at generation time.
+// Fields are emitted in key order, as the schema is read into a Mapping.
+
+#include "yaml.hpp"
+#include <climits>
+#include <cstdio>
+#include <fstream>
+
+// ====================================================================================
+// Schema
+// ====================================================================================
+
+struct FieldType
+{
+    enum Kind
+    {
+        BOOL,
+        INT,
+        INT64,
+        DOUBLE,
+        STRING,
+        STRUCT,
+        LIST
+    };
+
+    Kind kind;
+    std::string name;                // STRUCT: the schema type
+    std::shared_ptr<FieldType> item; // LIST: the element type
+
+    FieldType() : kind(STRING) {}
+};
+
+struct Field
+{
+    std::string key;    // as spelled in documents
+    std::string member; // C++ identifier
+    FieldType type;
+    std::string init;   // default initializer, empty for none
+};
+
+struct Type
+{
+    std::string name;
+    std::vector<Field> fields;
+};
+
+static void fail(const std::string &msg)
+{
+    throw yaml::YamlException(msg);
+}
+
+static std::string trim(const std::string &s)
+{
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return std::string();
+    return s.substr(begin, s.find_last_not_of(" \t") - begin + 1);
+}
+
+static bool isIdentifier(const std::string &s)
+{
+    if (s.empty() || std::isdigit(static_cast<unsigned char>(s[0])))
+        return false;
+    for (char c : s)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_')
+            return false;
+    }
+    return true;
+}
+
+static std::string memberName(const std::string &key)
+{
+    static const char *const reserved[] = {
+        "auto", "bool", "break", "case", "char", "class", "const", "continue", "default", "delete",
+        "do", "double", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+        "friend", "goto", "if", "inline", "int", "long", "namespace", "new", "operator", "private",
+        "protected", "public", "register", "return", "short", "signed", "sizeof", "static", "struct",
+        "switch", "template", "this", "throw", "true", "try", "typedef", "typename", "union",
+        "unsigned", "using", "virtual", "void", "volatile", "while"};
+
+    std::string name;
+    for (char c : key)
+        name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+        name = "_" + name;
+    for (const char *word : reserved)
+    {
+        if (name == word)
+            return name + "_";
+    }
+    return name;
+}
+
+static FieldType parseType(const yaml::YamlValue &spec, const std::string &where)
+{
+    FieldType type;
+    if (spec.isSequence())
+    {
+        if (spec.size() != 1)
+            fail(where + ": a sequence type is written [T]");
+        type.kind = FieldType::LIST;
+        type.item = std::make_shared<FieldType>(parseType(spec[0], where));
+        return type;
+    }
+    if (!spec.isString())
+        fail(where + ": expected a type name");
+
+    const std::string &name = spec.asString();
+    if (name == "bool")
+        type.kind = FieldType::BOOL;
+    else if (name == "int")
+        type.kind = FieldType::INT;
+    else if (name == "int64")
+        type.kind = FieldType::INT64;
+    else if (name == "double")
+        type.kind = FieldType::DOUBLE;
+    else if (name == "string")
+        type.kind = FieldType::STRING;
+    else if (isIdentifier(name))
+    {
+        type.kind = FieldType::STRUCT;
+        type.name = name;
+    }
+    else
+        fail(where + ": unknown type '" + name + "'");
+    return type;
+}
+
+static std::string cppString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// The default is read as YAML, so it is checked against the field type
+static std::string parseDefault(const FieldType &type, const std::string &text, const std::string &where)
+{
+    yaml::YamlValue value = yaml::parse(text);
+    char buf[40];
+    switch (type.kind)
+    {
+    case FieldType::BOOL:
+        if (!value.isBool())
+            fail(where + ": default is not a bool");
+        return value.asBool() ? "true" : "false";
+    case FieldType::INT:
+    case FieldType::INT64:
+    {
+        // Read through yaml::Reader like the generated decoder, so values
+        // beyond 2^53 are not rounded
+        long long integer = 0;
+        try
+        {
+            yaml::Reader in(text);
+            if (type.kind == FieldType::INT64)
+                in.read(integer);
+            else
+            {
+                int small = 0;
+                in.read(small);
+                integer = small;
+            }
+        }
+        catch (const yaml::YamlException &)
+        {
+            fail(where + ": default is not an integer");
+        }
+        if (integer == LLONG_MIN)
+            return "(-9223372036854775807LL - 1)"; // the literal itself would overflow
+        std::snprintf(buf, sizeof(buf), "%lld%s", integer, type.kind == FieldType::INT64 ? "LL" : "");
+        return buf;
+    }
+    case FieldType::DOUBLE:
+        if (!value.isNumber())
+            fail(where + ": default is not a number");
+        std::snprintf(buf, sizeof(buf), "%.17g", value.asNumber());
+        return buf;
+    case FieldType::STRING:
+        return cppString(value.isString() ? value.asString() : text);
+    default:
+        fail(where + ": only scalar fields take a default");
+    }
+    return std::string();
+}
+
+static std::vector<Type> readSchema(const yaml::YamlValue &schema)
+{
+    if (!schema.contains("types") || !schema["types"].isMapping())
+        fail("schema: expected a 'types' mapping");
+
+    std::vector<Type> types;
+    for (const auto &entry : schema["types"].asMapping())
+    {
+        if (!isIdentifier(entry.first))
+            fail("'" + entry.first + "' is not a valid type name");
+        if (!entry.second.isMapping() && !entry.second.isNil())
+            fail(entry.first + ": expected a mapping of fields");
+
+        Type type;
+        type.name = entry.first;
+        if (entry.second.isMapping())
+        {
+            for (const auto &spec : entry.second.asMapping())
+            {
+                Field field;
+                field.key = spec.first;
+                field.member = memberName(spec.first);
+                std::string where = type.name + "." + spec.first;
+
+                std::string defaultText;
+                if (spec.second.isString())
+                {
+                    const std::string &text = spec.second.asString();
+                    size_t eq = text.find('=');
+                    field.type = parseType(yaml::YamlValue(trim(text.substr(0, eq))), where);
+                    if (eq != std::string::npos)
+                        defaultText = trim(text.substr(eq + 1));
+                }
+                else
+                {
+                    field.type = parseType(spec.second, where);
+                }
+                if (!defaultText.empty())
+                    field.init = parseDefault(field.type, defaultText, where);
+                else if (field.type.kind == FieldType::BOOL)
+                    field.init = "false";
+                else if (field.type.kind == FieldType::INT || field.type.kind == FieldType::INT64 ||
+                         field.type.kind == FieldType::DOUBLE)
+                    field.init = "0";
+
+                for (const Field &other : type.fields)
+                {
+                    if (other.member == field.member)
+                        fail(where + ": member name clashes with key '" + other.key + "'");
+                }
+                type.fields.push_back(field);
+            }
+        }
+        types.push_back(type);
+    }
+    return types;
+}
+
+// Orders types so that each follows the types it holds
+static void visit(const std::vector<Type> &types, size_t index, std::vector<int> &state, std::vector<Type> &out);
+
+static void visitField(const std::vector<Type> &types, const FieldType &type, const std::string &where,
+                       std::vector<int> &state, std::vector<Type> &out)
+{
+    if (type.kind == FieldType::LIST)
+    {
+        visitField(types, *type.item, where, state, out);
+        return;
+    }
+    if (type.kind != FieldType::STRUCT)
+        return;
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        if (types[i].name == type.name)
+        {
+            if (state[i] == 1)
+                fail(where + ": recursive types are not supported");
+            visit(types, i, state, out);
+            return;
+        }
+    }
+    fail(where + ": unknown type '" + type.name + "'");
+}
+
+static void visit(const std::vector<Type> &types, size_t index, std::vector<int> &state, std::vector<Type> &out)
+{
+    if (state[index] == 2)
+        return;
+    state[index] = 1;
+    for (const Field &field : types[index].fields)
+        visitField(types, field.type, types[index].name + "." + field.key, state, out);
+    state[index] = 2;
+    out.push_back(types[index]);
+}
+
+// ====================================================================================
+// Code generation
+// ====================================================================================
+
+static std::string cppType(const FieldType &type)
+{
+    switch (type.kind)
+    {
+    case FieldType::BOOL:
+        return "bool";
+    case FieldType::INT:
+        return "int";
+    case FieldType::INT64:
+        return "long long";
+    case FieldType::DOUBLE:
+        return "double";
+    case FieldType::STRING:
+        return "std::string";
+    case FieldType::STRUCT:
+        return type.name;
+    case FieldType::LIST:
+        return "std::vector<" + cppType(*type.item) + ">";
+    }
+    return std::string();
+}
+
+static std::string charLiteral(char c)
+{
+    if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.' || c == ' ')
+        return std::string("'") + c + "'";
+    return std::to_string(static_cast<int>(static_cast<unsigned char>(c)));
+}
+
+class Writer
+{
+public:
+    explicit Writer(std::string &out) : out_(out), indent_(0) {}
+
+    void line(const std::string &text)
+    {
+        if (!text.empty())
+            out_ += std::string(indent_ * 4, ' ') + text;
+        out_ += '\n';
+    }
+    void open(const std::string &text = "{")
+    {
+        line(text);
+        indent_++;
+    }
+    void close(const std::string &text = "}")
+    {
+        indent_--;
+        line(text);
+    }
+
+private:
+    std::string &out_;
+    int indent_;
+};
+
+static void emitDecode(Writer &w, const FieldType &type, const std::string &target)
+{
+    switch (type.kind)
+    {
+    case FieldType::STRUCT:
+        w.line("decode(in, " + target + ");");
+        return;
+    case FieldType::LIST:
+        w.line(target + ".clear();");
+        w.line("if (in.enterSequence())");
+        w.open();
+        w.line("while (in.nextItem())");
+        w.open();
+        w.line(target + ".emplace_back();");
+        emitDecode(w, *type.item, target + ".back()");
+        w.close();
+        w.close();
+        return;
+    default:
+        w.line("in.read(" + target + ");");
+        return;
+    }
+}
+
+static void emitEncode(Writer &w, const FieldType &type, const std::string &source, int depth)
+{
+    switch (type.kind)
+    {
+    case FieldType::BOOL:
+        w.line("out += " + source + " ? \"true\" : \"false\";");
+        return;
+    case FieldType::INT:
+    case FieldType::INT64:
+        w.line("out += std::to_string(" + source + ");");
+        return;
+    case FieldType::DOUBLE:
+    case FieldType::STRING:
+        w.line("yaml::appendScalar(out, " + source + ");");
+        return;
+    case FieldType::STRUCT:
+        w.line("encode(out, " + source + ");");
+        return;
+    case FieldType::LIST:
+    {
+        std::string i = "i" + std::to_string(depth);
+        w.line("out += '[';");
+        w.line("for (size_t " + i + " = 0; " + i + " < " + source + ".size(); ++" + i + ")");
+        w.open();
+        w.line("if (" + i + ")");
+        w.line("    out += \", \";");
+        emitEncode(w, *type.item, source + "[" + i + "]", depth + 1);
+        w.close();
+        w.line("out += ']';");
+        return;
+    }
+    }
+}
+
+static void emitMatch(Writer &w, const Field &field)
+{
+    w.line("if (std::memcmp(key.data(), " + cppString(field.key) + ", " + std::to_string(field.key.size()) +
+           ") == 0)");
+    w.open();
+    emitDecode(w, field.type, "out." + field.member);
+    w.line("continue;");
+    w.close();
+}
+
+// A position where every key of the group has a different character
+static int distinguishingPosition(const std::vector<const Field *> &group)
+{
+    size_t length = group[0]->key.size();
+    for (size_t pos = 0; pos < length; ++pos)
+    {
+        bool distinct = true;
+        for (size_t a = 0; a < group.size() && distinct; ++a)
+        {
+            for (size_t b = a + 1; b < group.size(); ++b)
+            {
+                if (group[a]->key[pos] == group[b]->key[pos])
+                {
+                    distinct = false;
+                    break;
+                }
+            }
+        }
+        if (distinct)
+            return static_cast<int>(pos);
+    }
+    return -1;
+}
+
+// FNV-1a from seed; the generated decoders compute the same
+static uint32_t keyHash(const std::string &key, uint32_t seed)
+{
+    uint32_t h = seed;
+    for (char c : key)
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    return h;
+}
+
+// A seed and modulus that give every key of the group its own slot, the
+// modulus as small as possible so the switch becomes a jump table
+static bool perfectHash(const std::vector<const Field *> &group, uint32_t &seed, uint32_t &modulus)
+{
+    for (modulus = static_cast<uint32_t>(group.size()); modulus <= 4 * group.size(); ++modulus)
+    {
+        for (uint32_t attempt = 0; attempt < 256; ++attempt)
+        {
+            seed = 2166136261u + attempt;
+            std::vector<bool> used(modulus, false);
+            bool distinct = true;
+            for (size_t i = 0; i < group.size() && distinct; ++i)
+            {
+                uint32_t slot = keyHash(group[i]->key, seed) % modulus;
+                distinct = !used[slot];
+                used[slot] = true;
+            }
+            if (distinct)
+                return true;
+        }
+    }
+    return false;
+}
+
+static void emitType(Writer &w, const Type &type)
+{
+    w.line("inline void decode(yaml::Reader &in, " + type.name + " &out)");
+    w.open();
+    if (type.fields.empty())
+    {
+        w.line("in.skipValue();");
+        w.close();
+        w.line("");
+    }
+    else
+    {
+        std::map<size_t, std::vector<const Field *> > byLength;
+        for (const Field &field : type.fields)
+            byLength[field.key.size()].push_back(&field);
+
+        w.line("std::string key;");
+        w.line("if (!in.enterMapping())");
+        w.line("    return;");
+        w.line("while (in.nextKey(key))");
+        w.open();
+        w.line("switch (key.size())");
+        w.line("{");
+        for (const auto &group : byLength)
+        {
+            w.line("case " + std::to_string(group.first) + ":");
+            w.open("{");
+            int pos = group.second.size() > 1 ? distinguishingPosition(group.second) : -1;
+            uint32_t seed = 0;
+            uint32_t modulus = 0;
+            if (pos >= 0)
+            {
+                w.line("switch (key[" + std::to_string(pos) + "])");
+                w.line("{");
+                for (const Field *field : group.second)
+                {
+                    w.line("case " + charLiteral(field->key[pos]) + ":");
+                    w.open("{");
+                    emitMatch(w, *field);
+                    w.line("break;");
+                    w.close();
+                }
+                w.line("}");
+            }
+            else if (group.second.size() > 1 && perfectHash(group.second, seed, modulus))
+            {
+                w.line("uint32_t h = " + std::to_string(seed) + "u;");
+                w.line("for (size_t i = 0; i < " + std::to_string(group.first) + "; ++i)");
+                w.line("    h = (h ^ static_cast<unsigned char>(key[i])) * 16777619u;");
+                w.line("switch (h % " + std::to_string(modulus) + ")");
+                w.line("{");
+                std::vector<const Field *> slots(modulus, nullptr);
+                for (const Field *field : group.second)
+                    slots[keyHash(field->key, seed) % modulus] = field;
+                for (uint32_t slot = 0; slot < modulus; ++slot)
+                {
+                    if (!slots[slot])
+                        continue;
+                    w.line("case " + std::to_string(slot) + ":");
+                    w.open("{");
+                    emitMatch(w, *slots[slot]);
+                    w.line("break;");
+                    w.close();
+                }
+                w.line("}");
+            }
+            else
+            {
+                // One key, or no seed found: compare in turn
+                for (const Field *field : group.second)
+                    emitMatch(w, *field);
+            }
+            w.line("break;");
+            w.close();
+        }
+        w.line("}");
+        w.line("in.skipValue();");
+        w.close();
+        w.close();
+        w.line("");
+    }
+
+    w.line("inline void encode(std::string &out, const " + type.name + " &value)");
+    w.open();
+    if (type.fields.empty())
+    {
+        w.line("out += \"{}\";");
+    }
+    for (size_t i = 0; i < type.fields.size(); ++i)
+    {
+        const Field &field = type.fields[i];
+        std::string key;
+        yaml::appendScalar(key, field.key);
+        w.line("out += " + cppString((i ? ", " : "{") + key + ": ") + ";");
+        emitEncode(w, field.type, "value." + field.member, 0);
+    }
+    if (!type.fields.empty())
+        w.line("out += '}';");
+    w.close();
+    w.line("");
+
+    w.line("inline void decode(const std::string &text, " + type.name + " &out)");
+    w.open();
+    w.line("yaml::Reader in(text);");
+    w.line("decode(in, out);");
+    w.close();
+    w.line("");
+
+    w.line("inline std::string encode(const " + type.name + " &value)");
+    w.open();
+    w.line("std::string out;");
+    w.line("encode(out, value);");
+    w.line("return out;");
+    w.close();
+    w.line("");
+}
+
+static std::string generate(const yaml::YamlValue &schema, const std::string &source)
+{
+    std::vector<Type> types = readSchema(schema);
+    std::vector<Type> ordered;
+    std::vector<int> state(types.size(), 0);
+    for (size_t i = 0; i < types.size(); ++i)
+        visit(types, i, state, ordered);
+
+    std::string ns = schema.contains("namespace") ? schema["namespace"].asString() : std::string();
+
+    std::string out;
+    Writer w(out);
+    w.line("// Generated by yaml2cpp from " + source + "; do not edit.");
+    w.line("#pragma once");
+    w.line("#include \"yaml.hpp\"");
+    w.line("#include <cstring>");
+    w.line("");
+    if (!ns.empty())
+    {
+        w.line("namespace " + ns);
+        w.line("{");
+        w.line("");
+    }
+
+    for (const Type &type : ordered)
+    {
+        w.line("struct " + type.name);
+        w.open();
+        for (const Field &field : type.fields)
+        {
+            std::string decl = cppType(field.type) + " " + field.member;
+            if (!field.init.empty())
+                decl += " = " + field.init;
+            w.line(decl + ";");
+        }
+        w.close("};");
+        w.line("");
+    }
+
+    for (const Type &type : ordered)
+    {
+        w.line("void decode(yaml::Reader &in, " + type.name + " &out);");
+        w.line("void encode(std::string &out, const " + type.name + " &value);");
+    }
+    w.line("");
+
+    for (const Type &type : ordered)
+        emitType(w, type);
+
+    if (!ns.empty())
+        w.line("} // namespace " + ns);
+    return out;
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: yaml2cpp schema.yaml [-o output.hpp]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string input;
+    std::string output;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            input = arg;
+    }
+    if (input.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    std::string code;
+    try
+    {
+        code = generate(yaml::parseFile(input), input);
+    }
+    catch (const yaml::YamlException &e)
+    {
+        if (e.line)
+            std::fprintf(stderr, "yaml2cpp: %s:%d:%d: %s\n", input.c_str(), e.line, e.column, e.what());
+        else
+            std::fprintf(stderr, "yaml2cpp: %s: %s\n", input.c_str(), e.what());
+        return 1;
+    }
+
+    if (output.empty())
+    {
+        std::fwrite(code.data(), 1, code.size(), stdout);
+        return 0;
+    }
+    std::ofstream out(output.c_str(), std::ios::binary);
+    out << code;
+    if (!out)
+    {
+        std::fprintf(stderr, "yaml2cpp: cannot write %s\n", output.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Compiles YAML files into snapshots and writes them as C arrays, so a
+// program can link its documents in and read them with no parsing at
+// startup:
+//
+//   make embed EMBED="defaults.yaml limits=config/limits.yml"
+//   ./yaml_embed [name=]file.yaml... [-o embedded_yaml.cpp]
+//
+// Each document is registered under its name, by default the file name
+// without its .yaml/.yml extension, and read back with
+//
+//   yaml::SnapshotRef cfg = yaml::embedded("defaults");
+//   int port = cfg["server"]["port"].asInt();
+//
+// Files are parsed with yaml::parseFile, so includes are not resolved and a
+// parse error fails the build with the file's line and column.
+
+#include "yaml.hpp"
+#include <cstdio>
+#include <fstream>
+
+struct Input
+{
+    std::string name;
+    std::string path;
+};
+
+static std::string defaultName(const std::string &path)
+{
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0)
+    {
+        std::string ext = name.substr(dot);
+        if (ext == ".yaml" || ext == ".yml")
+            name.erase(dot);
+    }
+    return name;
+}
+
+static std::string identifier(const std::string &name, size_t index)
+{
+    std::string id = "snapshot" + std::to_string(index) + "_";
+    for (char c : name)
+        id += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    return id;
+}
+
+static std::string cppString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void writeArray(std::string &out, const std::string &id, const std::string &bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    out += "    const unsigned char " + id + "[] = {";
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        unsigned char b = static_cast<unsigned char>(bytes[i]);
+        out += i % 16 == 0 ? "\n        " : " ";
+        out += "0x";
+        out += digits[b >> 4];
+        out += digits[b & 15];
+        out += ',';
+    }
+    out += "\n    };\n";
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: yaml_embed [name=]file.yaml... [-o output.cpp]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Input> inputs;
+    std::string output;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+        {
+            Input input;
+            size_t eq = arg.find('=');
+            input.path = eq == std::string::npos ? arg : arg.substr(eq + 1);
+            input.name = eq == std::string::npos ? defaultName(arg) : arg.substr(0, eq);
+            for (const Input &other : inputs)
+            {
+                if (other.name == input.name)
+                {
+                    std::fprintf(stderr, "yaml_embed: '%s' is embedded twice\n", input.name.c_str());
+                    return 2;
+                }
+            }
+            inputs.push_back(input);
+        }
+    }
+    if (inputs.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    std::string code = "// Generated by yaml_embed; do not edit.\n"
+                       "#include \"yaml.hpp\"\n"
+                       "\n"
+                       "namespace\n"
+                       "{\n";
+    size_t total = 0;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        std::string bytes;
+        try
+        {
+            bytes = yaml::writeSnapshot(yaml::parseFile(inputs[i].path));
+        }
+        catch (const yaml::YamlException &e)
+        {
+            if (e.line)
+                std::fprintf(stderr, "yaml_embed: %s:%d:%d: %s\n", inputs[i].path.c_str(), e.line, e.column,
+                             e.what());
+            else
+                std::fprintf(stderr, "yaml_embed: %s: %s\n", inputs[i].path.c_str(), e.what());
+            return 1;
+        }
+        total += bytes.size();
+
+        std::string id = identifier(inputs[i].name, i);
+        if (i)
+            code += "\n";
+        code += "    // " + inputs[i].name + ": " + inputs[i].path + "\n";
+        writeArray(code, id, bytes);
+        code += "    const yaml::EmbeddedRegistration register_" + id + "(" + cppString(inputs[i].name) + ", " + id +
+                ", sizeof(" + id + "));\n";
+    }
+    code += "} // namespace\n";
+
+    if (output.empty())
+    {
+        std::fwrite(code.data(), 1, code.size(), stdout);
+        return 0;
+    }
+    std::ofstream out(output.c_str(), std::ios::binary);
+    out << code;
+    if (!out)
+    {
+        std::fprintf(stderr, "yaml_embed: cannot write %s\n", output.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "yaml_embed: %zu document(s), %zu snapshot bytes -> %s\n", inputs.size(), total,
+                 output.c_str());
+    return 0;
+}
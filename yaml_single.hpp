@@ -10,6 +10,23 @@
 #include <algorithm>
 #include <iostream>
 #include <cctype>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <functional>
+
+// The exported API is the same at every language level, so the library and
+// its users may be built with different -std flags. Code that is itself
+// built as C++17 also gets inline std::string_view lookups, YAML_LITERAL
+// and an if-constexpr get<T>; a library built as C++17 reads and writes
+// numbers with std::from_chars/to_chars. -DYAML_NO_CPP17 keeps the C++11
+// code paths.
+#if __cplusplus >= 201703L && !defined(YAML_NO_CPP17)
+#define YAML_CPP17 1
+#include <string_view>
+#include <charconv>
+#include <type_traits>
+#endif
 
 namespace yaml
 {
@@ -24,6 +41,30 @@ namespace yaml
             : std::runtime_error(msg), line(ln), column(col) {}
     };
 
+    // Thrown by a parse whose CancelToken was set
+    class ParseCancelled : public YamlException
+    {
+    public:
+        ParseCancelled(int ln = 0, int col = 0) : YamlException("Parse cancelled", ln, col) {}
+    };
+
+    // Set from any thread to stop the parses that were given this token
+    class CancelToken
+    {
+    public:
+        CancelToken() : cancelled_(false) {}
+
+        void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+        void reset() { cancelled_.store(false, std::memory_order_relaxed); }
+        bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<bool> cancelled_;
+
+        CancelToken(const CancelToken &);
+        CancelToken &operator=(const CancelToken &);
+    };
+
     enum class YamlType
     {
         NIL,
@@ -34,10 +75,36 @@ namespace yaml
         MAPPING
     };
 
+    namespace detail
+    {
+        // std::string ordering: bytewise, then the shorter key first
+        inline int compareKeys(const char *a, size_t aLength, const char *b, size_t bLength)
+        {
+            int cmp = std::memcmp(a, b, std::min(aLength, bLength));
+            if (cmp != 0)
+                return cmp;
+            return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+        }
+
+        // Mapping order. Transparent, so from C++14 on a key given as any
+        // type with data() and size() is found without building a std::string.
+        struct KeyLess
+        {
+            typedef void is_transparent;
+
+            bool operator()(const std::string &a, const std::string &b) const { return a < b; }
+            template <typename A, typename B>
+            bool operator()(const A &a, const B &b) const
+            {
+                return compareKeys(a.data(), a.size(), b.data(), b.size()) < 0;
+            }
+        };
+    }
+
     class YamlValue
     {
     public:
-        struct Mapping : public std::map<std::string, YamlValue>
+        struct Mapping : public std::map<std::string, YamlValue, detail::KeyLess>
         {
         };
         struct Sequence : public std::vector<YamlValue>
@@ -62,9 +129,13 @@ namespace yaml
         YamlValue(int value);
         YamlValue(double value);
         YamlValue(const std::string &value);
+        YamlValue(std::string &&value);
         YamlValue(const char *value);
         YamlValue(const Sequence &seq);
         YamlValue(const Mapping &map);
+        // Take over a container without copying its elements
+        YamlValue(Sequence &&seq);
+        YamlValue(Mapping &&map);
 
         // Copy constructor and assignment
         YamlValue(const YamlValue &other);
@@ -96,8 +167,25 @@ namespace yaml
         const Mapping &asMapping() const;
 
         // Template getter
+#ifdef YAML_CPP17
+        template <typename T>
+        T get() const
+        {
+            if constexpr (std::is_same<T, bool>::value)
+                return asBool();
+            else if constexpr (std::is_integral<T>::value)
+                return static_cast<T>(asNumber());
+            else if constexpr (std::is_floating_point<T>::value)
+                return static_cast<T>(asNumber());
+            else if constexpr (std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value)
+                return T(asString());
+            else
+                static_assert(sizeof(T) == 0, "get<T> supports bool, arithmetic and string types");
+        }
+#else
         template <typename T>
         T get() const;
+#endif
 
         // Convenience methods
         size_t size() const;
@@ -113,6 +201,21 @@ namespace yaml
         YamlValue &operator[](size_t index);
         const YamlValue &operator[](size_t index) const;
 
+#ifdef YAML_CPP17
+        // Literals and substrings, looked up without building a std::string.
+        // Inline, so they work against a library built at any level.
+        bool contains(std::string_view key) const { return find_(key.data(), key.size()) != nullptr; }
+        YamlValue &operator[](std::string_view key) { return insert_(key.data(), key.size()); }
+        const YamlValue &operator[](std::string_view key) const { return at_(key.data(), key.size()); }
+        // A string literal converts to both key types; this takes it first
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        bool contains(const C *key) const { return find_(key, std::strlen(key)) != nullptr; }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        YamlValue &operator[](const C *key) { return insert_(key, std::strlen(key)); }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        const YamlValue &operator[](const C *key) const { return at_(key, std::strlen(key)); }
+#endif
+
         // Serialization
         std::string serialize(int indent = 0) const;
 
@@ -124,7 +227,11 @@ namespace yaml
         void cleanup();
         void copyFrom(const YamlValue &other);
         void moveFrom(YamlValue &other);
-        std::string serializeValue(int indent, bool inArray = false) const;
+        void serializeValue(std::ostringstream &oss, int indent, bool inArray = false) const;
+        // Key lookups behind every key overload; find_ is null when missing
+        const YamlValue *find_(const char *key, size_t length) const;
+        const YamlValue &at_(const char *key, size_t length) const;
+        YamlValue &insert_(const char *key, size_t length);
     };
 
     // Token types - Fixed enum
@@ -148,8 +255,7 @@ namespace yaml
         TOKEN_ALIAS,
         TOKEN_EOF,
         TOKEN_ERROR,
-        TOKEN_INDENT,
-        TOKEN_DEDENT
+        TOKEN_TAG
     };
 
     struct Token
@@ -158,55 +264,282 @@ namespace yaml
         std::string value;
         int line;
         int column;
-        int indent;
+        int indent; // the line's indentation on the token that starts it, -1 on the rest
 
         Token();
-        Token(TokenType t, const std::string &val = "", int ln = 0, int col = 0, int ind = 0);
+        Token(TokenType t, std::string val = std::string(), int ln = 0, int col = 0, int ind = -1);
+    };
+
+    namespace detail
+    {
+        // Indentation of the open blocks, innermost last. Parsers compare
+        // the indent of the token that starts a line against it; entering or
+        // leaving a block is a step of its own, taken before that token.
+        class BlockIndents
+        {
+        public:
+            BlockIndents() : levels_(1, 0) {}
+
+            // The line opens a block inside the innermost one
+            bool opens(int indent) const { return indent > levels_.back(); }
+            // The line closes the innermost block
+            bool closes(int indent) const { return indent >= 0 && indent < levels_.back(); }
+            // Neither: not a line start, or level with the innermost block
+            bool inside(int indent) const { return indent < 0 || indent == levels_.back(); }
+
+            // Opens or closes one block towards indent
+            void step(int indent)
+            {
+                if (opens(indent))
+                    levels_.push_back(indent);
+                else
+                    levels_.pop_back();
+            }
+
+            // Whether a line at indent nests deeper or returns to an open block
+            bool aligned(int indent) const
+            {
+                if (indent < 0 || indent >= levels_.back())
+                    return true;
+                return std::find(levels_.begin(), levels_.end(), indent) != levels_.end();
+            }
+
+            size_t heldBytes() const { return levels_.capacity() * sizeof(int); }
+
+        private:
+            std::vector<int> levels_;
+        };
+    }
+
+    // Pull-based byte source for input that is not held in memory at once
+    class InputSource
+    {
+    public:
+        virtual ~InputSource() {}
+        // Copies up to n bytes into buf; returns 0 at end of input
+        virtual size_t read(char *buf, size_t n) = 0;
+    };
+
+    // Compile-time feature sets for BasicScanner and BasicParser. A feature
+    // that is switched off is folded out of the scanner loop. Derive from
+    // DefaultPolicy and hide the flags to change:
+    //
+    //   struct NoComments : yaml::DefaultPolicy { static const bool comments = false; };
+    struct DefaultPolicy
+    {
+        static const bool comments = true;           // '#' starts a comment; off: it is text
+        static const bool flowCollections = true;    // [ ] { } , are structural; off: text
+        static const bool quotedEscapes = true;      // backslash escapes in quotes; off: kept as written
+        static const bool positions = true;          // line and column in tokens and errors; off: 0
+        static const bool numbers = true;            // numeric scalars become numbers; off: strings
+        static const bool duplicateKeyCheck = false; // a repeated key throws; off: the last one wins
     };
 
-    class Scanner
+    // Machine-written block YAML: no comments, flow collections, escapes or
+    // position tracking
+    struct CompactPolicy : DefaultPolicy
+    {
+        static const bool comments = false;
+        static const bool flowCollections = false;
+        static const bool quotedEscapes = false;
+        static const bool positions = false;
+    };
+
+    // Hand-edited configs where a repeated key is a mistake
+    struct StrictPolicy : DefaultPolicy
+    {
+        static const bool duplicateKeyCheck = true;
+    };
+
+    template <typename Policy>
+    class BasicScanner
     {
     public:
-        explicit Scanner(const std::string &src);
+        explicit BasicScanner(const std::string &src);
+        // Scans through a sliding window refilled from source
+        explicit BasicScanner(InputSource &source);
         Token next();
 
+        // Input bytes consumed so far
+        size_t offset() const { return base_ + cur_; }
+        // Heap held by the stream window
+        size_t heldBytes() const;
+        // Checked before each read from the source; throws ParseCancelled
+        void setCancel(const CancelToken *cancel) { cancel_ = cancel; }
+
     private:
-        const std::string &s_;
+        const std::string *s_; // the whole input, or window_ when streaming
+        std::string window_;
+        InputSource *source_;
+        const CancelToken *cancel_;
+        size_t base_; // bytes dropped from the front of window_
         size_t cur_;
         int line_;
         int col_;
         bool bol_;
-        std::vector<int> indents_;
-        std::vector<Token> pending_;
+        int lineIndent_; // for the next token; -1 once the line's first token is out
 
         // helpers
-        bool isAtEnd_() const;
-        char peek_() const;
-        char peekNext_() const;
+        bool fill_();
+        bool isAtEnd_();
+        char peek_();
+        char peekNext_();
         char advance_();
         void skipToEOL_();
         int measureIndent_();
-        void emitIndentChange_(int spaces);
-        static bool isSpace_(char c);
-        static bool isDigit_(char c);
-        static bool isAlpha_(char c);
-        static bool isAlnum_(char c);
-        Token make_(TokenType t, const std::string &v = "");
+        Token make_(TokenType t, std::string v = std::string());
+        // Position for tokens and errors; 0 when the policy does not track it
+        int posLine_() const { return Policy::positions ? line_ : 0; }
+        int posCol_() const { return Policy::positions ? col_ : 0; }
 
         static int countSpaces_(const std::string &s, size_t pos, size_t &outPos);
+
+        // s_ may point at window_
+        BasicScanner(const BasicScanner &);
+        BasicScanner &operator=(const BasicScanner &);
+    };
+
+    typedef BasicScanner<DefaultPolicy> Scanner;
+
+    // One step of the route from a document root to a node
+    struct PathStep
+    {
+        bool isIndex;
+        size_t index;
+        std::string key;
+
+        PathStep() : isIndex(false), index(0) {}
+    };
+
+    // A `!include target` node found while parsing
+    struct IncludeSite
+    {
+        std::vector<PathStep> path;
+        std::string target;
     };
 
-    class Parser
+    // Shape and cost of one parse; see parse(src, stats)
+    struct ParseStats
+    {
+        static const int TOKEN_TYPES = static_cast<int>(TokenType::TOKEN_TAG) + 1;
+        static const int NODE_TYPES = static_cast<int>(YamlType::MAPPING) + 1;
+
+        size_t bytes;                // input size
+        size_t tokens[TOKEN_TYPES];  // indexed by TokenType
+        size_t nodes[NODE_TYPES];    // indexed by YamlType, root included
+        size_t maxDepth;             // root is depth 1
+        size_t maxMappingWidth;      // most keys in one mapping
+        double scanMs;               // inside the scanner
+        double buildMs;              // parsing and tree building, excluding scanMs
+        size_t documentBytes;        // estimated heap + inline size of the result
+        size_t peakBytes;            // high-water mark of the bytes tracked while parsing
+
+        ParseStats();
+
+        size_t tokenCount(TokenType t) const { return tokens[static_cast<int>(t)]; }
+        size_t nodeCount(YamlType t) const { return nodes[static_cast<int>(t)]; }
+        size_t totalTokens() const;
+        size_t totalNodes() const;
+    };
+
+    struct ParseProgress
+    {
+        size_t bytes; // input consumed
+        size_t nodes; // values built, containers included
+    };
+
+    // Per-parse limits and instrumentation; see parse(src, options)
+    struct ParseOptions
+    {
+        // Soft cap on tracked bytes: the input string (or the stream window),
+        // tokens in flight, the tree built so far and the builders' temporaries
+        // such as keys and growing containers. Exceeding it throws
+        // YamlException and releases everything built. 0 = no limit.
+        size_t memoryLimit;
+        ParseStats *stats; // optional, filled as by parse(src, stats)
+
+        // Called from the parsing thread each time another progressInterval
+        // bytes are consumed, and once at the end. May throw to abort.
+        std::function<void(const ParseProgress &)> progress;
+        size_t progressInterval;
+        // Polled per token and per stream read; once set, the parse throws
+        // ParseCancelled
+        const CancelToken *cancel;
+
+        ParseOptions() : memoryLimit(0), stats(nullptr), progressInterval(1 << 20), cancel(nullptr) {}
+    };
+
+    template <typename Policy>
+    class BasicParser
     {
     public:
-        explicit Parser(const std::string &src);
+        explicit BasicParser(const std::string &src);
+        explicit BasicParser(InputSource &source);
         YamlValue parse();
 
+        // Collect `!include` nodes into sites; they parse as their target string
+        void recordIncludes(std::vector<IncludeSite> *sites) { includes_ = sites; }
+
+        // Count tokens and time the scanner into stats during parse()
+        void collectStats(ParseStats *stats);
+        // Enforce options.memoryLimit, collect options.stats and report
+        // progress and cancellation during parse()
+        void applyOptions(const ParseOptions &options);
+
+        // Input bytes consumed so far
+        size_t offset() const { return sc_.offset(); }
+        // Values built so far
+        size_t nodesBuilt() const { return nodes_; }
+        // Highest tracked byte count so far; 0 unless memory is tracked
+        size_t peakBytes() const { return peakBytes_; }
+
     private:
-        Scanner sc_;
+        BasicScanner<Policy> sc_;
         Token cur_, nxt_;
+        std::vector<IncludeSite> *includes_;
+        ParseStats *stats_;
+        std::vector<PathStep> path_;
+
+        // Memory tracking, on while a limit is set or stats are collected
+        bool trackMemory_;
+        size_t memoryLimit_;
+        size_t inputBytes_;     // the caller's string; 0 when streaming
+        size_t transientBytes_; // scanner buffers and the two tokens in flight
+        size_t treeBytes_;      // nodes built so far plus builder temporaries
+        size_t peakBytes_;
+
+        void charge_(size_t bytes);
+        void release_(size_t bytes);
+        void trackTransient_();
+        void append_(YamlValue::Sequence &seq, YamlValue &&value);
+        void insert_(YamlValue::Mapping &map, std::string &&key, YamlValue &&value);
+        // Throws if the key token repeats a key of map (Policy::duplicateKeyCheck)
+        void checkKey_(const YamlValue::Mapping &map);
+
+        // Progress and cancellation, polled from advance_ while watched_
+        bool watched_;
+        const CancelToken *cancel_;
+        std::function<void(const ParseProgress &)> progress_;
+        size_t progressInterval_;
+        size_t nextProgress_;
+        size_t nodes_;
+
+        void poll_();
+
+        void pushKey_(const std::string &key);
+        void pushIndex_(size_t index);
+        void popPath_();
+
+        // Block structure, from the indent of each line's first token
+        detail::BlockIndents indents_;
+        bool opensBlock_() const { return indents_.opens(cur_.indent); }
+        bool closesBlock_() const { return indents_.closes(cur_.indent); }
+        // cur_ is a t, with every block step before it taken
+        bool at_(TokenType t) const { return cur_.type == t && indents_.inside(cur_.indent); }
+        bool isKey_() const { return at_(TokenType::TOKEN_STRING) && nxt_.type == TokenType::TOKEN_COLON; }
 
         void advance_();
+        void checkIndent_();
         bool match_(TokenType t);
         void expect_(TokenType t, const char *msg);
 
@@ -214,12 +547,130 @@ namespace yaml
         YamlValue parseFlowSeq_();
         YamlValue parseFlowMap_();
         YamlValue parseScalar_();
-        YamlValue parseMapping_();
+        YamlValue parseMapping_(bool afterDash = false);
         YamlValue parseSequence_();
     };
 
-    inline YamlValue parse(const std::string &s) { return Parser(s).parse(); }
+    typedef BasicParser<DefaultPolicy> Parser;
+
+    // Instantiated in yaml.cpp. Other policies need the definitions: build
+    // yaml_single.hpp with YAML_IMPLEMENTATION in one file and instantiate
+    // there with `template class yaml::BasicParser<MyPolicy>;` (and the same
+    // for BasicScanner), declaring them extern template elsewhere.
+    extern template class BasicScanner<DefaultPolicy>;
+    extern template class BasicParser<DefaultPolicy>;
+    extern template class BasicScanner<CompactPolicy>;
+    extern template class BasicParser<CompactPolicy>;
+    extern template class BasicScanner<StrictPolicy>;
+    extern template class BasicParser<StrictPolicy>;
+
+    // Block-only documents take a fast path that mirrors Parser without its
+    // token queue and bookkeeping. Flow collections, tags and errors fall
+    // back to Parser, so the result and any exception are the same.
+    YamlValue parse(const std::string &s);
+
+    // parse(s) with the features of Policy, e.g. parse<CompactPolicy>(s)
+    template <typename Policy>
+    YamlValue parse(const std::string &s)
+    {
+        return BasicParser<Policy>(s).parse();
+    }
+
+    // As parse(s), also filling *stats (reset first). A null stats pointer
+    // takes the plain parse path.
+    YamlValue parse(const std::string &s, ParseStats *stats);
+
+    // Streams the input through the scanner window. gzip and zlib input
+    // (YAML_HAVE_ZLIB) and zstd input (YAML_HAVE_ZSTD) are detected from
+    // their magic bytes and decompressed chunk by chunk.
+    YamlValue parseStream(InputSource &source);
+    YamlValue parseFile(const std::string &path);
+
+    // As above, with the limits and instrumentation in options
+    YamlValue parse(const std::string &s, const ParseOptions &options);
+    YamlValue parseStream(InputSource &source, const ParseOptions &options);
+    YamlValue parseFile(const std::string &path, const ParseOptions &options);
+
+    // Pull access to the token stream with Parser's grammar, for decoders
+    // that fill their own types without building YamlValues (yaml2cpp
+    // generates these). Every read consumes one whole value.
+    class Reader
+    {
+    public:
+        // src is read in place and must outlive the Reader
+        explicit Reader(const std::string &src);
+        explicit Reader(InputSource &source);
+
+        // Type of the next value; NIL also for an empty document
+        YamlType peekType();
+
+        // Open the next value; false, with the value consumed, when it is null
+        bool enterMapping();
+        bool enterSequence();
+        // Next key of the innermost open mapping, whose value is read next;
+        // false once the mapping is closed
+        bool nextKey(std::string &key);
+        // Whether the innermost open sequence has another item; false once
+        // the sequence is closed
+        bool nextItem();
+
+        // Scalars. A null leaves out unchanged and returns false; any other
+        // type throws YamlException, as does a fraction or an out-of-range
+        // value read into an integer.
+        bool read(bool &out);
+        bool read(double &out);
+        bool read(int &out);
+        bool read(long long &out);
+        bool read(std::string &out);
+
+        void skipValue();
+
+    private:
+        struct Frame
+        {
+            bool mapping;
+            bool flow;
+            bool afterDash;  // block mapping that started on a "- " line
+            bool ownsBlock;  // ...and opened the block of its second key
+            bool first;
+            int blocks;      // blocks opened before the value
+        };
+
+        Scanner sc_;
+        Token cur_;
+        Token nxt_;
+        detail::BlockIndents indents_;
+        std::vector<Frame> frames_;
+        bool dashMapping_; // the item just opened is a mapping on its dash line
+        bool opened_;      // prelude of the next value already consumed
+        bool openAfterDash_;
+        int openBlocks_;
+
+        Reader(const Reader &);
+        Reader &operator=(const Reader &);
+        Reader(std::string &&); // a temporary would be gone before the first read
+
+        void start_();
+        void advance_();
+        void expect_(TokenType t, const char *msg);
+        void fail_(const char *msg);
+        void prepare_();
+        int take_();
+        void close_(int blocks);
+        bool opensBlock_() const { return indents_.opens(cur_.indent); }
+        bool closesBlock_() const { return indents_.closes(cur_.indent); }
+        bool at_(TokenType t) const { return cur_.type == t && indents_.inside(cur_.indent); }
+        bool isKey_() const;
+        bool scalar_(TokenType t, const char *msg, int &blocks);
+        bool readInteger_(long long &out, long long min, long long max);
+    };
+
+    // Appends a scalar spelled as serialize() spells it, for encoders that
+    // write YAML text directly
+    void appendScalar(std::string &out, const std::string &value);
+    void appendScalar(std::string &out, double value);
 
+#ifndef YAML_CPP17
     // Template specializations for get<T>
     template <>
     inline bool YamlValue::get<bool>() const { return asBool(); }
@@ -229,1172 +680,6504 @@ namespace yaml
     inline double YamlValue::get<double>() const { return asNumber(); }
     template <>
     inline std::string YamlValue::get<std::string>() const { return asString(); }
+#endif
 
-} // namespace yaml
+    // Batched file loading
+    struct LoadOptions
+    {
+        unsigned threads; // parser threads, 0 = hardware concurrency
+        size_t batchSize; // files per io_uring submission batch
+        bool useIoUring;  // false forces the thread pool reader
+        bool resolveIncludes; // replace `!include path` nodes with the parsed file
 
-// //------------------------------------------------------------------------------------
-// // Implementation section
-// //------------------------------------------------------------------------------------
-#ifdef YAML_IMPLEMENTATION
+        LoadOptions() : threads(0), batchSize(64), useIoUring(true), resolveIncludes(false) {}
+    };
 
-#include <fstream>
-#include <iomanip>
- 
+    struct LoadedFile
+    {
+        std::string path;
+        YamlValue value;
+        bool ok;
+        std::string error;
+        int line;
+        int column;
+        size_t bytes;
+        double readMs;
+        double parseMs;
+        std::vector<IncludeSite> includes; // filled when includes are resolved
 
-namespace yaml
-{
+        LoadedFile() : ok(false), line(0), column(0), bytes(0), readMs(0), parseMs(0) {}
+    };
 
-    // ============================================================================
-    // YamlValue Implementation
-    // ============================================================================
+    // Reads and parses every path; results keep the order of `paths`.
+    // Errors are reported per file instead of being thrown.
+    std::vector<LoadedFile> loadFiles(const std::vector<std::string> &paths,
+                                      const LoadOptions &options = LoadOptions());
 
-    YamlValue::YamlValue() : type_(YamlType::NIL) {}
+    // Drops every fragment cached by include resolution
+    void clearIncludeCache();
 
-    YamlValue::YamlValue(bool value) : type_(YamlType::BOOLEAN), boolValue_(value) {}
+    // Directory tree loading
+    enum class MergePolicy
+    {
+        BY_PATH,   // root["sub/file.yaml"] = document
+        DEEP_MERGE // mappings merged recursively, later files (by path order) win;
+                   // empty files are skipped, other non-mapping roots are file errors
+    };
 
-    YamlValue::YamlValue(int value) : type_(YamlType::NUMBER), numberValue_(static_cast<double>(value)) {}
+    struct TreeOptions : public LoadOptions
+    {
+        MergePolicy merge;
 
-    YamlValue::YamlValue(double value) : type_(YamlType::NUMBER), numberValue_(value) {}
+        TreeOptions() : merge(MergePolicy::BY_PATH) {}
+    };
 
-    YamlValue::YamlValue(const std::string &value) : type_(YamlType::STRING)
+    struct TreeResult
     {
-        stringValue_ = new std::string(value);
-    }
+        YamlValue root;
+        std::vector<LoadedFile> files; // relative paths; values are moved into root
+        double discoverMs;
+        double mergeMs;
 
-    YamlValue::YamlValue(const char *value) : type_(YamlType::STRING)
-    {
-        stringValue_ = new std::string(value);
-    }
+        TreeResult() : discoverMs(0), mergeMs(0) {}
+    };
 
-    YamlValue::YamlValue(const Sequence &seq) : type_(YamlType::SEQUENCE)
-    {
-        sequenceValue_ = new Sequence(seq);
-    }
+    // Recursively finds *.yaml / *.yml under dir, parses them in parallel and
+    // assembles one document. Throws YamlException if dir cannot be opened.
+    TreeResult loadTree(const std::string &dir, const TreeOptions &options = TreeOptions());
 
-    YamlValue::YamlValue(const Mapping &map) : type_(YamlType::MAPPING)
-    {
-        mappingValue_ = new Mapping(map);
-    }
+    // Merges src into dst: mappings key by key, anything else is replaced
+    void deepMerge(YamlValue &dst, YamlValue &&src);
 
-    YamlValue::YamlValue(const YamlValue &other)
+    // Follows an append-only file of `---` separated documents. A document is
+    // handed out once the next separator (`---` or `...`) has been written.
+    // Bytes before offset() are never read again.
+    class DocumentTail
     {
-        copyFrom(other);
-    }
+    public:
+        // offset: value previously returned by offset(), 0 for a new log
+        explicit DocumentTail(const std::string &path, uint64_t offset = 0);
+        ~DocumentTail();
 
-    YamlValue &YamlValue::operator=(const YamlValue &other)
-    {
-        if (this != &other)
-        {
-            cleanup();
-            copyFrom(other);
-        }
-        return *this;
-    }
+        // Appends documents completed since the last call to out. When none
+        // are ready, waits up to timeoutMs for the file to grow (inotify on
+        // Linux, polling elsewhere). Returns the number of documents added.
+        // A malformed document is skipped and reported as YamlException.
+        size_t poll(std::vector<YamlValue> &out, int timeoutMs = 0);
 
-    YamlValue::YamlValue(YamlValue &&other) noexcept
-    {
-        moveFrom(other);
-    }
+        // Parses the unterminated last document, for when the writer is done
+        size_t flush(std::vector<YamlValue> &out);
 
-    YamlValue &YamlValue::operator=(YamlValue &&other) noexcept
-    {
-        if (this != &other)
-        {
-            cleanup();
-            moveFrom(other);
-        }
-        return *this;
-    }
+        // File offset of the first byte not yet handed out; persist to resume
+        uint64_t offset() const { return base_ + docStart_; }
 
-    YamlValue::~YamlValue()
+    private:
+        std::string path_;
+        int fd_;
+        int watch_;
+        uint64_t base_;     // file offset of buffer_[0]
+        uint64_t readPos_;  // file offset of the next byte to read
+        std::string buffer_;
+        size_t docStart_;   // start of the pending document in buffer_
+        size_t scanPos_;    // first line in buffer_ not yet checked for a separator
+
+        DocumentTail(const DocumentTail &);
+        DocumentTail &operator=(const DocumentTail &);
+
+        bool readAvailable_();
+        void waitForData_(int timeoutMs);
+        size_t extract_(std::vector<YamlValue> &out);
+        bool emit_(size_t end, std::vector<YamlValue> &out);
+    };
+
+    // Text of each non-empty document of a "---" separated stream, split as
+    // DocumentTail splits it; parse() reads one document only
+    std::vector<std::string> splitDocuments(const std::string &text);
+
+    // Snapshots: a parsed document flattened into one position-independent
+    // byte block that is read in place, with no parsing and no allocation.
+    // The layout is a 12-byte header ("YSN1", node count, string bytes), a
+    // table of 20-byte little-endian nodes in breadth-first order, so the
+    // children of a container are contiguous, then the NUL-terminated string
+    // pool. Mapping entries keep YamlValue's key order and are found by
+    // binary search.
+    std::string writeSnapshot(const YamlValue &value);
+
+    // Read-only view of one node of a snapshot; the bytes must outlive it
+    class SnapshotRef
     {
-        cleanup();
-    }
+    public:
+        SnapshotRef() : nodes_(nullptr), pool_(nullptr), index_(0) {}
 
-    void YamlValue::cleanup()
+        YamlType getType() const;
+        bool isNil() const { return getType() == YamlType::NIL; }
+        bool isBool() const { return getType() == YamlType::BOOLEAN; }
+        bool isNumber() const { return getType() == YamlType::NUMBER; }
+        bool isString() const { return getType() == YamlType::STRING; }
+        bool isSequence() const { return getType() == YamlType::SEQUENCE; }
+        bool isMapping() const { return getType() == YamlType::MAPPING; }
+
+        bool asBool() const;
+        double asNumber() const;
+        int asInt() const { return static_cast<int>(asNumber()); }
+        std::string asString() const;
+        // The string in place, NUL-terminated
+        const char *asCString() const;
+
+        // Children of a container; 0 for scalars
+        size_t size() const;
+        bool empty() const { return size() == 0; }
+        bool contains(const std::string &key) const;
+        // Key of a mapping entry reached by index, "" otherwise
+        const char *key() const;
+
+        SnapshotRef operator[](const std::string &key) const;
+        // Sequence items, or mapping entries in key order
+        SnapshotRef operator[](size_t index) const;
+
+#ifdef YAML_CPP17
+        bool contains(std::string_view key) const { return has_(key.data(), key.size()); }
+        SnapshotRef operator[](std::string_view key) const { return at_(key.data(), key.size()); }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        bool contains(const C *key) const { return has_(key, std::strlen(key)); }
+        template <typename C, typename std::enable_if<std::is_same<C, char>::value, int>::type = 0>
+        SnapshotRef operator[](const C *key) const { return at_(key, std::strlen(key)); }
+#endif
+
+        YamlValue toValue() const;
+
+    private:
+        const unsigned char *nodes_;
+        const char *pool_;
+        uint32_t index_;
+
+        SnapshotRef(const unsigned char *nodes, const char *pool, uint32_t index)
+            : nodes_(nodes), pool_(pool), index_(index) {}
+
+        uint32_t field_(int i) const;
+        bool find_(const char *key, size_t length, uint32_t &child) const;
+        bool has_(const char *key, size_t length) const;
+        SnapshotRef at_(const char *key, size_t length) const;
+
+        friend SnapshotRef readSnapshot(const void *data, size_t size);
+        friend SnapshotRef embedded(const std::string &name);
+    };
+
+    // Root of a snapshot. Checks the header and every node's ranges, so
+    // untrusted bytes are safe to read; throws YamlException if they are not
+    // a snapshot.
+    SnapshotRef readSnapshot(const void *data, size_t size);
+
+    // Snapshots linked into the executable. yaml_embed generates a source
+    // file whose static EmbeddedRegistration adds each document at startup;
+    // embedded() then returns its root without copying. The bytes come from
+    // writeSnapshot at build time, so only the header is checked. Throws
+    // YamlException for an unknown name.
+    struct EmbeddedRegistration
     {
-        switch (type_)
-        {
-        case YamlType::STRING:
-            delete stringValue_;
-            break;
-        case YamlType::SEQUENCE:
-            delete sequenceValue_;
-            break;
-        case YamlType::MAPPING:
-            delete mappingValue_;
-            break;
-        default:
-            break;
-        }
-    }
+        EmbeddedRegistration(const char *name, const unsigned char *data, size_t size);
+    };
 
-    void YamlValue::copyFrom(const YamlValue &other)
+    SnapshotRef embedded(const std::string &name);
+    std::vector<std::string> embeddedNames();
+
+#ifdef YAML_CPP17
+    // Compile-time documents. YAML_LITERAL parses a string literal with a
+    // constexpr parser into a fixed array of nodes; declared static or at
+    // namespace scope, lookups on it are constant expressions:
+    //
+    //   static constexpr auto cfg = YAML_LITERAL("server:\n  port: 8080\n");
+    //   static_assert(cfg["server"]["port"].asInt() == 8080, "");
+    //
+    // The grammar is the one parse() accepts minus anchors, aliases and
+    // block scalars. Syntax errors, type mismatches and missing keys stop the
+    // compilation at a call to detail::literalError, or throw YamlException
+    // when reached at runtime.
+    struct LiteralNode
     {
-        type_ = other.type_;
-        switch (type_)
-        {
-        case YamlType::NIL:
-            break;
-        case YamlType::BOOLEAN:
-            boolValue_ = other.boolValue_;
-            break;
-        case YamlType::NUMBER:
-            numberValue_ = other.numberValue_;
-            break;
-        case YamlType::STRING:
-            stringValue_ = new std::string(*other.stringValue_);
-            break;
-        case YamlType::SEQUENCE:
-            sequenceValue_ = new Sequence(*other.sequenceValue_);
-            break;
-        case YamlType::MAPPING:
-            mappingValue_ = new Mapping(*other.mappingValue_);
-            break;
-        }
-    }
+        YamlType type = YamlType::NIL;
+        bool boolean = false;
+        double number = 0;
+        uint32_t key = 0, keyLength = 0;   // mapping entries: the key in chars
+        uint32_t text = 0, textLength = 0; // strings: the value in chars
+        uint32_t firstChild = 0;           // containers; the root is never a child
+        uint32_t nextSibling = 0;
+        uint32_t size = 0;
+    };
 
-    void YamlValue::moveFrom(YamlValue &other)
+    namespace detail
     {
-        type_ = other.type_;
-        switch (type_)
+        // Not constexpr, so reaching it during constant evaluation is a
+        // compile error that names the call
+        inline void literalError(const char *what)
         {
-        case YamlType::NIL:
-            break;
-        case YamlType::BOOLEAN:
-            boolValue_ = other.boolValue_;
-            break;
-        case YamlType::NUMBER:
-            numberValue_ = other.numberValue_;
-            break;
-        case YamlType::STRING:
-            stringValue_ = other.stringValue_;
-            other.stringValue_ = nullptr;
-            break;
-        case YamlType::SEQUENCE:
-            sequenceValue_ = other.sequenceValue_;
-            other.sequenceValue_ = nullptr;
-            break;
-        case YamlType::MAPPING:
-            mappingValue_ = other.mappingValue_;
-            other.mappingValue_ = nullptr;
-            break;
+            throw YamlException(std::string("YAML literal: ") + what);
         }
-        other.type_ = YamlType::NIL;
-    }
 
-    bool YamlValue::asBool() const
-    {
-        if (type_ != YamlType::BOOLEAN)
+        class LiteralParser
         {
-            throw YamlException("Value is not a boolean");
-        }
-        return boolValue_;
+        public:
+            // nodes/chars null: only count the nodes, for sizing the document
+            constexpr LiteralParser(std::string_view src, LiteralNode *nodes, size_t nodeCapacity, char *chars,
+                                    size_t charCapacity)
+                : src_(src), nodes_(nodes), chars_(chars), nodeCapacity_(nodeCapacity),
+                  charCapacity_(charCapacity), pos_(0), lineStart_(0), count_(0), used_(0) {}
+
+            constexpr void parseDocument()
+            {
+                int indent = nextLine_();
+                if (indent < 0)
+                {
+                    node_(YamlType::NIL);
+                    return;
+                }
+                parseBlock_(indent);
+                if (nextLine_() >= 0)
+                    literalError("unexpected text after the document");
+            }
+
+            constexpr uint32_t count() const { return count_; }
+
+        private:
+            struct Span
+            {
+                uint32_t offset;
+                uint32_t length;
+            };
+
+            std::string_view src_;
+            LiteralNode *nodes_;
+            char *chars_;
+            size_t nodeCapacity_;
+            size_t charCapacity_;
+            size_t pos_;
+            size_t lineStart_;
+            uint32_t count_;
+            uint32_t used_;
+
+            static constexpr bool isBlank_(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+            constexpr bool atEnd_() const { return pos_ >= src_.size(); }
+            constexpr char peek_(size_t ahead = 0) const
+            {
+                return pos_ + ahead < src_.size() ? src_[pos_ + ahead] : '\0';
+            }
+            constexpr bool isDash_() const
+            {
+                char next = peek_(1);
+                return peek_() == '-' && (next == '\0' || next == '\n' || isBlank_(next));
+            }
+            constexpr bool atLineEnd_() const { return atEnd_() || peek_() == '\n' || peek_() == '#'; }
+
+            constexpr void skipBlanks_()
+            {
+                while (!atEnd_() && isBlank_(peek_()))
+                    pos_++;
+            }
+
+            constexpr void skipComment_()
+            {
+                while (!atEnd_() && peek_() != '\n')
+                    pos_++;
+            }
+
+            // Moves to the first character of the next line with content and
+            // returns its column, or -1 at the end. A no-op when already there.
+            constexpr int nextLine_()
+            {
+                for (;;)
+                {
+                    skipBlanks_();
+                    if (atEnd_())
+                        return -1;
+                    if (peek_() == '#')
+                        skipComment_();
+                    else if (peek_() == '\n')
+                        lineStart_ = ++pos_;
+                    else
+                        return static_cast<int>(pos_ - lineStart_);
+                }
+            }
+
+            // Blanks, newlines and comments inside [...] and {...}
+            constexpr void skipFlowSpace_()
+            {
+                for (;;)
+                {
+                    skipBlanks_();
+                    if (peek_() == '#')
+                        skipComment_();
+                    else if (peek_() == '\n')
+                        lineStart_ = ++pos_;
+                    else
+                        return;
+                }
+            }
+
+            constexpr void finishLine_()
+            {
+                skipBlanks_();
+                if (peek_() == '#')
+                    skipComment_();
+                if (!atEnd_() && peek_() != '\n')
+                    literalError("unexpected text after a value");
+            }
+
+            constexpr uint32_t node_(YamlType type)
+            {
+                uint32_t index = count_++;
+                if (nodes_ && index >= nodeCapacity_)
+                    literalError("more nodes than the document holds");
+                if (nodes_)
+                    nodes_[index].type = type;
+                return index;
+            }
+
+            constexpr void put_(char c)
+            {
+                if (chars_ && used_ >= charCapacity_)
+                    literalError("more text than the document holds");
+                if (chars_)
+                    chars_[used_] = c;
+                used_++;
+            }
+
+            constexpr Span copy_(size_t begin, size_t end)
+            {
+                Span span{used_, static_cast<uint32_t>(end - begin)};
+                for (size_t i = begin; i < end; ++i)
+                    put_(src_[i]);
+                return span;
+            }
+
+            constexpr std::string_view text_(uint32_t offset, uint32_t length) const
+            {
+                return std::string_view(chars_ + offset, length);
+            }
+
+            // Same escapes as the runtime scanner, for both quote styles
+            constexpr Span quoted_()
+            {
+                char quote = src_[pos_++];
+                Span span{used_, 0};
+                while (!atEnd_() && peek_() != quote)
+                {
+                    char c = src_[pos_++];
+                    if (c == '\\' && !atEnd_())
+                    {
+                        c = src_[pos_++];
+                        c = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+                    }
+                    else if (c == '\n')
+                    {
+                        lineStart_ = pos_;
+                    }
+                    put_(c);
+                }
+                if (atEnd_())
+                    literalError("unterminated quoted string");
+                pos_++;
+                span.length = used_ - span.offset;
+                return span;
+            }
+
+            constexpr bool keyEnd_(bool flow) const
+            {
+                char next = peek_(1);
+                return peek_() == ':' && (next == '\0' || next == '\n' || isBlank_(next) ||
+                                          (flow && (next == ',' || next == '}' || next == ']')));
+            }
+
+            // Whether the current line holds "key:" rather than a bare value
+            constexpr bool isKeyAhead_() const
+            {
+                LiteralParser probe(*this);
+                probe.nodes_ = nullptr;
+                probe.chars_ = nullptr;
+                char c = probe.peek_();
+                if (c == '[' || c == '{')
+                    return false;
+                if (c == '"' || c == '\'')
+                {
+                    probe.quoted_();
+                    probe.skipBlanks_();
+                    return probe.keyEnd_(false);
+                }
+                while (!probe.atEnd_() && probe.peek_() != '\n')
+                {
+                    if (probe.keyEnd_(false))
+                        return true;
+                    if (probe.peek_() == '#' && probe.pos_ > 0 && isBlank_(probe.src_[probe.pos_ - 1]))
+                        return false;
+                    probe.pos_++;
+                }
+                return false;
+            }
+
+            // Consumes "key:" and leaves pos_ after the colon
+            constexpr Span key_(bool flow)
+            {
+                Span key{used_, 0};
+                if (peek_() == '"' || peek_() == '\'')
+                {
+                    key = quoted_();
+                    skipBlanks_();
+                }
+                else
+                {
+                    size_t begin = pos_;
+                    while (!atEnd_() && peek_() != '\n' && !keyEnd_(flow) &&
+                           !(flow && (peek_() == ',' || peek_() == '}')))
+                        pos_++;
+                    size_t end = pos_;
+                    while (end > begin && isBlank_(src_[end - 1]))
+                        end--;
+                    key = copy_(begin, end);
+                }
+                if (peek_() != ':')
+                    literalError("expected ':' after a mapping key");
+                pos_++;
+                return key;
+            }
+
+            constexpr void addChild_(uint32_t parent, uint32_t &last, uint32_t child)
+            {
+                if (!nodes_)
+                    return;
+                if (nodes_[parent].size == 0)
+                    nodes_[parent].firstChild = child;
+                else
+                    nodes_[last].nextSibling = child;
+                nodes_[parent].size++;
+                last = child;
+            }
+
+            constexpr void addEntry_(uint32_t map, uint32_t &last, Span key, uint32_t child)
+            {
+                if (!nodes_)
+                    return;
+                std::string_view name = text_(key.offset, key.length);
+                uint32_t sibling = nodes_[map].firstChild;
+                for (uint32_t i = 0; i < nodes_[map].size; ++i, sibling = nodes_[sibling].nextSibling)
+                {
+                    if (text_(nodes_[sibling].key, nodes_[sibling].keyLength) == name)
+                        literalError("duplicate mapping key");
+                }
+                nodes_[child].key = key.offset;
+                nodes_[child].keyLength = key.length;
+                addChild_(map, last, child);
+            }
+
+            static constexpr double number_(std::string_view text)
+            {
+                bool negative = text[0] == '-';
+                uint64_t mantissa = 0;
+                int digits = 0;
+                int fraction = -1; // digits after the point, once seen
+                double approx = 0;
+                for (size_t i = negative ? 1 : 0; i < text.size(); ++i)
+                {
+                    if (text[i] == '.')
+                    {
+                        fraction = 0;
+                        continue;
+                    }
+                    if (digits < 19)
+                        mantissa = mantissa * 10 + static_cast<uint64_t>(text[i] - '0');
+                    approx = approx * 10 + (text[i] - '0');
+                    digits++;
+                    if (fraction >= 0)
+                        fraction++;
+                }
+                // Exact below 2^53 with at most 22 fraction digits, as 10^22
+                // is the largest exact power of ten
+                double value = digits < 19 ? static_cast<double>(mantissa) : approx;
+                double scale = 1;
+                for (int i = 0; i < fraction; ++i)
+                    scale *= 10;
+                value /= scale;
+                return negative ? -value : value;
+            }
+
+            static constexpr bool isNumber_(std::string_view text)
+            {
+                size_t i = (!text.empty() && text[0] == '-') ? 1 : 0;
+                size_t start = i;
+                while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+                    i++;
+                if (i == start)
+                    return false;
+                if (i < text.size() && text[i] == '.')
+                {
+                    size_t point = ++i;
+                    while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+                        i++;
+                    if (i == point)
+                        return false;
+                }
+                return i == text.size();
+            }
+
+            constexpr uint32_t plain_(bool flow)
+            {
+                size_t begin = pos_;
+                while (!atEnd_() && peek_() != '\n')
+                {
+                    char c = peek_();
+                    if (c == '#' && pos_ > begin && isBlank_(src_[pos_ - 1]))
+                        break;
+                    if (flow && (c == ',' || c == ']' || c == '}' || keyEnd_(true)))
+                        break;
+                    pos_++;
+                }
+                size_t end = pos_;
+                while (end > begin && isBlank_(src_[end - 1]))
+                    end--;
+                std::string_view text = src_.substr(begin, end - begin);
+                if (text.empty())
+                    literalError("expected a value");
+
+                if (text == "null" || text == "~")
+                    return node_(YamlType::NIL);
+                if (text == "true" || text == "false")
+                {
+                    uint32_t index = node_(YamlType::BOOLEAN);
+                    if (nodes_)
+                        nodes_[index].boolean = (text == "true");
+                    return index;
+                }
+                if (isNumber_(text))
+                {
+                    uint32_t index = node_(YamlType::NUMBER);
+                    if (nodes_)
+                        nodes_[index].number = number_(text);
+                    return index;
+                }
+                uint32_t index = node_(YamlType::STRING);
+                Span span = copy_(begin, end);
+                if (nodes_)
+                {
+                    nodes_[index].text = span.offset;
+                    nodes_[index].textLength = span.length;
+                }
+                return index;
+            }
+
+            constexpr uint32_t flowSequence_()
+            {
+                uint32_t seq = node_(YamlType::SEQUENCE);
+                uint32_t last = 0;
+                pos_++; // '['
+                skipFlowSpace_();
+                while (peek_() != ']')
+                {
+                    addChild_(seq, last, inline_(true));
+                    skipFlowSpace_();
+                    if (peek_() == ',')
+                    {
+                        pos_++;
+                        skipFlowSpace_();
+                    }
+                    else if (peek_() != ']')
+                    {
+                        literalError("expected ',' or ']'");
+                    }
+                }
+                pos_++;
+                return seq;
+            }
+
+            constexpr uint32_t flowMapping_()
+            {
+                uint32_t map = node_(YamlType::MAPPING);
+                uint32_t last = 0;
+                pos_++; // '{'
+                skipFlowSpace_();
+                while (peek_() != '}')
+                {
+                    if (atEnd_())
+                        literalError("expected '}'");
+                    Span key = key_(true);
+                    skipFlowSpace_();
+                    addEntry_(map, last, key, inline_(true));
+                    skipFlowSpace_();
+                    if (peek_() == ',')
+                    {
+                        pos_++;
+                        skipFlowSpace_();
+                    }
+                    else if (peek_() != '}')
+                    {
+                        literalError("expected ',' or '}'");
+                    }
+                }
+                pos_++;
+                return map;
+            }
+
+            // A scalar or flow collection
+            constexpr uint32_t inline_(bool flow)
+            {
+                if (flow)
+                    skipFlowSpace_();
+                switch (peek_())
+                {
+                case '[':
+                    return flowSequence_();
+                case '{':
+                    return flowMapping_();
+                case '"':
+                case '\'':
+                {
+                    uint32_t index = node_(YamlType::STRING);
+                    Span span = quoted_();
+                    if (nodes_)
+                    {
+                        nodes_[index].text = span.offset;
+                        nodes_[index].textLength = span.length;
+                    }
+                    return index;
+                }
+                case '!': // tags are accepted and ignored, as by parse()
+                    while (!atEnd_() && !isBlank_(peek_()) && peek_() != '\n')
+                        pos_++;
+                    skipBlanks_();
+                    return inline_(flow);
+                case '&':
+                case '*':
+                    literalError("anchors and aliases are not supported in literals");
+                    return 0;
+                case '|':
+                case '>':
+                    literalError("block scalars are not supported in literals");
+                    return 0;
+                default:
+                    return plain_(flow);
+                }
+            }
+
+            constexpr uint32_t blockMapping_(int indent)
+            {
+                uint32_t map = node_(YamlType::MAPPING);
+                uint32_t last = 0;
+                for (;;)
+                {
+                    Span key = key_(false);
+                    skipBlanks_();
+                    uint32_t child = 0;
+                    if (atLineEnd_())
+                    {
+                        int next = nextLine_();
+                        if (next > indent)
+                            child = parseBlock_(next);
+                        else if (next == indent && isDash_()) // "key:\n- item" at the key's column
+                            child = blockSequence_(next);
+                        else
+                            child = node_(YamlType::NIL);
+                    }
+                    else
+                    {
+                        child = inline_(false);
+                        finishLine_();
+                    }
+                    addEntry_(map, last, key, child);
+
+                    int next = nextLine_();
+                    if (next > indent)
+                        literalError("unexpected indentation");
+                    if (next < indent || isDash_())
+                        return map;
+                }
+            }
+
+            constexpr uint32_t blockSequence_(int indent)
+            {
+                uint32_t seq = node_(YamlType::SEQUENCE);
+                uint32_t last = 0;
+                for (;;)
+                {
+                    pos_++; // '-'
+                    skipBlanks_();
+                    uint32_t child = 0;
+                    if (atLineEnd_())
+                    {
+                        int next = nextLine_();
+                        child = next > indent ? parseBlock_(next) : node_(YamlType::NIL);
+                    }
+                    else
+                    {
+                        child = parseBlock_(static_cast<int>(pos_ - lineStart_));
+                    }
+                    addChild_(seq, last, child);
+
+                    int next = nextLine_();
+                    if (next > indent)
+                        literalError("unexpected indentation");
+                    if (next < indent || !isDash_())
+                        return seq;
+                }
+            }
+
+            constexpr uint32_t parseBlock_(int indent)
+            {
+                if (isDash_())
+                    return blockSequence_(indent);
+                if (isKeyAhead_())
+                    return blockMapping_(indent);
+                uint32_t value = inline_(false);
+                finishLine_();
+                return value;
+            }
+        };
+
+        constexpr size_t literalNodeCount(std::string_view src)
+        {
+            LiteralParser counter(src, nullptr, 0, nullptr, 0);
+            counter.parseDocument();
+            return counter.count();
+        }
+    }
+
+    // A node of a LiteralDocument; cheap to copy, valid while the document is
+    class LiteralRef
+    {
+    public:
+        constexpr LiteralRef(const LiteralNode *nodes, const char *chars, uint32_t index)
+            : nodes_(nodes), chars_(chars), index_(index) {}
+
+        constexpr YamlType getType() const { return node_().type; }
+        constexpr bool isNil() const { return getType() == YamlType::NIL; }
+        constexpr bool isBool() const { return getType() == YamlType::BOOLEAN; }
+        constexpr bool isNumber() const { return getType() == YamlType::NUMBER; }
+        constexpr bool isString() const { return getType() == YamlType::STRING; }
+        constexpr bool isSequence() const { return getType() == YamlType::SEQUENCE; }
+        constexpr bool isMapping() const { return getType() == YamlType::MAPPING; }
+
+        constexpr bool asBool() const
+        {
+            if (!isBool())
+                detail::literalError("value is not a boolean");
+            return node_().boolean;
+        }
+        constexpr double asNumber() const
+        {
+            if (!isNumber())
+                detail::literalError("value is not a number");
+            return node_().number;
+        }
+        constexpr int asInt() const { return static_cast<int>(asNumber()); }
+        constexpr std::string_view asString() const
+        {
+            if (!isString())
+                detail::literalError("value is not a string");
+            return std::string_view(chars_ + node_().text, node_().textLength);
+        }
+
+        // Children of a container; 0 for scalars
+        constexpr size_t size() const { return node_().size; }
+        constexpr bool contains(std::string_view key) const { return isMapping() && find_(key) != 0; }
+        // Key of a mapping entry
+        constexpr std::string_view key() const { return std::string_view(chars_ + node_().key, node_().keyLength); }
+
+        constexpr LiteralRef operator[](std::string_view key) const
+        {
+            if (!isMapping())
+                detail::literalError("value is not a mapping");
+            uint32_t child = find_(key);
+            if (!child)
+                detail::literalError("key not found");
+            return LiteralRef(nodes_, chars_, child);
+        }
+        constexpr LiteralRef operator[](size_t index) const
+        {
+            if (!isSequence() && !isMapping())
+                detail::literalError("value is not a container");
+            if (index >= size())
+                detail::literalError("index out of range");
+            uint32_t child = node_().firstChild;
+            for (size_t i = 0; i < index; ++i)
+                child = nodes_[child].nextSibling;
+            return LiteralRef(nodes_, chars_, child);
+        }
+
+        // Heap copy, for APIs that take a YamlValue
+        YamlValue toValue() const
+        {
+            const LiteralNode &node = node_();
+            switch (node.type)
+            {
+            case YamlType::NIL:
+                return YamlValue();
+            case YamlType::BOOLEAN:
+                return YamlValue(node.boolean);
+            case YamlType::NUMBER:
+                return YamlValue(node.number);
+            case YamlType::STRING:
+                return YamlValue(std::string(chars_ + node.text, node.textLength));
+            case YamlType::SEQUENCE:
+            {
+                YamlValue::Sequence seq;
+                seq.reserve(node.size);
+                uint32_t child = node.firstChild;
+                for (uint32_t i = 0; i < node.size; ++i, child = nodes_[child].nextSibling)
+                    seq.push_back(LiteralRef(nodes_, chars_, child).toValue());
+                return YamlValue(std::move(seq));
+            }
+            case YamlType::MAPPING:
+            {
+                YamlValue::Mapping map;
+                uint32_t child = node.firstChild;
+                for (uint32_t i = 0; i < node.size; ++i, child = nodes_[child].nextSibling)
+                {
+                    LiteralRef entry(nodes_, chars_, child);
+                    map.emplace_hint(map.end(), std::string(entry.key()), entry.toValue());
+                }
+                return YamlValue(std::move(map));
+            }
+            }
+            return YamlValue();
+        }
+
+    private:
+        const LiteralNode *nodes_;
+        const char *chars_;
+        uint32_t index_;
+
+        constexpr const LiteralNode &node_() const { return nodes_[index_]; }
+        constexpr uint32_t find_(std::string_view key) const
+        {
+            uint32_t child = node_().firstChild;
+            for (uint32_t i = 0; i < node_().size; ++i, child = nodes_[child].nextSibling)
+            {
+                if (std::string_view(chars_ + nodes_[child].key, nodes_[child].keyLength) == key)
+                    return child;
+            }
+            return 0;
+        }
+    };
+
+    // Nodes and decoded text of a literal; built by YAML_LITERAL
+    template <size_t Nodes, size_t Chars>
+    class LiteralDocument
+    {
+    public:
+        constexpr explicit LiteralDocument(std::string_view src) : nodes_(), chars_()
+        {
+            detail::LiteralParser(src, nodes_, Nodes, chars_, Chars).parseDocument();
+        }
+
+        constexpr LiteralRef root() const { return LiteralRef(nodes_, chars_, 0); }
+        constexpr LiteralRef operator[](std::string_view key) const { return root()[key]; }
+        constexpr LiteralRef operator[](size_t index) const { return root()[index]; }
+        constexpr bool contains(std::string_view key) const { return root().contains(key); }
+        constexpr size_t size() const { return root().size(); }
+        YamlValue toValue() const { return root().toValue(); }
+
+    private:
+        LiteralNode nodes_[Nodes];
+        char chars_[Chars];
+    };
+
+#define YAML_LITERAL(text) \
+    ::yaml::LiteralDocument<::yaml::detail::literalNodeCount(text), sizeof(text)>(text)
+#endif
+
+#ifdef YAML_ALLOC_STATS
+    // Allocation accounting, compiled in with -DYAML_ALLOC_STATS. The library
+    // then replaces the global operator new/delete; each allocation is charged
+    // to the phase active on the calling thread, and its free to the same phase.
+    enum class AllocPhase
+    {
+        OTHER,     // outside the library
+        SCANNER,   // token text and scanner buffers
+        PARSER,    // parser state and the containers it builds
+        VALUE,     // YamlValue payloads (strings, sequences, mappings)
+        SERIALIZER // serializer output buffers
+    };
+
+    struct AllocCounters
+    {
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t bytes;      // requested by allocations
+        uint64_t freedBytes; // released by frees
+
+        AllocCounters() : allocations(0), frees(0), bytes(0), freedBytes(0) {}
+    };
+
+    struct AllocStats
+    {
+        static const int PHASES = 5;
+        AllocCounters phases[PHASES];
+
+        // Process-wide counters since start (or the last reset)
+        static AllocStats capture();
+        static void reset();
+
+        const AllocCounters &operator[](AllocPhase phase) const { return phases[static_cast<int>(phase)]; }
+        AllocCounters total() const;
+        // Counters accumulated between two captures
+        AllocStats operator-(const AllocStats &before) const;
+    };
+
+    // Charges allocations on this thread to phase until destroyed
+    class AllocScope
+    {
+    public:
+        explicit AllocScope(AllocPhase phase);
+        ~AllocScope();
+
+    private:
+        AllocPhase previous_;
+
+        AllocScope(const AllocScope &);
+        AllocScope &operator=(const AllocScope &);
+    };
+#endif
+
+#ifdef YAML_TRACE
+    // Timeline tracing, compiled in with -DYAML_TRACE. Between start() and
+    // stop() the library records spans on every thread: read, load (decode +
+    // parse of one file), parse with its scan and build shares, include,
+    // discover, merge, serialize and the enclosing loadFiles / loadTree.
+    // json() renders them as Chrome trace-event JSON for ui.perfetto.dev.
+    //
+    // Scanning and building interleave token by token, so their totals are
+    // drawn as two back-to-back children of each parse span (args.aggregate).
+    //
+    // All members may be called from any thread while other threads record.
+    // Each thread appends to its own buffer under that buffer's lock, so
+    // recording threads never wait on each other. stop() returns once spans
+    // being appended have landed, after which json() and eventCount() see a
+    // settled set; called while recording, they see the events appended so far.
+    class Trace
+    {
+    public:
+        // Drops previously recorded events and starts recording
+        static void start();
+        static void stop();
+        static bool active();
+
+        static size_t eventCount();
+        static std::string json();
+        // Returns false when the file cannot be written
+        static bool writeJson(const std::string &path);
+    };
+
+    // Records name (and detail, e.g. a path) as a span on this thread from
+    // construction to destruction; does nothing unless tracing is active
+    class TraceSpan
+    {
+    public:
+        explicit TraceSpan(const char *name, const std::string &detail = std::string());
+        ~TraceSpan();
+
+    private:
+        const char *name_;
+        std::string detail_;
+        bool recording_;
+        std::chrono::steady_clock::time_point start_;
+
+        TraceSpan(const TraceSpan &);
+        TraceSpan &operator=(const TraceSpan &);
+    };
+#endif
+
+#ifdef YAML_ACCESS_PROFILE
+    namespace detail
+    {
+        struct AccessCounts;
+    }
+
+    // Lookup counting, compiled in with -DYAML_ACCESS_PROFILE. While a profile
+    // is recording, every operator[] and contains() call on any thread is
+    // counted against the container it was made on. Each thread counts into
+    // its own table, so concurrent readers do not serialize on the profile;
+    // reports merge the tables and resolve the containers to key paths by
+    // walking the profiled document, which must stay alive and unmodified
+    // in between.
+    struct PathHits
+    {
+        std::vector<PathStep> steps;
+        std::string path;  // e.g. services.web.ports[0]
+        uint64_t hits;     // lookups of this exact path
+        uint64_t subtree;  // hits plus every lookup below it
+        bool present;      // false for keys that were probed but do not exist
+
+        PathHits() : hits(0), subtree(0), present(true) {}
+    };
+
+    class AccessProfile
+    {
+    public:
+        AccessProfile();
+        ~AccessProfile(); // stops recording
+
+        // One profile records at a time; starting another stops this one
+        void start();
+        void stop();
+        bool recording() const;
+        void clear();
+
+        uint64_t totalHits() const;
+
+        // Looked-up paths under root, hottest first (limit 0: all of them)
+        std::vector<PathHits> hottest(const YamlValue &root, size_t limit = 0) const;
+
+        // Equal deep copy of root built hottest subtree first, so that hot
+        // nodes are allocated together instead of in key order
+        YamlValue relayout(const YamlValue &root) const;
+
+    private:
+        std::unique_ptr<detail::AccessCounts> counts_;
+
+        AccessProfile(const AccessProfile &);
+        AccessProfile &operator=(const AccessProfile &);
+    };
+#endif
+
+} // namespace yaml
+
+// //------------------------------------------------------------------------------------
+// // Implementation section
+// //------------------------------------------------------------------------------------
+#ifdef YAML_IMPLEMENTATION
+
+#include <fstream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#if defined(__linux__) && !defined(YAML_NO_IO_URING)
+#define YAML_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#endif
+#ifdef YAML_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef YAML_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include <dirent.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+#ifdef YAML_ALLOC_STATS
+#include <atomic>
+#include <cstddef>
+#include <new>
+#define YAML_ALLOC_PHASE(phase) ::yaml::AllocScope allocScope_(::yaml::AllocPhase::phase)
+#else
+#define YAML_ALLOC_PHASE(phase) ((void)0)
+#endif
+#ifdef YAML_TRACE
+#include <atomic>
+#define YAML_TRACE_SPAN(name, detail) ::yaml::TraceSpan traceSpan_(name, detail)
+ 
+
+namespace yaml
+{
+    namespace detail
+    {
+        void traceComplete(const char *name, const std::string &detail,
+                           std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end, const std::string &args = std::string());
+        void traceAsync(const char *name, const std::string &detail,
+                        std::chrono::steady_clock::time_point start,
+                        std::chrono::steady_clock::time_point end, const std::string &args = std::string());
+        template <typename Policy>
+        YamlValue traceParse(BasicParser<Policy> &parser);
+    }
+}
+#else
+#define YAML_TRACE_SPAN(name, detail) ((void)0)
+#endif
+
+#ifdef YAML_ACCESS_PROFILE
+#include <atomic>
+#define YAML_ACCESS_HIT(...) ::yaml::detail::recordAccess(this, __VA_ARGS__)
+namespace yaml
+{
+    namespace detail
+    {
+        void recordAccess(const YamlValue *node, const char *key, size_t length);
+        void recordAccess(const YamlValue *node, size_t index);
+    }
+}
+#else
+#define YAML_ACCESS_HIT(...) ((void)0)
+#endif
+
+namespace yaml
+{
+
+    // ============================================================================
+    // YamlValue Implementation
+    // ============================================================================
+
+    YamlValue::YamlValue() : type_(YamlType::NIL) {}
+
+    YamlValue::YamlValue(bool value) : type_(YamlType::BOOLEAN), boolValue_(value) {}
+
+    YamlValue::YamlValue(int value) : type_(YamlType::NUMBER), numberValue_(static_cast<double>(value)) {}
+
+    YamlValue::YamlValue(double value) : type_(YamlType::NUMBER), numberValue_(value) {}
+
+    YamlValue::YamlValue(const std::string &value) : type_(YamlType::STRING)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        stringValue_ = new std::string(value);
+    }
+
+    YamlValue::YamlValue(std::string &&value) : type_(YamlType::STRING)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        stringValue_ = new std::string(std::move(value));
+    }
+
+    YamlValue::YamlValue(const char *value) : type_(YamlType::STRING)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        stringValue_ = new std::string(value);
+    }
+
+    YamlValue::YamlValue(const Sequence &seq) : type_(YamlType::SEQUENCE)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        sequenceValue_ = new Sequence(seq);
+    }
+
+    YamlValue::YamlValue(const Mapping &map) : type_(YamlType::MAPPING)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        mappingValue_ = new Mapping(map);
+    }
+
+    YamlValue::YamlValue(Sequence &&seq) : type_(YamlType::SEQUENCE)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        sequenceValue_ = new Sequence(std::move(seq));
+    }
+
+    YamlValue::YamlValue(Mapping &&map) : type_(YamlType::MAPPING)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        mappingValue_ = new Mapping(std::move(map));
+    }
+
+    YamlValue::YamlValue(const YamlValue &other)
+    {
+        copyFrom(other);
+    }
+
+    YamlValue &YamlValue::operator=(const YamlValue &other)
+    {
+        if (this != &other)
+        {
+            cleanup();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    YamlValue::YamlValue(YamlValue &&other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    YamlValue &YamlValue::operator=(YamlValue &&other) noexcept
+    {
+        if (this != &other)
+        {
+            cleanup();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    YamlValue::~YamlValue()
+    {
+        cleanup();
+    }
+
+    void YamlValue::cleanup()
+    {
+        switch (type_)
+        {
+        case YamlType::STRING:
+            delete stringValue_;
+            break;
+        case YamlType::SEQUENCE:
+            delete sequenceValue_;
+            break;
+        case YamlType::MAPPING:
+            delete mappingValue_;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void YamlValue::copyFrom(const YamlValue &other)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        type_ = other.type_;
+        switch (type_)
+        {
+        case YamlType::NIL:
+            break;
+        case YamlType::BOOLEAN:
+            boolValue_ = other.boolValue_;
+            break;
+        case YamlType::NUMBER:
+            numberValue_ = other.numberValue_;
+            break;
+        case YamlType::STRING:
+            stringValue_ = new std::string(*other.stringValue_);
+            break;
+        case YamlType::SEQUENCE:
+            sequenceValue_ = new Sequence(*other.sequenceValue_);
+            break;
+        case YamlType::MAPPING:
+            mappingValue_ = new Mapping(*other.mappingValue_);
+            break;
+        }
+    }
+
+    void YamlValue::moveFrom(YamlValue &other)
+    {
+        type_ = other.type_;
+        switch (type_)
+        {
+        case YamlType::NIL:
+            break;
+        case YamlType::BOOLEAN:
+            boolValue_ = other.boolValue_;
+            break;
+        case YamlType::NUMBER:
+            numberValue_ = other.numberValue_;
+            break;
+        case YamlType::STRING:
+            stringValue_ = other.stringValue_;
+            other.stringValue_ = nullptr;
+            break;
+        case YamlType::SEQUENCE:
+            sequenceValue_ = other.sequenceValue_;
+            other.sequenceValue_ = nullptr;
+            break;
+        case YamlType::MAPPING:
+            mappingValue_ = other.mappingValue_;
+            other.mappingValue_ = nullptr;
+            break;
+        }
+        other.type_ = YamlType::NIL;
+    }
+
+    bool YamlValue::asBool() const
+    {
+        if (type_ != YamlType::BOOLEAN)
+        {
+            throw YamlException("Value is not a boolean");
+        }
+        return boolValue_;
+    }
+
+    double YamlValue::asNumber() const
+    {
+        if (type_ != YamlType::NUMBER)
+        {
+            throw YamlException("Value is not a number");
+        }
+        return numberValue_;
+    }
+
+    int YamlValue::asInt() const
+    {
+        return static_cast<int>(asNumber());
+    }
+
+    const std::string &YamlValue::asString() const
+    {
+        if (type_ != YamlType::STRING)
+        {
+            throw YamlException("Value is not a string");
+        }
+        return *stringValue_;
+    }
+
+    YamlValue::Sequence &YamlValue::asSequence()
+    {
+        if (type_ != YamlType::SEQUENCE)
+        {
+            throw YamlException("Value is not a sequence");
+        }
+        return *sequenceValue_;
+    }
+
+    const YamlValue::Sequence &YamlValue::asSequence() const
+    {
+        if (type_ != YamlType::SEQUENCE)
+        {
+            throw YamlException("Value is not a sequence");
+        }
+        return *sequenceValue_;
+    }
+
+    YamlValue::Mapping &YamlValue::asMapping()
+    {
+        if (type_ != YamlType::MAPPING)
+        {
+            throw YamlException("Value is not a mapping");
+        }
+        return *mappingValue_;
+    }
+
+    const YamlValue::Mapping &YamlValue::asMapping() const
+    {
+        if (type_ != YamlType::MAPPING)
+        {
+            throw YamlException("Value is not a mapping");
+        }
+        return *mappingValue_;
+    }
+
+    size_t YamlValue::size() const
+    {
+        switch (type_)
+        {
+        case YamlType::SEQUENCE:
+            return sequenceValue_->size();
+        case YamlType::MAPPING:
+            return mappingValue_->size();
+        case YamlType::STRING:
+            return stringValue_->size();
+        default:
+            return 0;
+        }
+    }
+
+    bool YamlValue::empty() const
+    {
+        return size() == 0;
+    }
+
+    namespace detail
+    {
+        // A Mapping key given as pointer and length; a std::string copy
+        // where heterogeneous lookup needs a later standard than the build's
+#if __cplusplus >= 201402L
+        struct KeySpan
+        {
+            const char *ptr;
+            size_t length;
+
+            const char *data() const { return ptr; }
+            size_t size() const { return length; }
+        };
+
+        inline KeySpan mappingKey(const char *key, size_t length) { return KeySpan{key, length}; }
+#else
+        inline std::string mappingKey(const char *key, size_t length) { return std::string(key, length); }
+#endif
+    }
+
+    bool YamlValue::contains(const std::string &key) const
+    {
+        return find_(key.data(), key.size()) != nullptr;
+    }
+
+    const YamlValue *YamlValue::find_(const char *key, size_t length) const
+    {
+        YAML_ACCESS_HIT(key, length);
+        if (type_ != YamlType::MAPPING)
+        {
+            return nullptr;
+        }
+        auto it = mappingValue_->find(detail::mappingKey(key, length));
+        return it == mappingValue_->end() ? nullptr : &it->second;
+    }
+
+    void YamlValue::clear()
+    {
+        cleanup();
+        type_ = YamlType::NIL;
+    }
+
+    YamlValue &YamlValue::operator[](const std::string &key)
+    {
+        return insert_(key.data(), key.size());
+    }
+
+    YamlValue &YamlValue::insert_(const char *key, size_t length)
+    {
+        YAML_ALLOC_PHASE(VALUE);
+        YAML_ACCESS_HIT(key, length);
+        if (type_ == YamlType::NIL)
+        {
+            type_ = YamlType::MAPPING;
+            mappingValue_ = new Mapping();
+        }
+        if (type_ != YamlType::MAPPING)
+        {
+            throw YamlException("Value is not a mapping");
+        }
+        auto it = mappingValue_->lower_bound(detail::mappingKey(key, length));
+        if (it == mappingValue_->end() ||
+            detail::compareKeys(key, length, it->first.data(), it->first.size()) != 0)
+        {
+            it = mappingValue_->emplace_hint(it, std::string(key, length), YamlValue());
+        }
+        return it->second;
+    }
+
+    const YamlValue &YamlValue::operator[](const std::string &key) const
+    {
+        return at_(key.data(), key.size());
+    }
+
+    const YamlValue &YamlValue::at_(const char *key, size_t length) const
+    {
+        if (type_ != YamlType::MAPPING)
+        {
+            YAML_ACCESS_HIT(key, length);
+            throw YamlException("Value is not a mapping");
+        }
+        const YamlValue *value = find_(key, length);
+        if (!value)
+        {
+            throw YamlException("Key not found: " + std::string(key, length));
+        }
+        return *value;
+    }
+
+    YamlValue &YamlValue::operator[](size_t index)
+    {
+        YAML_ACCESS_HIT(index);
+        if (type_ == YamlType::NIL)
+        {
+            type_ = YamlType::SEQUENCE;
+            sequenceValue_ = new Sequence();
+        }
+        if (type_ != YamlType::SEQUENCE)
+        {
+            throw YamlException("Value is not a sequence");
+        }
+        if (index >= sequenceValue_->size())
+        {
+            sequenceValue_->resize(index + 1);
+        }
+        return (*sequenceValue_)[index];
+    }
+
+    const YamlValue &YamlValue::operator[](size_t index) const
+    {
+        YAML_ACCESS_HIT(index);
+        if (type_ != YamlType::SEQUENCE)
+        {
+            throw YamlException("Value is not a sequence");
+        }
+        if (index >= sequenceValue_->size())
+        {
+            throw YamlException("Index out of bounds");
+        }
+        return (*sequenceValue_)[index];
+    }
+
+    namespace detail
+    {
+        // Mirrors the scanner's plain-scalar number rule: -?digits(.digits)?
+        bool looksNumeric(const std::string &s)
+        {
+            size_t i = (!s.empty() && s[0] == '-') ? 1 : 0;
+            size_t digits = i;
+            while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+                i++;
+            if (i == digits)
+                return false;
+            if (i < s.size() && s[i] == '.')
+            {
+                size_t frac = ++i;
+                while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+                    i++;
+                if (i == frac)
+                    return false;
+            }
+            return i == s.size();
+        }
+
+        bool needsQuotes(const std::string &str)
+        {
+            if (str.empty() || str == "true" || str == "false" || str == "null" || str == "~" ||
+                looksNumeric(str))
+                return true;
+
+            char first = str.front();
+            char last = str.back();
+            if (first == ' ' || first == '\t' || last == ' ' || last == '\t' ||
+                first == '"' || first == '\'' || first == '!' || last == '-')
+                return true;
+
+            for (size_t i = 0; i < str.size(); ++i)
+            {
+                switch (str[i])
+                {
+                case '\n':
+                case '\r':
+                case ':':
+                case '#':
+                case ',':
+                case '[':
+                case ']':
+                case '{':
+                case '}':
+                    return true;
+                case '-':
+                    if (i + 1 < str.size() && str[i + 1] == ' ')
+                        return true;
+                    break;
+                }
+            }
+            return false;
+        }
+
+        void writeString(std::ostringstream &oss, const std::string &str)
+        {
+            if (!needsQuotes(str))
+            {
+                oss << str;
+                return;
+            }
+
+            oss << "\"";
+            for (char c : str)
+            {
+                switch (c)
+                {
+                case '"':
+                    oss << "\\\"";
+                    break;
+                case '\\':
+                    oss << "\\\\";
+                    break;
+                case '\n':
+                    oss << "\\n";
+                    break;
+                case '\r':
+                    oss << "\\r";
+                    break;
+                case '\t':
+                    oss << "\\t";
+                    break;
+                default:
+                    oss << c;
+                    break;
+                }
+            }
+            oss << "\"";
+        }
+
+        // Shortest of 15 or 17 significant digits that reads back exactly,
+        // spelled without an exponent since the scanner has no syntax for one
+        void writeNumber(std::ostringstream &oss, double v)
+        {
+            if (v != v)
+            {
+                oss << ".nan";
+                return;
+            }
+            if (v > 1.7976931348623157e308 || v < -1.7976931348623157e308)
+            {
+                oss << (v < 0 ? "-.inf" : ".inf");
+                return;
+            }
+            if (v > -1e15 && v < 1e15 && v == static_cast<double>(static_cast<long long>(v)))
+            {
+                oss << static_cast<long long>(v);
+                return;
+            }
+
+            char buf[40];
+#ifdef YAML_CPP17
+            // Shortest digits that read back exactly
+            *std::to_chars(buf, buf + sizeof(buf) - 1, v, std::chars_format::scientific).ptr = '\0';
+#else
+            int precision = 15;
+            std::snprintf(buf, sizeof(buf), "%.*e", precision - 1, v);
+            if (std::strtod(buf, nullptr) != v)
+            {
+                precision = 17;
+                std::snprintf(buf, sizeof(buf), "%.*e", precision - 1, v);
+            }
+#endif
+
+            // buf is [-]d.ddde[+-]xx
+            const char *p = buf;
+            bool negative = (*p == '-');
+            if (negative)
+                p++;
+            std::string digits;
+            while (*p && *p != 'e')
+            {
+                if (*p != '.')
+                    digits += *p;
+                p++;
+            }
+            int exponent = (*p == 'e') ? std::atoi(p + 1) : 0;
+            while (digits.size() > 1 && digits.back() == '0')
+                digits.pop_back();
+
+            // Decimal point goes after digit index exponent
+            std::string text;
+            int point = exponent + 1;
+            if (point <= 0)
+            {
+                text = "0." + std::string(-point, '0') + digits;
+            }
+            else if (point >= static_cast<int>(digits.size()))
+            {
+                text = digits + std::string(point - digits.size(), '0');
+            }
+            else
+            {
+                text = digits.substr(0, point) + "." + digits.substr(point);
+            }
+
+            if (negative)
+                oss << '-';
+            oss << text;
+        }
+    }
+
+    void appendScalar(std::string &out, const std::string &value)
+    {
+        if (!detail::needsQuotes(value))
+        {
+            out += value;
+            return;
+        }
+        std::ostringstream oss;
+        detail::writeString(oss, value);
+        out += oss.str();
+    }
+
+    void appendScalar(std::string &out, double value)
+    {
+        if (value > -1e15 && value < 1e15 && value == static_cast<double>(static_cast<long long>(value)))
+        {
+            char buf[24];
+            int n = std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value));
+            out.append(buf, n);
+            return;
+        }
+        std::ostringstream oss;
+        detail::writeNumber(oss, value);
+        out += oss.str();
+    }
+
+    std::string YamlValue::serialize(int indent) const
+    {
+        YAML_ALLOC_PHASE(SERIALIZER);
+        YAML_TRACE_SPAN("serialize", std::string());
+        std::ostringstream oss;
+        serializeValue(oss, indent);
+        return oss.str();
+    }
+
+    // inArray: the value follows "- " on the current line, so its first line
+    // is not indented
+    void YamlValue::serializeValue(std::ostringstream &oss, int indent, bool inArray) const
+    {
+        switch (type_)
+        {
+        case YamlType::NIL:
+            oss << "null";
+            break;
+
+        case YamlType::BOOLEAN:
+            oss << (boolValue_ ? "true" : "false");
+            break;
+
+        case YamlType::NUMBER:
+            detail::writeNumber(oss, numberValue_);
+            break;
+
+        case YamlType::STRING:
+            detail::writeString(oss, *stringValue_);
+            break;
+
+        case YamlType::SEQUENCE:
+        {
+            if (sequenceValue_->empty())
+            {
+                oss << "[]";
+            }
+            else
+            {
+                for (size_t i = 0; i < sequenceValue_->size(); ++i)
+                {
+                    if (i > 0)
+                        oss << "\n";
+                    if (i > 0 || !inArray)
+                        oss << std::string(indent, ' ');
+
+                    // Only the first token of a line carries an indent, so
+                    // an item that opens a block on the dash line
+                    // (a sequence, or a mapping whose first value is a block)
+                    // goes on the following lines instead
+                    const YamlValue &item = (*sequenceValue_)[i];
+                    bool blockFirst = false;
+                    if (item.isSequence())
+                    {
+                        blockFirst = !item.empty();
+                    }
+                    else if (item.isMapping() && !item.empty())
+                    {
+                        const YamlValue &firstValue = item.asMapping().begin()->second;
+                        blockFirst = (firstValue.isMapping() || firstValue.isSequence()) && !firstValue.empty();
+                    }
+
+                    if (blockFirst)
+                    {
+                        oss << "-\n";
+                        item.serializeValue(oss, indent + 2);
+                    }
+                    else
+                    {
+                        oss << "- ";
+                        item.serializeValue(oss, indent + 2, true);
+                    }
+                }
+            }
+            break;
+        }
+
+        case YamlType::MAPPING:
+        {
+            if (mappingValue_->empty())
+            {
+                oss << "{}";
+            }
+            else
+            {
+                bool first = true;
+                for (const auto &pair : *mappingValue_)
+                {
+                    if (!first)
+                        oss << "\n";
+                    if (!first || !inArray)
+                        oss << std::string(indent, ' ');
+                    first = false;
+
+                    detail::writeString(oss, pair.first);
+                    oss << ":";
+
+                    const YamlValue &value = pair.second;
+                    if ((value.isMapping() || value.isSequence()) && !value.empty())
+                    {
+                        oss << "\n";
+                        value.serializeValue(oss, indent + 2);
+                    }
+                    else
+                    {
+                        oss << " ";
+                        value.serializeValue(oss, indent + 2);
+                    }
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    void YamlValue::trace() const
+    {
+        std::cout << "YamlValue Trace:" << std::endl;
+        std::cout << "Type: " << static_cast<int>(type_) << std::endl;
+        std::cout << "Size: " << size() << std::endl;
+        if (type_ == YamlType::STRING)
+        {
+            std::cout << "String Value: " << *stringValue_ << std::endl;
+        }
+        else if (type_ == YamlType::NUMBER)
+        {
+            std::cout << "Number Value: " << numberValue_ << std::endl;
+        }
+        else if (type_ == YamlType::BOOLEAN)
+        {
+            std::cout << "Boolean Value: " << (boolValue_ ? "true" : "false") << std::endl;
+        }
+        else if (type_ == YamlType::SEQUENCE)
+        {
+            std::cout << "Sequence Values:" << std::endl;
+            for (size_t i = 0; i < sequenceValue_->size(); ++i)
+            {
+                std::cout << "  [" << i << "] ";
+                (*sequenceValue_)[i].trace();
+            }
+        }
+        else if (type_ == YamlType::MAPPING)
+        {
+            std::cout << "Mapping Values:" << std::endl;
+            for (const auto &pair : *mappingValue_)
+            {
+                std::cout << "  Key: " << pair.first << std::endl;
+                pair.second.trace();
+            }
+        }
+        else
+        {
+            std::cout << "Nil Value" << std::endl;
+        }
+    }
+
+    bool YamlValue::operator==(const YamlValue &other) const
+    {
+        if (type_ != other.type_)
+            return false;
+
+        switch (type_)
+        {
+        case YamlType::NIL:
+            return true;
+        case YamlType::BOOLEAN:
+            return boolValue_ == other.boolValue_;
+        case YamlType::NUMBER:
+            return numberValue_ == other.numberValue_;
+        case YamlType::STRING:
+            return *stringValue_ == *other.stringValue_;
+        case YamlType::SEQUENCE:
+            return *sequenceValue_ == *other.sequenceValue_;
+        case YamlType::MAPPING:
+            return *mappingValue_ == *other.mappingValue_;
+        }
+        return false;
+    }
+
+    // ============================================================================
+    // Token Implementation
+    // ============================================================================
+
+    Token::Token() : type(TokenType::TOKEN_EOF), line(0), column(0), indent(0) {}
+
+    Token::Token(TokenType t, std::string val, int ln, int col, int ind)
+        : type(t), value(std::move(val)), line(ln), column(col), indent(ind) {}
+
+    // ============================================================================
+    // Scanner Implementation
+    // ============================================================================
+
+    namespace detail
+    {
+        // Heap owned by s, 0 while it fits the small-string buffer
+        size_t stringHeapBytes(const std::string &s)
+        {
+            const char *data = s.data();
+            const char *self = reinterpret_cast<const char *>(&s);
+            if (data >= self && data < self + sizeof(std::string))
+                return 0;
+            return s.capacity() + 1;
+        }
+
+        // Scanner character classes: the low three bits are the byte's input
+        // to numberStep, the rest flag what ends or skips a plain scalar
+        enum : unsigned char
+        {
+            CHAR_OTHER = 0,
+            CHAR_DIGIT = 1,
+            CHAR_MINUS = 2,
+            CHAR_DOT = 3,
+            CHAR_BLANK = 4,      // ' ', trimmed from the end of a plain scalar
+            CHAR_INPUT = 0x07,   // mask for the numberStep column
+            CHAR_SPACE = 0x08,   // ' ', '\t', '\r'
+            CHAR_NEWLINE = 0x10, // '\n'
+            CHAR_COLON = 0x20,
+            CHAR_HASH = 0x40,    // a comment when Policy::comments
+            CHAR_FLOW = 0x80     // "[]{}," when Policy::flowCollections
+        };
+
+        const unsigned char charClass[256] = {
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x10, 0x00, 0x00, 0x08, 0x00, 0x00, // 0_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 1_
+            0x0c, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x02, 0x03, 0x00, // 2_
+            0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, // 3_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 4_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x80, 0x00, 0x00, // 5_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 6_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x80, 0x00, 0x00, // 7_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 8_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 9_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // A_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // B_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // C_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // D_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // E_
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // F_
+        };
+
+        // -?[0-9]+(\.[0-9]+)? followed by blanks, run over a plain scalar
+        // as it is copied
+        enum NumberState
+        {
+            NUM_START,
+            NUM_SIGN,
+            NUM_INT,      // accepting
+            NUM_POINT,
+            NUM_FRACTION, // accepting
+            NUM_TAIL,     // accepting: a number then trailing blanks
+            NUM_NONE
+        };
+
+        // Indexed by state, then by other/digit/minus/dot/blank
+        const unsigned char numberStep[7][5] = {
+            {NUM_NONE, NUM_INT, NUM_SIGN, NUM_NONE, NUM_NONE},      // NUM_START
+            {NUM_NONE, NUM_INT, NUM_NONE, NUM_NONE, NUM_NONE},      // NUM_SIGN
+            {NUM_NONE, NUM_INT, NUM_NONE, NUM_POINT, NUM_TAIL},     // NUM_INT
+            {NUM_NONE, NUM_FRACTION, NUM_NONE, NUM_NONE, NUM_NONE}, // NUM_POINT
+            {NUM_NONE, NUM_FRACTION, NUM_NONE, NUM_NONE, NUM_TAIL}, // NUM_FRACTION
+            {NUM_NONE, NUM_NONE, NUM_NONE, NUM_NONE, NUM_TAIL},     // NUM_TAIL
+            {NUM_NONE, NUM_NONE, NUM_NONE, NUM_NONE, NUM_NONE},     // NUM_NONE
+        };
+
+        inline unsigned char classOf(char c)
+        {
+            return charClass[static_cast<unsigned char>(c)];
+        }
+
+        inline bool isNumberState(int state)
+        {
+            return state == NUM_INT || state == NUM_FRACTION || state == NUM_TAIL;
+        }
+
+        // true, false, null and ~ by length, then one compare
+        TokenType reservedWord(const char *s, size_t n)
+        {
+            switch (n)
+            {
+            case 1:
+                if (*s == '~')
+                    return TokenType::TOKEN_NULL;
+                break;
+            case 4:
+                if (std::memcmp(s, "true", 4) == 0)
+                    return TokenType::TOKEN_BOOLEAN;
+                if (std::memcmp(s, "null", 4) == 0)
+                    return TokenType::TOKEN_NULL;
+                break;
+            case 5:
+                if (std::memcmp(s, "false", 5) == 0)
+                    return TokenType::TOKEN_BOOLEAN;
+                break;
+            }
+            return TokenType::TOKEN_STRING;
+        }
+    }
+
+    template <typename Policy>
+    BasicScanner<Policy>::BasicScanner(const std::string &src)
+        : s_(&src), source_(nullptr), cancel_(nullptr), base_(0), cur_(0), line_(1), col_(1), bol_(true),
+          lineIndent_(-1)
+    {
+    }
+
+    template <typename Policy>
+    BasicScanner<Policy>::BasicScanner(InputSource &source)
+        : s_(&window_), source_(&source), cancel_(nullptr), base_(0), cur_(0), line_(1), col_(1), bol_(true),
+          lineIndent_(-1)
+    {
+    }
+
+    template <typename Policy>
+    size_t BasicScanner<Policy>::heldBytes() const
+    {
+        return detail::stringHeapBytes(window_);
+    }
+
+    template <typename Policy>
+    Token BasicScanner<Policy>::next()
+    {
+        YAML_ALLOC_PHASE(SCANNER);
+
+        // Tokens own their text, so everything before cur_ can be dropped
+        if (source_ && cur_ >= 64 * 1024)
+        {
+            window_.erase(0, cur_);
+            base_ += cur_;
+            cur_ = 0;
+        }
+
+        while (!isAtEnd_())
+        {
+            if (bol_)
+            {
+                // Carried by the line's first token; -1 for an empty/comment line
+                lineIndent_ = measureIndent_();
+                bol_ = false;
+            }
+
+            char c = peek_();
+            unsigned char cls = detail::classOf(c);
+
+            // Skip whitespace (except newlines)
+            if (cls & detail::CHAR_SPACE)
+            {
+                advance_();
+                continue;
+            }
+
+            // Comments
+            if (Policy::comments && (cls & detail::CHAR_HASH))
+            {
+                skipToEOL_();
+                continue;
+            }
+
+            // Newlines
+            if (cls & detail::CHAR_NEWLINE)
+            {
+                advance_();
+                bol_ = true;
+                return make_(TokenType::TOKEN_NEWLINE);
+            }
+
+            // Structural characters
+            switch (c)
+            {
+            case ':':
+                advance_();
+                return make_(TokenType::TOKEN_COLON);
+            case '-':
+                if (peekNext_() == ' ' || peekNext_() == '\n' || peekNext_() == '\0')
+                {
+                    advance_();
+                    return make_(TokenType::TOKEN_DASH);
+                }
+                // Fall through to string parsing
+                break;
+            case '[':
+                if (!Policy::flowCollections)
+                    break;
+                advance_();
+                return make_(TokenType::TOKEN_LBRACKET);
+            case ']':
+                if (!Policy::flowCollections)
+                    break;
+                advance_();
+                return make_(TokenType::TOKEN_RBRACKET);
+            case '{':
+                if (!Policy::flowCollections)
+                    break;
+                advance_();
+                return make_(TokenType::TOKEN_LBRACE);
+            case '}':
+                if (!Policy::flowCollections)
+                    break;
+                advance_();
+                return make_(TokenType::TOKEN_RBRACE);
+            case ',':
+                if (!Policy::flowCollections)
+                    break;
+                advance_();
+                return make_(TokenType::TOKEN_COMMA);
+            }
+
+            // The `!include` tag; any other '!' word stays part of a plain scalar
+            if (c == '!' && s_->compare(cur_, 8, "!include") == 0 &&
+                (cur_ + 8 == s_->size() ||
+                 (detail::classOf((*s_)[cur_ + 8]) & (detail::CHAR_SPACE | detail::CHAR_NEWLINE))))
+            {
+                for (int i = 0; i < 8; ++i)
+                    advance_();
+                return make_(TokenType::TOKEN_TAG, "!include");
+            }
+
+            // Quoted strings
+            if (c == '"' || c == '\'')
+            {
+                char quote = advance_();
+                if (!Policy::quotedEscapes)
+                {
+                    // Verbatim up to the closing quote, sliced once
+                    size_t start = cur_;
+                    while (!isAtEnd_() && peek_() != quote)
+                        advance_();
+                    std::string str(s_->data() + start, cur_ - start);
+                    if (!isAtEnd_())
+                        advance_(); // Skip closing quote
+                    return make_(TokenType::TOKEN_STRING, std::move(str));
+                }
+                std::string str;
+                while (!isAtEnd_() && peek_() != quote)
+                {
+                    if (peek_() == '\\')
+                    {
+                        advance_(); // Skip backslash
+                        if (!isAtEnd_())
+                        {
+                            char escaped = advance_();
+                            switch (escaped)
+                            {
+                            case 'n':
+                                str += '\n';
+                                break;
+                            case 't':
+                                str += '\t';
+                                break;
+                            case 'r':
+                                str += '\r';
+                                break;
+                            case '\\':
+                                str += '\\';
+                                break;
+                            case '"':
+                                str += '"';
+                                break;
+                            case '\'':
+                                str += '\'';
+                                break;
+                            default:
+                                str += escaped;
+                                break;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        str += advance_();
+                    }
+                }
+                if (!isAtEnd_())
+                    advance_(); // Skip closing quote
+                return make_(TokenType::TOKEN_STRING, std::move(str));
+            }
+
+            // Everything else: read until delimiter. The text is copied out
+            // of the buffer once at the end; start stays valid because the
+            // window is only trimmed on entry to next(). One class lookup per
+            // byte finds the delimiter and runs the number DFA.
+            const unsigned char stop = detail::CHAR_NEWLINE | detail::CHAR_COLON |
+                                       (Policy::comments ? detail::CHAR_HASH : 0) |
+                                       (Policy::flowCollections ? detail::CHAR_FLOW : 0);
+            size_t start = cur_;
+            int number = detail::NUM_START;
+            while (!isAtEnd_())
+            {
+                unsigned char cc = detail::classOf(peek_());
+                if (cc & stop)
+                    break;
+
+                // Stop at dash if it's a list item marker (dash followed by space)
+                if ((cc & detail::CHAR_INPUT) == detail::CHAR_MINUS &&
+                    (peekNext_() == '\0' || peekNext_() == ' ' || peekNext_() == '\n'))
+                {
+                    break;
+                }
+
+                number = detail::numberStep[number][cc & detail::CHAR_INPUT];
+                advance_();
+            }
+
+            // Trim trailing spaces
+            size_t end = cur_;
+            while (end > start && (*s_)[end - 1] == ' ')
+            {
+                end--;
+            }
+
+            if (end > start)
+            {
+                const char *text = s_->data() + start;
+                TokenType type = detail::reservedWord(text, end - start);
+                if (type == TokenType::TOKEN_STRING && Policy::numbers && detail::isNumberState(number))
+                    type = TokenType::TOKEN_NUMBER;
+                return make_(type, std::string(text, end - start));
+            }
+
+            // Skip unknown single characters
+            advance_();
+        }
+
+        // EOF is at column 0, closing every block
+        lineIndent_ = 0;
+        return make_(TokenType::TOKEN_EOF);
+    }
+
+    template <typename Policy>
+    bool BasicScanner<Policy>::fill_()
+    {
+        if (!source_)
+            return false;
+        if (cancel_ && cancel_->cancelled())
+            throw ParseCancelled(posLine_(), posCol_());
+        char chunk[64 * 1024];
+        size_t n = source_->read(chunk, sizeof(chunk));
+        window_.append(chunk, n);
+        return n > 0;
+    }
+
+    template <typename Policy>
+    bool BasicScanner<Policy>::isAtEnd_()
+    {
+        return cur_ >= s_->size() && !fill_();
+    }
+
+    template <typename Policy>
+    char BasicScanner<Policy>::peek_()
+    {
+        if (isAtEnd_())
+            return '\0';
+        return (*s_)[cur_];
+    }
+
+    template <typename Policy>
+    char BasicScanner<Policy>::peekNext_()
+    {
+        while (cur_ + 1 >= s_->size())
+        {
+            if (!fill_())
+                return '\0';
+        }
+        return (*s_)[cur_ + 1];
+    }
+
+    template <typename Policy>
+    char BasicScanner<Policy>::advance_()
+    {
+        if (isAtEnd_())
+            return '\0';
+        char c = (*s_)[cur_++];
+        if (!Policy::positions)
+            return c;
+        if (c == '\n')
+        {
+            line_++;
+            col_ = 1;
+        }
+        else
+        {
+            col_++;
+        }
+        return c;
+    }
+
+    template <typename Policy>
+    void BasicScanner<Policy>::skipToEOL_()
+    {
+        while (!isAtEnd_() && peek_() != '\n')
+        {
+            advance_();
+        }
+    }
+
+    template <typename Policy>
+    int BasicScanner<Policy>::measureIndent_()
+    {
+        size_t start = cur_;
+        int spaces = 0;
+
+        while (!isAtEnd_() && (peek_() == ' ' || peek_() == '\t'))
+        {
+            if (peek_() == ' ')
+            {
+                spaces++;
+            }
+            else
+            {
+                spaces += 8; // Tab = 8 spaces
+            }
+            cur_++;
+            if (Policy::positions)
+                col_++;
+        }
+
+        // Check if line is empty or comment
+        if (isAtEnd_() || peek_() == '\n' || (Policy::comments && peek_() == '#'))
+        {
+            cur_ = start; // Reset position
+            if (Policy::positions)
+                col_ -= spaces; // Reset column
+            return -1;          // Signal empty/comment line
+        }
+
+        return spaces;
+    }
+
+    template <typename Policy>
+    Token BasicScanner<Policy>::make_(TokenType t, std::string v)
+    {
+        Token token(t, std::move(v), posLine_(), posCol_(), lineIndent_);
+        lineIndent_ = -1;
+        return token;
+    }
+
+    template <typename Policy>
+    int BasicScanner<Policy>::countSpaces_(const std::string &s, size_t pos, size_t &outPos)
+    {
+        int spaces = 0;
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t'))
+        {
+            spaces += (s[pos] == ' ') ? 1 : 8;
+            pos++;
+        }
+        outPos = pos;
+        return spaces;
+    }
+
+    // ============================================================================
+    // Parser Implementation
+    // ============================================================================
+
+    namespace detail
+    {
+        // Token text to double; the scanner has already checked the syntax
+        double parseNumber(const std::string &text)
+        {
+#ifdef YAML_CPP17
+            double value = 0;
+            if (std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc())
+                return value;
+#endif
+            return std::stod(text); // reports out-of-range values
+        }
+    }
+
+    template <typename Policy>
+    BasicParser<Policy>::BasicParser(InputSource &source)
+        : sc_(source), includes_(nullptr), stats_(nullptr), trackMemory_(false), memoryLimit_(0),
+          inputBytes_(0), transientBytes_(0), treeBytes_(0), peakBytes_(0), watched_(false), cancel_(nullptr),
+          progressInterval_(0), nextProgress_(0), nodes_(0)
+    {
+        YAML_ALLOC_PHASE(PARSER);
+        advance_(); // Load first token
+        advance_(); // Load second token (lookahead)
+    }
+
+    template <typename Policy>
+    BasicParser<Policy>::BasicParser(const std::string &src)
+        : sc_(src), includes_(nullptr), stats_(nullptr), trackMemory_(false), memoryLimit_(0),
+          inputBytes_(src.size()), transientBytes_(0), treeBytes_(0), peakBytes_(0), watched_(false),
+          cancel_(nullptr), progressInterval_(0), nextProgress_(0), nodes_(0)
+    {
+        YAML_ALLOC_PHASE(PARSER);
+        advance_(); // Load first token
+        advance_(); // Load second token (lookahead)
+
+        // Debug: imprimir os primeiros tokens
+        /*
+        std::cout << "First token: " << static_cast<int>(cur_.type) << " = '" << cur_.value << "'" << std::endl;
+        std::cout << "Second token: " << static_cast<int>(nxt_.type) << " = '" << nxt_.value << "'" << std::endl;
+        */
+    }
+
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parse()
+    {
+        YAML_ALLOC_PHASE(PARSER);
+#ifdef YAML_TRACE
+        if (!stats_ && Trace::active())
+            return detail::traceParse(*this);
+#endif
+
+        while (at_(TokenType::TOKEN_NEWLINE) || opensBlock_())
+        {
+            advance_();
+        }
+
+        if (at_(TokenType::TOKEN_EOF))
+        {
+            return YamlValue(); // Documento vazio
+        }
+
+        if (trackMemory_)
+            charge_(sizeof(YamlValue));
+        return parseValue_();
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::pushKey_(const std::string &key)
+    {
+        if (!includes_)
+            return;
+        PathStep step;
+        step.key = key;
+        path_.push_back(step);
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::pushIndex_(size_t index)
+    {
+        if (!includes_)
+            return;
+        PathStep step;
+        step.isIndex = true;
+        step.index = index;
+        path_.push_back(step);
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::popPath_()
+    {
+        if (includes_)
+            path_.pop_back();
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::advance_()
+    {
+        // A line that opens or closes blocks is entered one block at a time
+        if (!indents_.inside(cur_.indent))
+        {
+            indents_.step(cur_.indent);
+            checkIndent_();
+            return;
+        }
+
+        cur_ = std::move(nxt_);
+        if (!stats_)
+        {
+            nxt_ = sc_.next();
+        }
+        else
+        {
+            bool ended = (nxt_.type == TokenType::TOKEN_EOF);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            nxt_ = sc_.next();
+            stats_->scanMs +=
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (!ended)
+                stats_->tokens[static_cast<int>(nxt_.type)]++;
+        }
+        checkIndent_();
+        if (trackMemory_)
+            trackTransient_();
+        if (watched_)
+            poll_();
+    }
+
+    // Once cur_ is inside its block, the next line has to line up with an
+    // open one
+    template <typename Policy>
+    void BasicParser<Policy>::checkIndent_()
+    {
+        if (indents_.inside(cur_.indent) && !indents_.aligned(nxt_.indent))
+        {
+            throw YamlException("Invalid indentation level", nxt_.line, nxt_.column);
+        }
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::collectStats(ParseStats *stats)
+    {
+        stats_ = stats;
+        if (!stats_)
+            return;
+        if (!trackMemory_)
+        {
+            trackMemory_ = true;
+            trackTransient_();
+        }
+
+        // The constructor already scanned the first two tokens
+        stats_->tokens[static_cast<int>(cur_.type)]++;
+        if (cur_.type != TokenType::TOKEN_EOF)
+            stats_->tokens[static_cast<int>(nxt_.type)]++;
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::applyOptions(const ParseOptions &options)
+    {
+        memoryLimit_ = options.memoryLimit;
+        if (options.memoryLimit && !trackMemory_)
+        {
+            trackMemory_ = true;
+            trackTransient_();
+        }
+        if (options.stats)
+            collectStats(options.stats);
+
+        cancel_ = options.cancel;
+        sc_.setCancel(cancel_);
+        progress_ = options.progress;
+        progressInterval_ = std::max<size_t>(1, options.progressInterval);
+        nextProgress_ = sc_.offset() + progressInterval_;
+        watched_ = cancel_ || progress_;
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::poll_()
+    {
+        if (cancel_ && cancel_->cancelled())
+            throw ParseCancelled(cur_.line, cur_.column);
+        if (progress_ && sc_.offset() >= nextProgress_)
+        {
+            nextProgress_ = sc_.offset() + progressInterval_;
+            ParseProgress progress;
+            progress.bytes = sc_.offset();
+            progress.nodes = nodes_;
+            progress_(progress);
+        }
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::charge_(size_t bytes)
+    {
+        treeBytes_ += bytes;
+        size_t live = inputBytes_ + transientBytes_ + treeBytes_;
+        peakBytes_ = std::max(peakBytes_, live);
+        if (memoryLimit_ && live > memoryLimit_)
+        {
+            throw YamlException("Memory limit exceeded: " + std::to_string(live) + " bytes tracked, limit " +
+                                    std::to_string(memoryLimit_),
+                                cur_.line, cur_.column);
+        }
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::release_(size_t bytes)
+    {
+        treeBytes_ -= std::min(bytes, treeBytes_);
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::trackTransient_()
+    {
+        transientBytes_ = sc_.heldBytes() + indents_.heldBytes() + detail::stringHeapBytes(cur_.value) +
+                          detail::stringHeapBytes(nxt_.value);
+        charge_(0);
+    }
+
+    // push_back that charges a grown buffer before the old one is released,
+    // as the reallocation holds both
+    template <typename Policy>
+    void BasicParser<Policy>::append_(YamlValue::Sequence &seq, YamlValue &&value)
+    {
+        if (!trackMemory_)
+        {
+            seq.push_back(std::move(value));
+            return;
+        }
+        size_t before = seq.capacity();
+        seq.push_back(std::move(value));
+        if (seq.capacity() != before)
+        {
+            charge_(seq.capacity() * sizeof(YamlValue));
+            release_(before * sizeof(YamlValue));
+        }
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::insert_(YamlValue::Mapping &map, std::string &&key, YamlValue &&value)
+    {
+        if (trackMemory_)
+        {
+            // Same node estimate as ParseStats::documentBytes
+            charge_(4 * sizeof(void *) + sizeof(YamlValue::Mapping::value_type) + detail::stringHeapBytes(key));
+        }
+        map[std::move(key)] = std::move(value);
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::checkKey_(const YamlValue::Mapping &map)
+    {
+        if (Policy::duplicateKeyCheck && map.find(cur_.value) != map.end())
+        {
+            throw YamlException("Duplicate key: " + cur_.value, cur_.line, cur_.column);
+        }
+    }
+
+    template <typename Policy>
+    bool BasicParser<Policy>::match_(TokenType t)
+    {
+        if (at_(t))
+        {
+            advance_();
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Policy>
+    void BasicParser<Policy>::expect_(TokenType t, const char *msg)
+    {
+        if (!match_(t))
+        {
+            throw YamlException(msg, cur_.line, cur_.column);
+        }
+    }
+
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parseValue_()
+    {
+        // Skip newlines
+        while (at_(TokenType::TOKEN_NEWLINE))
+        {
+            advance_();
+        }
+
+        if (opensBlock_())
+        {
+            advance_(); // enter the block
+            YamlValue value = parseValue_();
+            while (at_(TokenType::TOKEN_NEWLINE))
+            {
+                advance_();
+            }
+            // The value that opened a block closes exactly one
+            if (closesBlock_())
+            {
+                advance_();
+            }
+            return value;
+        }
+        if (closesBlock_())
+        {
+            return parseScalar_(); // nothing at this level: reports the missing value
+        }
+
+        switch (cur_.type)
+        {
+        case TokenType::TOKEN_LBRACE:
+            return parseFlowMap_();
+        case TokenType::TOKEN_LBRACKET:
+            return parseFlowSeq_();
+        case TokenType::TOKEN_DASH:
+            return parseSequence_();
+        case TokenType::TOKEN_TAG:
+        {
+            advance_(); // consume `!include`
+            if (!includes_)
+            {
+                return parseValue_(); // unresolved: the target stays a string
+            }
+            if (!at_(TokenType::TOKEN_STRING))
+            {
+                throw YamlException("Expected file path after !include", cur_.line, cur_.column);
+            }
+            IncludeSite site;
+            site.path = path_;
+            site.target = cur_.value;
+            includes_->push_back(site);
+            return parseScalar_();
+        }
+        default:
+            if (isKey_())
+            {
+                return parseMapping_();
+            }
+            return parseScalar_();
+        }
+    }
+
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parseFlowSeq_()
+    {
+        expect_(TokenType::TOKEN_LBRACKET, "Expected '['");
+
+        YamlValue::Sequence seq;
+
+        while (!at_(TokenType::TOKEN_RBRACKET) && !at_(TokenType::TOKEN_EOF))
+        {
+            pushIndex_(seq.size());
+            append_(seq, parseValue_());
+            popPath_();
+
+            if (at_(TokenType::TOKEN_COMMA))
+            {
+                advance_();
+            }
+            else if (!at_(TokenType::TOKEN_RBRACKET))
+            {
+                break;
+            }
+        }
+
+        expect_(TokenType::TOKEN_RBRACKET, "Expected ']'");
+        ++nodes_;
+        if (trackMemory_)
+            charge_(sizeof(YamlValue::Sequence));
+        return YamlValue(std::move(seq));
+    }
+
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parseFlowMap_()
+    {
+        expect_(TokenType::TOKEN_LBRACE, "Expected '{'");
+
+        YamlValue::Mapping map;
+
+        while (!at_(TokenType::TOKEN_RBRACE) && !at_(TokenType::TOKEN_EOF))
+        {
+            if (!at_(TokenType::TOKEN_STRING))
+            {
+                throw YamlException("Expected string key in mapping", cur_.line, cur_.column);
+            }
+            checkKey_(map);
+
+            std::string key = std::move(cur_.value);
+            advance_();
+
+            expect_(TokenType::TOKEN_COLON, "Expected ':' after key");
+
+            pushKey_(key);
+            size_t keyBytes = 0;
+            if (trackMemory_)
+            {
+                keyBytes = detail::stringHeapBytes(key);
+                charge_(keyBytes); // held while the value is parsed
+            }
+            insert_(map, std::move(key), parseValue_());
+            release_(keyBytes);
+            popPath_();
+
+            if (at_(TokenType::TOKEN_COMMA))
+            {
+                advance_();
+            }
+            else if (!at_(TokenType::TOKEN_RBRACE))
+            {
+                break;
+            }
+        }
+
+        expect_(TokenType::TOKEN_RBRACE, "Expected '}'");
+        ++nodes_;
+        if (trackMemory_)
+            charge_(sizeof(YamlValue::Mapping));
+        return YamlValue(std::move(map));
+    }
+
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parseScalar_()
+    {
+        ++nodes_;
+        if (closesBlock_())
+        {
+            // Se chegamos aqui ao fechar um bloco, significa que não há valor
+            throw YamlException("Missing value after key", cur_.line, cur_.column);
+        }
+        if (opensBlock_())
+        {
+            throw YamlException("Expected scalar value", cur_.line, cur_.column);
+        }
+        switch (cur_.type)
+        {
+        case TokenType::TOKEN_NULL:
+            advance_();
+            return YamlValue();
+        case TokenType::TOKEN_BOOLEAN:
+        {
+            bool val = (cur_.value == "true");
+            advance_();
+            return YamlValue(val);
+        }
+        case TokenType::TOKEN_NUMBER:
+        {
+            double val = detail::parseNumber(cur_.value);
+            advance_();
+            return YamlValue(val);
+        }
+        case TokenType::TOKEN_STRING:
+        {
+            std::string val = std::move(cur_.value);
+            advance_();
+            if (trackMemory_)
+                charge_(sizeof(std::string) + detail::stringHeapBytes(val));
+            return YamlValue(std::move(val));
+        }
+        default:
+            throw YamlException("Expected scalar value", cur_.line, cur_.column);
+        }
+    }
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parseMapping_(bool afterDash)
+    {
+        YamlValue::Mapping map;
+        bool ownsBlock = false;
+
+        while (isKey_())
+        {
+            checkKey_(map);
+            std::string key = std::move(cur_.value);
+            advance_(); // consume key
+            advance_(); // consume colon
+
+            // Skip newlines após colon
+            while (at_(TokenType::TOKEN_NEWLINE))
+            {
+                advance_();
+            }
+
+            pushKey_(key);
+            size_t keyBytes = 0;
+            if (trackMemory_)
+            {
+                keyBytes = detail::stringHeapBytes(key);
+                charge_(keyBytes); // held while the value is parsed
+            }
+            insert_(map, std::move(key), parseValue_());
+            release_(keyBytes);
+            popPath_();
+
+            // Skip newlines entre entries
+            while (at_(TokenType::TOKEN_NEWLINE))
+            {
+                advance_();
+            }
+
+            // "- a: 1\n  b: 2": the second key opens a block, but it
+            // continues the mapping that started after the dash
+            if (afterDash && !ownsBlock && opensBlock_())
+            {
+                advance_();
+                ownsBlock = true;
+            }
+
+            // A shallower line ends this mapping; its block belongs to whoever opened it
+            if (!isKey_())
+            {
+                break;
+            }
+        }
+
+        if (ownsBlock && closesBlock_())
+        {
+            advance_();
+        }
+
+        ++nodes_;
+        if (trackMemory_)
+            charge_(sizeof(YamlValue::Mapping));
+        return YamlValue(std::move(map));
+    }
+    template <typename Policy>
+    YamlValue BasicParser<Policy>::parseSequence_()
+    {
+        YamlValue::Sequence seq;
+
+        while (at_(TokenType::TOKEN_DASH))
+        {
+            advance_(); // consume dash
+            pushIndex_(seq.size());
+            if (isKey_())
+            {
+                append_(seq, parseMapping_(true));
+            }
+            else
+            {
+                append_(seq, parseValue_());
+            }
+            popPath_();
+
+            // Skip newlines
+            while (at_(TokenType::TOKEN_NEWLINE))
+            {
+                advance_();
+            }
+
+            // Se não há mais dashes, parar
+            if (!at_(TokenType::TOKEN_DASH))
+            {
+                break;
+            }
+        }
+
+        ++nodes_;
+        if (trackMemory_)
+            charge_(sizeof(YamlValue::Sequence));
+        return YamlValue(std::move(seq));
+    }
+
+    // ============================================================================
+    // Fast Path
+    // ============================================================================
+
+    namespace detail
+    {
+        // Thrown inside FastParser when the input leaves the block subset or
+        // would be an error; parse() then starts over with Parser
+        struct FastBail
+        {
+        };
+
+        // Parser's algorithm over a scanner for block documents only: tokens
+        // are spans of the input and scalars are classified and copied once.
+        // Flow collections, tags and every error bail out; everything else,
+        // quirks included, is handled exactly as Parser handles it.
+        class FastParser
+        {
+        public:
+            explicit FastParser(const std::string &src)
+                : p_(src.data()), end_(src.data() + src.size()), bol_(true), lineIndent_(-1),
+                  cur_(span_(TokenType::TOKEN_EOF)), nxt_(span_(TokenType::TOKEN_EOF))
+            {
+                cur_.indent = nxt_.indent = 0;
+                advance_();
+                advance_();
+            }
+
+            YamlValue parse()
+            {
+                while (at_(TokenType::TOKEN_NEWLINE) || opensBlock_())
+                    advance_();
+                if (at_(TokenType::TOKEN_EOF))
+                    return YamlValue();
+                return parseValue_();
+            }
+
+        private:
+            struct Span
+            {
+                TokenType type;
+                const char *begin;
+                size_t length;
+                bool escaped; // quoted text with backslashes still to decode
+                int indent;   // as Token::indent
+            };
+
+            const char *p_;
+            const char *end_;
+            bool bol_;
+            int lineIndent_;
+            BlockIndents indents_;
+            Span cur_, nxt_;
+
+            Span span_(TokenType t, const char *begin = nullptr, size_t length = 0, bool escaped = false)
+            {
+                Span sp = {t, begin, length, escaped, lineIndent_};
+                lineIndent_ = -1;
+                return sp;
+            }
+
+            // Scanner::next
+            Span next_()
+            {
+                while (p_ < end_)
+                {
+                    if (bol_)
+                    {
+                        bol_ = false;
+                        lineIndent_ = measureIndent_();
+                    }
+
+                    char c = *p_;
+                    switch (c)
+                    {
+                    case ' ':
+                    case '\t':
+                    case '\r':
+                        ++p_;
+                        continue;
+                    case '#':
+                        while (p_ < end_ && *p_ != '\n')
+                            ++p_;
+                        continue;
+                    case '\n':
+                        ++p_;
+                        bol_ = true;
+                        return span_(TokenType::TOKEN_NEWLINE);
+                    case ':':
+                        ++p_;
+                        return span_(TokenType::TOKEN_COLON);
+                    case '-':
+                        if (isDash_())
+                        {
+                            ++p_;
+                            return span_(TokenType::TOKEN_DASH);
+                        }
+                        break;
+                    case '[':
+                    case ']':
+                    case '{':
+                    case '}':
+                    case ',':
+                    case '!':
+                        throw FastBail();
+                    case '"':
+                    case '\'':
+                        return quoted_();
+                    }
+                    return plain_();
+                }
+
+                lineIndent_ = 0;
+                return span_(TokenType::TOKEN_EOF);
+            }
+
+            // Scanner::measureIndent_; -1 for a blank or comment line, which
+            // is left to the main loop
+            int measureIndent_()
+            {
+                const char *q = p_;
+                int spaces = 0;
+                while (q < end_ && (*q == ' ' || *q == '\t'))
+                {
+                    spaces += *q == ' ' ? 1 : 8;
+                    ++q;
+                }
+                if (q == end_ || *q == '\n' || *q == '#')
+                    return -1;
+                p_ = q;
+                return spaces;
+            }
+
+            Span quoted_()
+            {
+                char quote = *p_++;
+                const char *begin = p_;
+                bool escaped = false;
+                while (p_ < end_ && *p_ != quote)
+                {
+                    if (*p_ == '\\')
+                    {
+                        escaped = true;
+                        if (++p_ == end_)
+                            break;
+                    }
+                    ++p_;
+                }
+                Span sp = span_(TokenType::TOKEN_STRING, begin, p_ - begin, escaped);
+                if (p_ < end_)
+                    ++p_; // closing quote
+                return sp;
+            }
+
+            // The scanner's peekNext_ reads '\0' past the end
+            bool isDash_() const
+            {
+                return p_ + 1 == end_ || p_[1] == ' ' || p_[1] == '\n' || p_[1] == '\0';
+            }
+
+            Span plain_()
+            {
+                const char *begin = p_;
+                int number = NUM_START;
+                for (; p_ < end_; ++p_)
+                {
+                    unsigned char cc = classOf(*p_);
+                    if (cc & (CHAR_NEWLINE | CHAR_COLON | CHAR_HASH))
+                        break;
+                    if (cc & CHAR_FLOW)
+                        throw FastBail();
+                    if ((cc & CHAR_INPUT) == CHAR_MINUS && isDash_())
+                        break;
+                    number = numberStep[number][cc & CHAR_INPUT];
+                }
+                const char *last = p_;
+                while (last > begin && last[-1] == ' ')
+                    --last;
+                size_t length = last - begin;
+                if (!length)
+                    throw FastBail(); // Scanner skips the character
+
+                TokenType type = reservedWord(begin, length);
+                if (type == TokenType::TOKEN_STRING && isNumberState(number))
+                    type = TokenType::TOKEN_NUMBER;
+                return span_(type, begin, length);
+            }
+
+            // The scanner's escape handling for quoted text
+            static std::string text_(const Span &sp)
+            {
+                if (!sp.escaped)
+                    return std::string(sp.begin, sp.length);
+                std::string out;
+                out.reserve(sp.length);
+                for (size_t i = 0; i < sp.length; ++i)
+                {
+                    char c = sp.begin[i];
+                    if (c != '\\')
+                    {
+                        out += c;
+                        continue;
+                    }
+                    if (++i == sp.length)
+                        break;
+                    switch (sp.begin[i])
+                    {
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'r':
+                        out += '\r';
+                        break;
+                    default:
+                        out += sp.begin[i];
+                        break;
+                    }
+                }
+                return out;
+            }
+
+            // Parser::advance_
+            void advance_()
+            {
+                if (!indents_.inside(cur_.indent))
+                {
+                    indents_.step(cur_.indent);
+                }
+                else
+                {
+                    cur_ = nxt_;
+                    nxt_ = next_();
+                }
+                if (indents_.inside(cur_.indent) && !indents_.aligned(nxt_.indent))
+                    throw FastBail();
+            }
+
+            bool opensBlock_() const { return indents_.opens(cur_.indent); }
+            bool closesBlock_() const { return indents_.closes(cur_.indent); }
+            bool at_(TokenType t) const { return cur_.type == t && indents_.inside(cur_.indent); }
+
+            bool isKey_() const
+            {
+                return at_(TokenType::TOKEN_STRING) && nxt_.type == TokenType::TOKEN_COLON;
+            }
+
+            void skipNewlines_()
+            {
+                while (at_(TokenType::TOKEN_NEWLINE))
+                    advance_();
+            }
+
+            // Parser::parseValue_
+            YamlValue parseValue_()
+            {
+                skipNewlines_();
+                if (opensBlock_())
+                {
+                    advance_();
+                    YamlValue value = parseValue_();
+                    skipNewlines_();
+                    if (closesBlock_())
+                        advance_();
+                    return value;
+                }
+                if (at_(TokenType::TOKEN_DASH))
+                    return parseSequence_();
+                if (isKey_())
+                    return parseMapping_(false);
+                return parseScalar_();
+            }
+
+            YamlValue parseScalar_()
+            {
+                if (!indents_.inside(cur_.indent))
+                    throw FastBail();
+                Span sp = cur_;
+                switch (sp.type)
+                {
+                case TokenType::TOKEN_NULL:
+                    advance_();
+                    return YamlValue();
+                case TokenType::TOKEN_BOOLEAN:
+                    advance_();
+                    return YamlValue(sp.length == 4);
+                case TokenType::TOKEN_NUMBER:
+                {
+                    double value = parseNumber(std::string(sp.begin, sp.length));
+                    advance_();
+                    return YamlValue(value);
+                }
+                case TokenType::TOKEN_STRING:
+                    advance_();
+                    return YamlValue(text_(sp));
+                default:
+                    throw FastBail();
+                }
+            }
+
+            YamlValue parseMapping_(bool afterDash)
+            {
+                YamlValue::Mapping map;
+                bool ownsBlock = false;
+                while (isKey_())
+                {
+                    std::string key = text_(cur_);
+                    advance_();
+                    advance_();
+                    skipNewlines_();
+                    map[std::move(key)] = parseValue_();
+                    skipNewlines_();
+                    if (afterDash && !ownsBlock && opensBlock_())
+                    {
+                        advance_();
+                        ownsBlock = true;
+                    }
+                }
+                if (ownsBlock && closesBlock_())
+                    advance_();
+                return YamlValue(std::move(map));
+            }
+
+            YamlValue parseSequence_()
+            {
+                YamlValue::Sequence seq;
+                while (at_(TokenType::TOKEN_DASH))
+                {
+                    advance_();
+                    if (isKey_())
+                        seq.push_back(parseMapping_(true));
+                    else
+                        seq.push_back(parseValue_());
+                    skipNewlines_();
+                }
+                return YamlValue(std::move(seq));
+            }
+        };
+    } // namespace detail
+
+    YamlValue parse(const std::string &s)
+    {
+#ifdef YAML_TRACE
+        if (Trace::active())
+            return Parser(s).parse();
+#endif
+        {
+            YAML_ALLOC_PHASE(PARSER);
+            try
+            {
+                return detail::FastParser(s).parse();
+            }
+            catch (const detail::FastBail &)
+            {
+            }
+            catch (const std::out_of_range &)
+            {
+                // A number too large for a double; Parser reports it
+            }
+        }
+        return Parser(s).parse();
+    }
+
+    // ============================================================================
+    // Reader
+    // ============================================================================
+
+    // The same token handling as Parser, unrolled into frames so that each
+    // call returns after one step
+
+    Reader::Reader(const std::string &src)
+        : sc_(src), dashMapping_(false), opened_(false), openAfterDash_(false), openBlocks_(0)
+    {
+        start_();
+    }
+
+    Reader::Reader(InputSource &source)
+        : sc_(source), dashMapping_(false), opened_(false), openAfterDash_(false), openBlocks_(0)
+    {
+        start_();
+    }
+
+    void Reader::start_()
+    {
+        advance_();
+        advance_();
+        while (at_(TokenType::TOKEN_NEWLINE) || opensBlock_())
+            advance_();
+    }
+
+    // Parser::advance_, block steps included
+    void Reader::advance_()
+    {
+        if (!indents_.inside(cur_.indent))
+        {
+            indents_.step(cur_.indent);
+        }
+        else
+        {
+            cur_ = std::move(nxt_);
+            nxt_ = sc_.next();
+        }
+        if (indents_.inside(cur_.indent) && !indents_.aligned(nxt_.indent))
+            throw YamlException("Invalid indentation level", nxt_.line, nxt_.column);
+    }
+
+    void Reader::expect_(TokenType t, const char *msg)
+    {
+        if (!at_(t))
+            fail_(msg);
+        advance_();
+    }
+
+    void Reader::fail_(const char *msg)
+    {
+        throw YamlException(msg, cur_.line, cur_.column);
+    }
+
+    bool Reader::isKey_() const
+    {
+        return at_(TokenType::TOKEN_STRING) && nxt_.type == TokenType::TOKEN_COLON;
+    }
+
+    // Parser::parseValue_ up to the value itself: newlines, tags and opened
+    // blocks, each of which the value closes after it
+    void Reader::prepare_()
+    {
+        if (opened_)
+            return;
+        opened_ = true;
+        openBlocks_ = 0;
+        openAfterDash_ = dashMapping_;
+        if (dashMapping_)
+        {
+            dashMapping_ = false;
+            return;
+        }
+        for (;;)
+        {
+            if (at_(TokenType::TOKEN_NEWLINE) || at_(TokenType::TOKEN_TAG))
+            {
+                advance_();
+            }
+            else if (opensBlock_())
+            {
+                advance_();
+                openBlocks_++;
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    int Reader::take_()
+    {
+        prepare_();
+        opened_ = false;
+        return openBlocks_;
+    }
+
+    void Reader::close_(int blocks)
+    {
+        for (int i = 0; i < blocks; ++i)
+        {
+            while (at_(TokenType::TOKEN_NEWLINE))
+                advance_();
+            if (closesBlock_())
+                advance_();
+        }
+    }
+
+    YamlType Reader::peekType()
+    {
+        prepare_();
+        if (closesBlock_())
+            fail_("Missing value after key");
+        if (opensBlock_())
+            fail_("Expected scalar value");
+        switch (cur_.type)
+        {
+        case TokenType::TOKEN_LBRACE:
+            return YamlType::MAPPING;
+        case TokenType::TOKEN_LBRACKET:
+        case TokenType::TOKEN_DASH:
+            return YamlType::SEQUENCE;
+        case TokenType::TOKEN_STRING:
+            return isKey_() ? YamlType::MAPPING : YamlType::STRING;
+        case TokenType::TOKEN_NUMBER:
+            return YamlType::NUMBER;
+        case TokenType::TOKEN_BOOLEAN:
+            return YamlType::BOOLEAN;
+        case TokenType::TOKEN_NULL:
+            return YamlType::NIL;
+        case TokenType::TOKEN_EOF:
+            if (frames_.empty())
+                return YamlType::NIL; // empty document
+            break;
+        default:
+            break;
+        }
+        fail_("Expected scalar value");
+        return YamlType::NIL;
+    }
+
+    bool Reader::enterMapping()
+    {
+        YamlType type = peekType();
+        Frame frame = {true, cur_.type == TokenType::TOKEN_LBRACE, openAfterDash_, false, true, take_()};
+        if (type == YamlType::NIL)
+        {
+            if (at_(TokenType::TOKEN_NULL))
+                advance_();
+            close_(frame.blocks);
+            return false;
+        }
+        if (type != YamlType::MAPPING)
+            fail_("Expected a mapping");
+        if (frame.flow)
+            advance_();
+        frames_.push_back(frame);
+        return true;
+    }
+
+    bool Reader::enterSequence()
+    {
+        YamlType type = peekType();
+        Frame frame = {false, cur_.type == TokenType::TOKEN_LBRACKET, false, false, true, take_()};
+        if (type == YamlType::NIL)
+        {
+            if (at_(TokenType::TOKEN_NULL))
+                advance_();
+            close_(frame.blocks);
+            return false;
+        }
+        if (type != YamlType::SEQUENCE)
+            fail_("Expected a sequence");
+        if (frame.flow)
+            advance_();
+        frames_.push_back(frame);
+        return true;
+    }
+
+    bool Reader::nextKey(std::string &key)
+    {
+        Frame &frame = frames_.back();
+        if (frame.flow)
+        {
+            if (!frame.first)
+            {
+                if (at_(TokenType::TOKEN_COMMA))
+                    advance_();
+                else if (!at_(TokenType::TOKEN_RBRACE))
+                    fail_("Expected '}'");
+            }
+            if (at_(TokenType::TOKEN_RBRACE) || at_(TokenType::TOKEN_EOF))
+            {
+                expect_(TokenType::TOKEN_RBRACE, "Expected '}'");
+                int blocks = frame.blocks;
+                frames_.pop_back();
+                close_(blocks);
+                return false;
+            }
+            if (!at_(TokenType::TOKEN_STRING))
+                fail_("Expected string key in mapping");
+            frame.first = false;
+            key = std::move(cur_.value);
+            advance_();
+            expect_(TokenType::TOKEN_COLON, "Expected ':' after key");
+            return true;
+        }
+
+        if (!frame.first)
+        {
+            while (at_(TokenType::TOKEN_NEWLINE))
+                advance_();
+            if (frame.afterDash && !frame.ownsBlock && opensBlock_())
+            {
+                advance_();
+                frame.ownsBlock = true;
+            }
+            if (!isKey_())
+            {
+                if (frame.ownsBlock && closesBlock_())
+                    advance_();
+                int blocks = frame.blocks;
+                frames_.pop_back();
+                close_(blocks);
+                return false;
+            }
+        }
+        frame.first = false;
+        key = std::move(cur_.value);
+        advance_(); // key
+        advance_(); // colon
+        while (at_(TokenType::TOKEN_NEWLINE))
+            advance_();
+        return true;
+    }
+
+    bool Reader::nextItem()
+    {
+        Frame &frame = frames_.back();
+        if (frame.flow)
+        {
+            if (!frame.first)
+            {
+                if (at_(TokenType::TOKEN_COMMA))
+                    advance_();
+                else if (!at_(TokenType::TOKEN_RBRACKET))
+                    fail_("Expected ']'");
+            }
+            if (at_(TokenType::TOKEN_RBRACKET) || at_(TokenType::TOKEN_EOF))
+            {
+                expect_(TokenType::TOKEN_RBRACKET, "Expected ']'");
+                int blocks = frame.blocks;
+                frames_.pop_back();
+                close_(blocks);
+                return false;
+            }
+            frame.first = false;
+            return true;
+        }
+
+        if (!frame.first)
+        {
+            while (at_(TokenType::TOKEN_NEWLINE))
+                advance_();
+            if (!at_(TokenType::TOKEN_DASH))
+            {
+                int blocks = frame.blocks;
+                frames_.pop_back();
+                close_(blocks);
+                return false;
+            }
+        }
+        frame.first = false;
+        advance_(); // dash
+        dashMapping_ = isKey_();
+        return true;
+    }
+
+    // Consumes a null (returning false) or a token of type t
+    bool Reader::scalar_(TokenType t, const char *msg, int &blocks)
+    {
+        YamlType type = peekType();
+        blocks = take_();
+        if (type == YamlType::NIL)
+        {
+            if (at_(TokenType::TOKEN_NULL))
+                advance_();
+            close_(blocks);
+            return false;
+        }
+        if (cur_.type != t || isKey_())
+            fail_(msg);
+        return true;
+    }
+
+    bool Reader::read(bool &out)
+    {
+        int blocks;
+        if (!scalar_(TokenType::TOKEN_BOOLEAN, "Expected a boolean", blocks))
+            return false;
+        out = (cur_.value == "true");
+        advance_();
+        close_(blocks);
+        return true;
+    }
+
+    bool Reader::read(double &out)
+    {
+        int blocks;
+        if (!scalar_(TokenType::TOKEN_NUMBER, "Expected a number", blocks))
+            return false;
+        out = detail::parseNumber(cur_.value);
+        advance_();
+        close_(blocks);
+        return true;
+    }
+
+    bool Reader::read(int &out)
+    {
+        long long value;
+        if (!readInteger_(value, INT_MIN, INT_MAX))
+            return false;
+        out = static_cast<int>(value);
+        return true;
+    }
+
+    bool Reader::read(long long &out)
+    {
+        return readInteger_(out, LLONG_MIN, LLONG_MAX);
+    }
+
+    // Integers are read from the token text, as a double would round
+    // anything beyond 2^53. "3.0" is accepted, "3.5" is not.
+    bool Reader::readInteger_(long long &out, long long min, long long max)
+    {
+        int blocks;
+        if (!scalar_(TokenType::TOKEN_NUMBER, "Expected a number", blocks))
+            return false;
+        const char *text = cur_.value.c_str();
+        char *end = nullptr;
+        errno = 0;
+        long long value = std::strtoll(text, &end, 10);
+        if (*end == '.')
+        {
+            while (*++end == '0')
+            {
+            }
+        }
+        if (*end != '\0')
+            fail_("Expected an integer");
+        if (errno == ERANGE || value < min || value > max)
+            fail_("Integer out of range");
+        out = value;
+        advance_();
+        close_(blocks);
+        return true;
+    }
+
+    bool Reader::read(std::string &out)
+    {
+        int blocks;
+        if (!scalar_(TokenType::TOKEN_STRING, "Expected a string", blocks))
+            return false;
+        out = std::move(cur_.value);
+        advance_();
+        close_(blocks);
+        return true;
+    }
+
+    void Reader::skipValue()
+    {
+        switch (peekType())
+        {
+        case YamlType::MAPPING:
+        {
+            std::string key;
+            if (enterMapping())
+            {
+                while (nextKey(key))
+                    skipValue();
+            }
+            return;
+        }
+        case YamlType::SEQUENCE:
+            if (enterSequence())
+            {
+                while (nextItem())
+                    skipValue();
+            }
+            return;
+        default:
+        {
+            int blocks = take_();
+            if (cur_.type != TokenType::TOKEN_EOF)
+                advance_();
+            close_(blocks);
+            return;
+        }
+        }
+    }
+
+    // ============================================================================
+    // Parse Statistics
+    // ============================================================================
+
+    ParseStats::ParseStats()
+        : bytes(0), maxDepth(0), maxMappingWidth(0), scanMs(0), buildMs(0),
+          documentBytes(0), peakBytes(0)
+    {
+        std::fill(tokens, tokens + TOKEN_TYPES, 0);
+        std::fill(nodes, nodes + NODE_TYPES, 0);
+    }
+
+    size_t ParseStats::totalTokens() const
+    {
+        size_t sum = 0;
+        for (int i = 0; i < TOKEN_TYPES; ++i)
+            sum += tokens[i];
+        return sum;
+    }
+
+    size_t ParseStats::totalNodes() const
+    {
+        size_t sum = 0;
+        for (int i = 0; i < NODE_TYPES; ++i)
+            sum += nodes[i];
+        return sum;
+    }
+
+    namespace detail
+    {
+        // Counts v and its descendants; returns the bytes v owns beyond itself
+        size_t measureShape(const YamlValue &v, size_t depth, ParseStats &stats)
+        {
+            stats.nodes[static_cast<int>(v.getType())]++;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+
+            size_t owned = 0;
+            switch (v.getType())
+            {
+            case YamlType::STRING:
+                owned = sizeof(std::string) + stringHeapBytes(v.asString());
+                break;
+            case YamlType::SEQUENCE:
+            {
+                const YamlValue::Sequence &seq = v.asSequence();
+                owned = sizeof(YamlValue::Sequence) + seq.capacity() * sizeof(YamlValue);
+                for (size_t i = 0; i < seq.size(); ++i)
+                    owned += measureShape(seq[i], depth + 1, stats);
+                break;
+            }
+            case YamlType::MAPPING:
+            {
+                const YamlValue::Mapping &map = v.asMapping();
+                stats.maxMappingWidth = std::max(stats.maxMappingWidth, map.size());
+                // Tree nodes hold three pointers and a color next to the pair
+                const size_t nodeOverhead = 4 * sizeof(void *);
+                owned = sizeof(YamlValue::Mapping);
+                for (const auto &pair : map)
+                {
+                    owned += nodeOverhead + sizeof(pair) + stringHeapBytes(pair.first);
+                    owned += measureShape(pair.second, depth + 1, stats);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            return owned;
+        }
+    }
+
+    namespace detail
+    {
+        // Runs parser under options, filling options.stats if given
+        YamlValue parseWithOptions(Parser &parser, const ParseOptions &options)
+        {
+            ParseStats *stats = options.stats;
+            if (stats)
+                *stats = ParseStats();
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            parser.applyOptions(options);
+            YamlValue result = parser.parse();
+            if (stats)
+            {
+                double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                stats->buildMs = std::max(0.0, totalMs - stats->scanMs);
+                stats->bytes = parser.offset();
+                stats->documentBytes = sizeof(YamlValue) + measureShape(result, 1, *stats);
+                stats->peakBytes = parser.peakBytes();
+            }
+            if (options.progress)
+            {
+                ParseProgress done;
+                done.bytes = parser.offset();
+                done.nodes = parser.nodesBuilt();
+                options.progress(done);
+            }
+            return result;
+        }
+    }
+
+    YamlValue parse(const std::string &s, ParseStats *stats)
+    {
+        if (!stats)
+            return parse(s);
+        ParseOptions options;
+        options.stats = stats;
+        return parse(s, options);
+    }
+
+    YamlValue parse(const std::string &s, const ParseOptions &options)
+    {
+        Parser parser(s);
+        return detail::parseWithOptions(parser, options);
+    }
+
+    // ============================================================================
+    // Stream Input Implementation
+    // ============================================================================
+
+    namespace detail
+    {
+        const size_t kStreamChunk = 64 * 1024;
+
+        class FileSource : public InputSource
+        {
+        public:
+            explicit FileSource(const std::string &path) : file_(std::fopen(path.c_str(), "rb"))
+            {
+                if (!file_)
+                    throw YamlException("Cannot open file: " + path);
+            }
+
+            ~FileSource()
+            {
+                std::fclose(file_);
+            }
+
+            size_t read(char *buf, size_t n)
+            {
+                return std::fread(buf, 1, n, file_);
+            }
+
+        private:
+            std::FILE *file_;
+
+            FileSource(const FileSource &);
+            FileSource &operator=(const FileSource &);
+        };
+
+        class MemorySource : public InputSource
+        {
+        public:
+            MemorySource(const char *data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+            size_t read(char *buf, size_t n)
+            {
+                n = std::min(n, size_ - pos_);
+                std::memcpy(buf, data_ + pos_, n);
+                pos_ += n;
+                return n;
+            }
+
+        private:
+            const char *data_;
+            size_t size_;
+            size_t pos_;
+        };
+
+        enum class Codec
+        {
+            PLAIN,
+            ZLIB, // gzip or zlib framing
+            ZSTD
+        };
+
+        // Leading bytes looked at to tell compressed input from text
+        const size_t kSniffBytes = 64;
+
+        // A zlib header is only two bytes, and text such as "x^" can pass its
+        // checks, so the bytes after it must also inflate without an error.
+        // Without zlib support nothing confirms it and the input is text.
+        bool zlibFramed(const unsigned char *p, size_t n)
+        {
+            // Deflate method, window up to 32K, no preset dictionary, check bits
+            if (n < 2 || (p[0] & 0x0f) != 8 || (p[0] >> 4) > 7 || (p[1] & 0x20) != 0 || (p[0] * 256 + p[1]) % 31 != 0)
+                return false;
+#ifdef YAML_HAVE_ZLIB
+            z_stream zs;
+            std::memset(&zs, 0, sizeof(zs));
+            if (inflateInit(&zs) != Z_OK)
+                return false;
+            zs.next_in = const_cast<Bytef *>(p);
+            zs.avail_in = static_cast<uInt>(std::min(n, kSniffBytes));
+            int ret = Z_OK;
+            while (ret == Z_OK && zs.avail_in > 0)
+            {
+                Bytef scratch[4096];
+                zs.next_out = scratch;
+                zs.avail_out = sizeof(scratch);
+                ret = inflate(&zs, Z_NO_FLUSH);
+            }
+            inflateEnd(&zs);
+            return ret == Z_OK || ret == Z_STREAM_END || ret == Z_BUF_ERROR;
+#else
+            return false;
+#endif
+        }
+
+        Codec detectCodec(const unsigned char *p, size_t n)
+        {
+            if (n >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+                return Codec::ZLIB;
+            if (n >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+                return Codec::ZSTD;
+            if (zlibFramed(p, n))
+                return Codec::ZLIB;
+            return Codec::PLAIN;
+        }
+
+        // Decompresses the wrapped source on demand, one input chunk at a
+        // time, so the decoded text is never held in full
+        class DecodingSource : public InputSource
+        {
+        public:
+            explicit DecodingSource(InputSource &raw)
+                : raw_(raw), in_(kStreamChunk), inPos_(0), inLen_(0), rawEof_(false), ended_(false),
+                  moreOutput_(false), codec_(Codec::PLAIN)
+#ifdef YAML_HAVE_ZLIB
+                  , zlibReady_(false)
+#endif
+#ifdef YAML_HAVE_ZSTD
+                  , zstd_(nullptr)
+#endif
+            {
+                // The signature needs up to kSniffBytes; sources may return fewer per call
+                while (inLen_ < kSniffBytes && refill_())
+                {
+                }
+                codec_ = detectCodec(reinterpret_cast<const unsigned char *>(&in_[0]), inLen_);
+
+                if (codec_ == Codec::ZLIB)
+                {
+#ifdef YAML_HAVE_ZLIB
+                    std::memset(&zs_, 0, sizeof(zs_));
+                    // 15 + 32: accept both gzip and zlib headers
+                    if (inflateInit2(&zs_, 15 + 32) != Z_OK)
+                        throw YamlException("Cannot initialize zlib");
+                    zlibReady_ = true;
+#else
+                    throw YamlException("Compressed input requires zlib support (build with YAML_HAVE_ZLIB)");
+#endif
+                }
+                else if (codec_ == Codec::ZSTD)
+                {
+#ifdef YAML_HAVE_ZSTD
+                    zstd_ = ZSTD_createDStream();
+                    if (zstd_ && ZSTD_isError(ZSTD_initDStream(zstd_)))
+                    {
+                        // The destructor does not run when the constructor throws
+                        ZSTD_freeDStream(zstd_);
+                        zstd_ = nullptr;
+                    }
+                    if (!zstd_)
+                        throw YamlException("Cannot initialize zstd");
+#else
+                    throw YamlException("zstd input requires zstd support (build with YAML_HAVE_ZSTD)");
+#endif
+                }
+            }
+
+            ~DecodingSource()
+            {
+#ifdef YAML_HAVE_ZLIB
+                if (zlibReady_)
+                    inflateEnd(&zs_);
+#endif
+#ifdef YAML_HAVE_ZSTD
+                if (zstd_)
+                    ZSTD_freeDStream(zstd_);
+#endif
+            }
+
+            size_t read(char *buf, size_t n)
+            {
+                switch (codec_)
+                {
+                case Codec::ZLIB:
+                    return readZlib_(buf, n);
+                case Codec::ZSTD:
+                    return readZstd_(buf, n);
+                default:
+                    break;
+                }
+                if (inPos_ < inLen_)
+                {
+                    n = std::min(n, inLen_ - inPos_);
+                    std::memcpy(buf, &in_[inPos_], n);
+                    inPos_ += n;
+                    return n;
+                }
+                return raw_.read(buf, n);
+            }
+
+        private:
+            InputSource &raw_;
+            std::vector<char> in_;
+            size_t inPos_;
+            size_t inLen_;
+            bool rawEof_;
+            bool ended_;      // decoder reached the end of a stream / frame
+            bool moreOutput_; // last call filled the output; decoder may hold more
+            Codec codec_;
+#ifdef YAML_HAVE_ZLIB
+            z_stream zs_;
+            bool zlibReady_;
+#endif
+#ifdef YAML_HAVE_ZSTD
+            ZSTD_DStream *zstd_;
+#endif
+
+            DecodingSource(const DecodingSource &);
+            DecodingSource &operator=(const DecodingSource &);
+
+            // Appends raw bytes after the unread part of in_
+            bool refill_()
+            {
+                if (rawEof_)
+                    return false;
+                if (inPos_ > 0)
+                {
+                    std::memmove(&in_[0], &in_[inPos_], inLen_ - inPos_);
+                    inLen_ -= inPos_;
+                    inPos_ = 0;
+                }
+                if (inLen_ == in_.size())
+                    return true;
+                size_t got = raw_.read(&in_[inLen_], in_.size() - inLen_);
+                if (got == 0)
+                    rawEof_ = true;
+                inLen_ += got;
+                return got > 0;
+            }
+
+            size_t readZlib_(char *buf, size_t n)
+            {
+#ifdef YAML_HAVE_ZLIB
+                for (;;)
+                {
+                    if (inPos_ == inLen_ && !moreOutput_ && !refill_())
+                    {
+                        if (!ended_)
+                            throw YamlException("Truncated compressed input");
+                        return 0;
+                    }
+                    if (ended_)
+                    {
+                        // Zero padding after the last member, as tar and tape
+                        // tools write it, ends the input
+                        while (inPos_ < inLen_ && in_[inPos_] == '\0')
+                        {
+                            if (++inPos_ == inLen_ && !refill_())
+                                return 0;
+                        }
+                        // Concatenated gzip members continue the same text
+                        inflateReset(&zs_);
+                        ended_ = false;
+                    }
+
+                    zs_.next_in = reinterpret_cast<Bytef *>(&in_[inPos_]);
+                    zs_.avail_in = static_cast<uInt>(inLen_ - inPos_);
+                    zs_.next_out = reinterpret_cast<Bytef *>(buf);
+                    zs_.avail_out = static_cast<uInt>(n);
+                    int ret = inflate(&zs_, Z_NO_FLUSH);
+                    inPos_ = inLen_ - zs_.avail_in;
+                    size_t produced = n - zs_.avail_out;
+
+                    if (ret == Z_STREAM_END)
+                        ended_ = true;
+                    else if (ret != Z_OK && ret != Z_BUF_ERROR)
+                        throw YamlException("Corrupt compressed input");
+                    // A full output buffer may leave decoded bytes inside zlib
+                    moreOutput_ = !ended_ && produced == n;
+
+                    if (produced > 0)
+                        return produced;
+                }
+#else
+                (void)buf;
+                (void)n;
+                return 0;
+#endif
+            }
+
+            size_t readZstd_(char *buf, size_t n)
+            {
+#ifdef YAML_HAVE_ZSTD
+                for (;;)
+                {
+                    if (inPos_ == inLen_ && !moreOutput_ && !refill_())
+                    {
+                        if (!ended_)
+                            throw YamlException("Truncated compressed input");
+                        return 0;
+                    }
+
+                    ZSTD_inBuffer input = {&in_[0], inLen_, inPos_};
+                    ZSTD_outBuffer output = {buf, n, 0};
+                    size_t ret = ZSTD_decompressStream(zstd_, &output, &input);
+                    if (ZSTD_isError(ret))
+                        throw YamlException(std::string("Corrupt compressed input: ") + ZSTD_getErrorName(ret));
+                    inPos_ = input.pos;
+                    ended_ = ret == 0; // frame complete
+                    moreOutput_ = output.pos == n;
+
+                    if (output.pos > 0)
+                        return output.pos;
+                }
+#else
+                (void)buf;
+                (void)n;
+                return 0;
+#endif
+            }
+        };
+
+        bool isCompressed(const std::string &data)
+        {
+            return detectCodec(reinterpret_cast<const unsigned char *>(data.data()), data.size()) != Codec::PLAIN;
+        }
+    } // namespace detail
+
+    YamlValue parseStream(InputSource &source)
+    {
+        detail::DecodingSource decoded(source);
+        return Parser(decoded).parse();
+    }
+
+    YamlValue parseFile(const std::string &path)
+    {
+        YAML_TRACE_SPAN("parseFile", path);
+        detail::FileSource file(path);
+        return parseStream(file);
+    }
+
+    YamlValue parseStream(InputSource &source, const ParseOptions &options)
+    {
+        detail::DecodingSource decoded(source);
+        Parser parser(decoded);
+        return detail::parseWithOptions(parser, options);
+    }
+
+    YamlValue parseFile(const std::string &path, const ParseOptions &options)
+    {
+        YAML_TRACE_SPAN("parseFile", path);
+        detail::FileSource file(path);
+        return parseStream(file, options);
     }
 
-    double YamlValue::asNumber() const
+    // ============================================================================
+    // File Loader Implementation
+    // ============================================================================
+
+    namespace detail
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        inline double elapsedMs(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // Fixed set of worker threads draining a FIFO of tasks
+        class TaskPool
+        {
+        public:
+            explicit TaskPool(unsigned threads) : closed_(false)
+            {
+                for (unsigned i = 0; i < threads; ++i)
+                {
+                    workers_.push_back(std::thread(&TaskPool::run_, this));
+                }
+            }
+
+            ~TaskPool()
+            {
+                finish();
+            }
+
+            void submit(const std::function<void()> &task)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    tasks_.push_back(task);
+                }
+                cv_.notify_one();
+            }
+
+            // Runs every queued task and joins the workers
+            void finish()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    closed_ = true;
+                }
+                cv_.notify_all();
+                for (size_t i = 0; i < workers_.size(); ++i)
+                {
+                    if (workers_[i].joinable())
+                        workers_[i].join();
+                }
+            }
+
+        private:
+            std::vector<std::thread> workers_;
+            std::deque<std::function<void()>> tasks_;
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            bool closed_;
+
+            void run_()
+            {
+                for (;;)
+                {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        while (tasks_.empty() && !closed_)
+                            cv_.wait(lock);
+                        if (tasks_.empty())
+                            return;
+                        task = tasks_.front();
+                        tasks_.pop_front();
+                    }
+                    task();
+                }
+            }
+        };
+
+        bool readWholeFile(const std::string &path, std::string &out, std::string &error)
+        {
+            std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+            if (!in)
+            {
+                error = "Cannot open file: " + path;
+                return false;
+            }
+            in.seekg(0, std::ios::end);
+            std::streamoff size = in.tellg();
+            in.seekg(0, std::ios::beg);
+            out.resize(size > 0 ? static_cast<size_t>(size) : 0);
+            if (!out.empty() && !in.read(&out[0], static_cast<std::streamsize>(out.size())))
+            {
+                error = "Cannot read file: " + path;
+                return false;
+            }
+            return true;
+        }
+
+        void parseLoaded(LoadedFile &file, const std::string &text, bool recordIncludes)
+        {
+            YAML_TRACE_SPAN("load", file.path);
+            Clock::time_point start = Clock::now();
+            file.bytes = text.size();
+            try
+            {
+                if (isCompressed(text))
+                {
+                    // Decoded straight into the scanner window
+                    MemorySource raw(text.data(), text.size());
+                    DecodingSource decoded(raw);
+                    Parser parser(decoded);
+                    if (recordIncludes)
+                        parser.recordIncludes(&file.includes);
+                    file.value = parser.parse();
+                }
+                else if (!recordIncludes)
+                {
+                    file.value = parse(text);
+                }
+                else
+                {
+                    Parser parser(text);
+                    parser.recordIncludes(&file.includes);
+                    file.value = parser.parse();
+                }
+                file.ok = true;
+            }
+            catch (const YamlException &e)
+            {
+                file.error = e.what();
+                file.line = e.line;
+                file.column = e.column;
+            }
+            catch (const std::exception &e)
+            {
+                file.error = e.what();
+            }
+            file.parseMs = elapsedMs(start);
+        }
+
+        void readAndParse(LoadedFile &file, bool recordIncludes)
+        {
+            Clock::time_point start = Clock::now();
+            std::string text;
+            bool ok;
+            {
+                YAML_TRACE_SPAN("read", file.path);
+                ok = readWholeFile(file.path, text, file.error);
+            }
+            file.readMs = elapsedMs(start);
+            if (ok)
+                parseLoaded(file, text, recordIncludes);
+        }
+
+#ifdef YAML_HAVE_IO_URING
+        // Minimal io_uring wrapper over the raw syscalls, so no liburing is needed
+        class IoUring
+        {
+        public:
+            IoUring()
+                : fd_(-1), sqRing_(nullptr), cqRing_(nullptr), sqRingSize_(0), cqRingSize_(0),
+                  sqes_(nullptr), sqesSize_(0), sqTailLocal_(0) {}
+
+            ~IoUring()
+            {
+                if (sqes_)
+                    munmap(sqes_, sqesSize_);
+                if (cqRing_ && cqRing_ != sqRing_)
+                    munmap(cqRing_, cqRingSize_);
+                if (sqRing_)
+                    munmap(sqRing_, sqRingSize_);
+                if (fd_ >= 0)
+                    close(fd_);
+            }
+
+            bool init(unsigned entries)
+            {
+                io_uring_params p;
+                std::memset(&p, 0, sizeof(p));
+                fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+                if (fd_ < 0)
+                    return false;
+
+                sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+                cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+                bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single)
+                    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+                sqRing_ = map_(sqRingSize_, IORING_OFF_SQ_RING);
+                if (!sqRing_)
+                    return false;
+                cqRing_ = single ? sqRing_ : map_(cqRingSize_, IORING_OFF_CQ_RING);
+                if (!cqRing_)
+                    return false;
+                sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+                sqes_ = reinterpret_cast<io_uring_sqe *>(map_(sqesSize_, IORING_OFF_SQES));
+                if (!sqes_)
+                    return false;
+
+                sqHead_ = reinterpret_cast<unsigned *>(sqRing_ + p.sq_off.head);
+                sqTail_ = reinterpret_cast<unsigned *>(sqRing_ + p.sq_off.tail);
+                sqMask_ = *reinterpret_cast<unsigned *>(sqRing_ + p.sq_off.ring_mask);
+                sqEntries_ = p.sq_entries;
+                sqArray_ = reinterpret_cast<unsigned *>(sqRing_ + p.sq_off.array);
+                cqHead_ = reinterpret_cast<unsigned *>(cqRing_ + p.cq_off.head);
+                cqTail_ = reinterpret_cast<unsigned *>(cqRing_ + p.cq_off.tail);
+                cqMask_ = *reinterpret_cast<unsigned *>(cqRing_ + p.cq_off.ring_mask);
+                cqes_ = reinterpret_cast<io_uring_cqe *>(cqRing_ + p.cq_off.cqes);
+                sqTailLocal_ = *sqTail_;
+                return true;
+            }
+
+            // Next free submission entry, or nullptr when the queue is full
+            io_uring_sqe *sqe()
+            {
+                unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+                if (sqTailLocal_ - head >= sqEntries_)
+                    return nullptr;
+                unsigned idx = sqTailLocal_ & sqMask_;
+                io_uring_sqe *e = &sqes_[idx];
+                std::memset(e, 0, sizeof(*e));
+                sqArray_[idx] = idx;
+                sqTailLocal_++;
+                return e;
+            }
+
+            // Publishes queued entries and blocks until `waitFor` completions
+            // exist. Entries the kernel has not consumed yet, e.g. after a
+            // failed call, are submitted again.
+            bool submit(unsigned waitFor)
+            {
+                __atomic_store_n(sqTail_, sqTailLocal_, __ATOMIC_RELEASE);
+                for (;;)
+                {
+                    unsigned toSubmit = sqTailLocal_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+                    long r = syscall(__NR_io_uring_enter, fd_, toSubmit, waitFor,
+                                     waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                    if (r >= 0)
+                        return true;
+                    if (errno != EINTR)
+                        return false;
+                }
+            }
+
+            bool pop(io_uring_cqe &out)
+            {
+                unsigned head = *cqHead_;
+                if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+                    return false;
+                out = cqes_[head & cqMask_];
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+
+        private:
+            int fd_;
+            unsigned char *sqRing_;
+            unsigned char *cqRing_;
+            size_t sqRingSize_;
+            size_t cqRingSize_;
+            io_uring_sqe *sqes_;
+            size_t sqesSize_;
+            unsigned *sqHead_;
+            unsigned *sqTail_;
+            unsigned sqMask_;
+            unsigned sqEntries_;
+            unsigned *sqArray_;
+            unsigned *cqHead_;
+            unsigned *cqTail_;
+            unsigned cqMask_;
+            io_uring_cqe *cqes_;
+            unsigned sqTailLocal_;
+
+            unsigned char *map_(size_t size, off_t offset)
+            {
+                void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+                return p == MAP_FAILED ? nullptr : static_cast<unsigned char *>(p);
+            }
+        };
+
+        enum IoOp
+        {
+            IO_OPEN = 0,
+            IO_READ = 1,
+            IO_CLOSE = 2
+        };
+
+        const size_t kInitialReadSize = 16 * 1024;
+
+        // Loads files in batches of openat/read/close submissions. Each file
+        // has at most one request in flight, so a batch never overflows the
+        // ring. Finished buffers go straight to the parser pool.
+        bool loadWithIoUring(std::vector<LoadedFile> &results, std::vector<std::string> &buffers,
+                             size_t batchSize, bool recordIncludes, TaskPool &pool)
+        {
+            IoUring ring;
+            if (!ring.init(static_cast<unsigned>(batchSize)))
+                return false;
+
+            std::vector<int> fds(results.size(), -1);
+            std::vector<size_t> sizes(results.size(), 0);
+            std::vector<Clock::time_point> starts(results.size());
+
+            for (size_t base = 0; base < results.size(); base += batchSize)
+            {
+                size_t end = std::min(results.size(), base + batchSize);
+                size_t inflight = 0;
+
+                for (size_t i = base; i < end; ++i)
+                {
+                    io_uring_sqe *e = ring.sqe();
+                    e->opcode = IORING_OP_OPENAT;
+                    e->fd = AT_FDCWD;
+                    e->addr = reinterpret_cast<unsigned long long>(results[i].path.c_str());
+                    e->open_flags = O_RDONLY | O_CLOEXEC;
+                    e->user_data = (i << 2) | IO_OPEN;
+                    starts[i] = Clock::now();
+                    inflight++;
+                }
+
+                while (inflight > 0)
+                {
+                    if (!ring.submit(1))
+                    {
+                        // The caller starts over without the ring. Reap what
+                        // is in flight for as long as the ring keeps working,
+                        // then close every fd not handed to a queued close.
+                        io_uring_cqe cqe;
+                        while (inflight > 0)
+                        {
+                            if (!ring.pop(cqe))
+                            {
+                                if (!ring.submit(1))
+                                    break;
+                                continue;
+                            }
+                            inflight--;
+                            if ((cqe.user_data & 3) == IO_OPEN && cqe.res >= 0)
+                                fds[static_cast<size_t>(cqe.user_data >> 2)] = cqe.res;
+                        }
+                        for (size_t i = 0; i < fds.size(); ++i)
+                        {
+                            if (fds[i] >= 0)
+                                close(fds[i]);
+                        }
+                        return false;
+                    }
+
+                    io_uring_cqe cqe;
+                    while (ring.pop(cqe))
+                    {
+                        inflight--;
+                        size_t i = static_cast<size_t>(cqe.user_data >> 2);
+                        LoadedFile &file = results[i];
+                        std::string &buf = buffers[i];
+                        bool queueRead = false;
+                        bool queueClose = false;
+
+                        switch (static_cast<IoOp>(cqe.user_data & 3))
+                        {
+                        case IO_OPEN:
+                            if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP)
+                            {
+                                // Kernel predates IORING_OP_OPENAT; read this one synchronously
+                                pool.submit([&file, recordIncludes]() { readAndParse(file, recordIncludes); });
+                            }
+                            else if (cqe.res < 0)
+                            {
+                                file.error = "Cannot open file: " + file.path + " (" + std::strerror(-cqe.res) + ")";
+                                file.readMs = elapsedMs(starts[i]);
+                            }
+                            else
+                            {
+                                fds[i] = cqe.res;
+                                buf.resize(kInitialReadSize);
+                                queueRead = true;
+                            }
+                            break;
+
+                        case IO_READ:
+                            if (cqe.res < 0)
+                            {
+                                file.error = "Cannot read file: " + file.path + " (" + std::strerror(-cqe.res) + ")";
+                                file.readMs = elapsedMs(starts[i]);
+                                buf.clear();
+                                queueClose = true;
+                            }
+                            else
+                            {
+                                sizes[i] += static_cast<size_t>(cqe.res);
+                                if (sizes[i] == buf.size())
+                                {
+                                    // Buffer filled up; the file may be longer
+                                    buf.resize(buf.size() * 2);
+                                    queueRead = true;
+                                }
+                                else
+                                {
+                                    // Short read on a regular file means end of file
+                                    buf.resize(sizes[i]);
+                                    file.readMs = elapsedMs(starts[i]);
+#ifdef YAML_TRACE
+                                    // Many reads are in flight on this thread at once
+                                    detail::traceAsync("read", file.path, starts[i], Clock::now(), "\"io\": \"io_uring\"");
+#endif
+                                    queueClose = true;
+                                    pool.submit([&file, &buf, recordIncludes]() {
+                                        parseLoaded(file, buf, recordIncludes);
+                                        std::string().swap(buf);
+                                    });
+                                }
+                            }
+                            break;
+
+                        case IO_CLOSE:
+                            break;
+                        }
+
+                        if (queueRead)
+                        {
+                            io_uring_sqe *e = ring.sqe();
+                            e->opcode = IORING_OP_READ;
+                            e->fd = fds[i];
+                            e->addr = reinterpret_cast<unsigned long long>(&buf[sizes[i]]);
+                            e->len = static_cast<unsigned>(buf.size() - sizes[i]);
+                            e->off = sizes[i];
+                            e->user_data = (i << 2) | IO_READ;
+                            inflight++;
+                        }
+                        else if (queueClose)
+                        {
+                            io_uring_sqe *e = ring.sqe();
+                            e->opcode = IORING_OP_CLOSE;
+                            e->fd = fds[i];
+                            e->user_data = (i << 2) | IO_CLOSE;
+                            fds[i] = -1;
+                            inflight++;
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+#endif // YAML_HAVE_IO_URING
+
+        // Plain parallel read + parse, shared by loadFiles and include resolution
+        std::vector<LoadedFile> loadBatch(const std::vector<std::string> &paths, const LoadOptions &options)
+        {
+            std::vector<LoadedFile> results(paths.size());
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                results[i].path = paths[i];
+            }
+            if (paths.empty())
+                return results;
+
+            unsigned threads = options.threads;
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+
+            bool done = false;
+
+#ifdef YAML_HAVE_IO_URING
+            std::vector<std::string> buffers(paths.size());
+            if (options.useIoUring)
+            {
+                TaskPool pool(threads);
+                size_t batch = std::max<size_t>(1, std::min<size_t>(options.batchSize, 4096));
+                done = loadWithIoUring(results, buffers, batch, options.resolveIncludes, pool);
+                pool.finish();
+                if (!done)
+                {
+                    // Ring setup or submission failed (seccomp, old kernel):
+                    // start over without it
+                    for (size_t i = 0; i < results.size(); ++i)
+                    {
+                        results[i] = LoadedFile();
+                        results[i].path = paths[i];
+                    }
+                }
+            }
+#endif
+
+            if (!done)
+            {
+                TaskPool pool(threads);
+                for (size_t i = 0; i < results.size(); ++i)
+                {
+                    LoadedFile *file = &results[i];
+                    bool record = options.resolveIncludes;
+                    pool.submit([file, record]() { readAndParse(*file, record); });
+                }
+                pool.finish();
+            }
+            return results;
+        }
+
+    } // namespace detail
+
+    // ============================================================================
+    // Include Resolution Implementation
+    // ============================================================================
+
+    namespace detail
     {
-        if (type_ != YamlType::NUMBER)
+        // A file parsed once, with its `!include` sites still unresolved
+        struct ParsedFragment
         {
-            throw YamlException("Value is not a number");
+            LoadedFile file;
+            std::vector<std::string> targets; // canonical path per include site, "" if missing
+            long long mtime;                  // nanoseconds
+            off_t size;
+
+            ParsedFragment() : mtime(0), size(0) {}
+        };
+
+        typedef std::shared_ptr<const ParsedFragment> FragmentPtr;
+
+        long long mtimeNs(const struct stat &st)
+        {
+#ifdef __APPLE__
+            return static_cast<long long>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+            return static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
         }
-        return numberValue_;
-    }
 
-    int YamlValue::asInt() const
+        // Process-wide cache keyed by canonical path; entries are reused while
+        // mtime and size still match the file on disk
+        class IncludeCache
+        {
+        public:
+            static IncludeCache &instance()
+            {
+                static IncludeCache cache;
+                return cache;
+            }
+
+            FragmentPtr find(const std::string &path, long long mtime, off_t size)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::map<std::string, FragmentPtr>::const_iterator it = entries_.find(path);
+                if (it != entries_.end() && it->second->mtime == mtime && it->second->size == size)
+                    return it->second;
+                return FragmentPtr();
+            }
+
+            void store(const std::string &path, const FragmentPtr &fragment)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entries_[path] = fragment;
+            }
+
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entries_.clear();
+            }
+
+        private:
+            std::mutex mutex_;
+            std::map<std::string, FragmentPtr> entries_;
+        };
+
+        bool canonicalPath(const std::string &path, std::string &out)
+        {
+            char *resolved = realpath(path.c_str(), nullptr);
+            if (!resolved)
+                return false;
+            out = resolved;
+            free(resolved);
+            return true;
+        }
+
+        // Include targets are relative to the directory of the including file
+        std::string includeTarget(const std::string &from, const std::string &target)
+        {
+            if (!target.empty() && target[0] == '/')
+                return target;
+            size_t slash = from.rfind('/');
+            return slash == std::string::npos ? target : from.substr(0, slash + 1) + target;
+        }
+
+        YamlValue &locate(YamlValue &root, const std::vector<PathStep> &path)
+        {
+            YamlValue *node = &root;
+            for (size_t i = 0; i < path.size(); ++i)
+            {
+                if (path[i].isIndex)
+                {
+                    YamlValue::Sequence &seq = node->asSequence();
+                    if (path[i].index >= seq.size())
+                        throw YamlException("Include site out of range");
+                    node = &seq[path[i].index];
+                }
+                else
+                {
+                    YamlValue::Mapping &map = node->asMapping();
+                    YamlValue::Mapping::iterator it = map.find(path[i].key);
+                    if (it == map.end())
+                        throw YamlException("Include site not found: " + path[i].key);
+                    node = &it->second;
+                }
+            }
+            return *node;
+        }
+
+        class IncludeResolver
+        {
+        public:
+            explicit IncludeResolver(const LoadOptions &options) : options_(options) {}
+
+            // Loads the given files and everything they include, one include
+            // depth at a time; each level is read and parsed in parallel
+            void fetch(const std::vector<std::string> &roots)
+            {
+                std::vector<std::string> frontier;
+                for (size_t i = 0; i < roots.size(); ++i)
+                {
+                    if (!roots[i].empty() && !fragments_.count(roots[i]) &&
+                        std::find(frontier.begin(), frontier.end(), roots[i]) == frontier.end())
+                        frontier.push_back(roots[i]);
+                }
+
+                while (!frontier.empty())
+                {
+                    std::vector<std::string> toLoad;
+                    std::vector<struct stat> stats;
+                    std::vector<FragmentPtr> reached;
+
+                    for (size_t i = 0; i < frontier.size(); ++i)
+                    {
+                        struct stat st;
+                        if (stat(frontier[i].c_str(), &st) != 0)
+                        {
+                            std::shared_ptr<ParsedFragment> missing(new ParsedFragment());
+                            missing->file.path = frontier[i];
+                            missing->file.error = "Cannot open file: " + frontier[i];
+                            fragments_[frontier[i]] = missing;
+                            continue;
+                        }
+                        FragmentPtr cached = IncludeCache::instance().find(frontier[i], mtimeNs(st), st.st_size);
+                        if (cached)
+                        {
+                            fragments_[frontier[i]] = cached;
+                            reached.push_back(cached);
+                        }
+                        else
+                        {
+                            toLoad.push_back(frontier[i]);
+                            stats.push_back(st);
+                        }
+                    }
+
+                    YAML_TRACE_SPAN("include level", std::to_string(toLoad.size()) + " files");
+                    LoadOptions recording = options_;
+                    recording.resolveIncludes = true;
+                    std::vector<LoadedFile> loaded = loadBatch(toLoad, recording);
+                    for (size_t i = 0; i < loaded.size(); ++i)
+                    {
+                        std::shared_ptr<ParsedFragment> fragment(new ParsedFragment());
+                        fragment->file = std::move(loaded[i]);
+                        fragment->mtime = mtimeNs(stats[i]);
+                        fragment->size = stats[i].st_size;
+                        for (size_t j = 0; j < fragment->file.includes.size(); ++j)
+                        {
+                            std::string canonical;
+                            canonicalPath(includeTarget(toLoad[i], fragment->file.includes[j].target), canonical);
+                            fragment->targets.push_back(canonical);
+                        }
+                        if (fragment->file.ok)
+                            IncludeCache::instance().store(toLoad[i], fragment);
+                        fragments_[toLoad[i]] = fragment;
+                        reached.push_back(fragment);
+                    }
+
+                    frontier.clear();
+                    for (size_t i = 0; i < reached.size(); ++i)
+                    {
+                        const std::vector<std::string> &targets = reached[i]->targets;
+                        for (size_t j = 0; j < targets.size(); ++j)
+                        {
+                            if (!targets[j].empty() && !fragments_.count(targets[j]) &&
+                                std::find(frontier.begin(), frontier.end(), targets[j]) == frontier.end())
+                                frontier.push_back(targets[j]);
+                        }
+                    }
+                }
+            }
+
+            const ParsedFragment &fragment(const std::string &path) const
+            {
+                return *fragments_.find(path)->second;
+            }
+
+            // Copy of a fetched document with every include substituted
+            YamlValue resolve(const std::string &path)
+            {
+                std::map<std::string, YamlValue>::const_iterator done = resolved_.find(path);
+                if (done != resolved_.end())
+                    return done->second;
+
+                if (std::find(stack_.begin(), stack_.end(), path) != stack_.end())
+                {
+                    std::string chain;
+                    for (size_t i = 0; i < stack_.size(); ++i)
+                        chain += stack_[i] + " -> ";
+                    throw YamlException("Include cycle: " + chain + path);
+                }
+
+                const ParsedFragment &frag = fragment(path);
+                if (!frag.file.ok)
+                {
+                    throw YamlException("In included file " + path + ": " + frag.file.error,
+                                        frag.file.line, frag.file.column);
+                }
+
+                YAML_TRACE_SPAN("include", path);
+                stack_.push_back(path);
+                YamlValue value = frag.file.value;
+                for (size_t i = 0; i < frag.file.includes.size(); ++i)
+                {
+                    if (frag.targets[i].empty())
+                        throw YamlException("Included file not found: " + frag.file.includes[i].target);
+                    locate(value, frag.file.includes[i].path) = resolve(frag.targets[i]);
+                }
+                stack_.pop_back();
+
+                resolved_[path] = value;
+                return value;
+            }
+
+        private:
+            LoadOptions options_;
+            std::map<std::string, FragmentPtr> fragments_;
+            std::map<std::string, YamlValue> resolved_;
+            std::vector<std::string> stack_;
+        };
+
+        std::vector<LoadedFile> loadResolvingIncludes(const std::vector<std::string> &paths, const LoadOptions &options)
+        {
+            std::vector<std::string> canonical(paths.size());
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                canonicalPath(paths[i], canonical[i]);
+            }
+
+            IncludeResolver resolver(options);
+            resolver.fetch(canonical);
+
+            std::vector<LoadedFile> results(paths.size());
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                LoadedFile &out = results[i];
+                out.path = paths[i];
+                if (canonical[i].empty())
+                {
+                    out.error = "Cannot open file: " + paths[i];
+                    continue;
+                }
+
+                const LoadedFile &own = resolver.fragment(canonical[i]).file;
+                out.bytes = own.bytes;
+                out.readMs = own.readMs;
+                out.parseMs = own.parseMs;
+                out.includes = own.includes;
+                if (!own.ok)
+                {
+                    out.error = own.error;
+                    out.line = own.line;
+                    out.column = own.column;
+                    continue;
+                }
+
+                try
+                {
+                    out.value = resolver.resolve(canonical[i]);
+                    out.ok = true;
+                }
+                catch (const YamlException &e)
+                {
+                    out.error = e.what();
+                    out.line = e.line;
+                    out.column = e.column;
+                }
+            }
+            return results;
+        }
+    } // namespace detail
+
+    std::vector<LoadedFile> loadFiles(const std::vector<std::string> &paths, const LoadOptions &options)
     {
-        return static_cast<int>(asNumber());
+        YAML_TRACE_SPAN("loadFiles", std::to_string(paths.size()) + " files");
+        if (options.resolveIncludes)
+            return detail::loadResolvingIncludes(paths, options);
+        return detail::loadBatch(paths, options);
     }
 
-    const std::string &YamlValue::asString() const
+    void clearIncludeCache()
     {
-        if (type_ != YamlType::STRING)
-        {
-            throw YamlException("Value is not a string");
-        }
-        return *stringValue_;
+        detail::IncludeCache::instance().clear();
     }
 
-    YamlValue::Sequence &YamlValue::asSequence()
+    // ============================================================================
+    // Directory Tree Loader Implementation
+    // ============================================================================
+
+    namespace detail
     {
-        if (type_ != YamlType::SEQUENCE)
+        bool hasYamlExtension(const std::string &name)
         {
-            throw YamlException("Value is not a sequence");
+            size_t dot = name.rfind('.');
+            if (dot == std::string::npos)
+                return false;
+            std::string ext = name.substr(dot);
+            return ext == ".yaml" || ext == ".yml";
         }
-        return *sequenceValue_;
-    }
 
-    const YamlValue::Sequence &YamlValue::asSequence() const
-    {
-        if (type_ != YamlType::SEQUENCE)
+        // Collects relative paths of YAML files. Symlinked directories are not
+        // followed, so link cycles cannot cause endless recursion.
+        void discoverYaml(const std::string &root, const std::string &rel,
+                          std::vector<std::string> &out, std::vector<LoadedFile> &errors)
         {
-            throw YamlException("Value is not a sequence");
+            std::string dirPath = rel.empty() ? root : root + "/" + rel;
+            DIR *dir = opendir(dirPath.c_str());
+            if (!dir)
+            {
+                if (rel.empty())
+                    throw YamlException("Cannot open directory: " + root);
+                LoadedFile failed;
+                failed.path = rel;
+                failed.error = "Cannot open directory: " + dirPath + " (" + std::strerror(errno) + ")";
+                errors.push_back(failed);
+                return;
+            }
+
+            std::vector<std::string> subdirs;
+            while (dirent *entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (name == "." || name == "..")
+                    continue;
+
+                std::string childRel = rel.empty() ? name : rel + "/" + name;
+                std::string childPath = root + "/" + childRel;
+                struct stat st;
+                bool isDir = false;
+                bool isFile = false;
+                if (lstat(childPath.c_str(), &st) == 0)
+                {
+                    isDir = S_ISDIR(st.st_mode);
+                    isFile = S_ISREG(st.st_mode);
+                    if (S_ISLNK(st.st_mode) && stat(childPath.c_str(), &st) == 0)
+                        isFile = S_ISREG(st.st_mode);
+                }
+
+                if (isDir)
+                    subdirs.push_back(childRel);
+                else if (isFile && hasYamlExtension(name))
+                    out.push_back(childRel);
+            }
+            closedir(dir);
+
+            for (size_t i = 0; i < subdirs.size(); ++i)
+            {
+                discoverYaml(root, subdirs[i], out, errors);
+            }
         }
-        return *sequenceValue_;
-    }
+    } // namespace detail
 
-    YamlValue::Mapping &YamlValue::asMapping()
+    void deepMerge(YamlValue &dst, YamlValue &&src)
     {
-        if (type_ != YamlType::MAPPING)
+        if (dst.isMapping() && src.isMapping())
         {
-            throw YamlException("Value is not a mapping");
+            YamlValue::Mapping &into = dst.asMapping();
+            YamlValue::Mapping &from = src.asMapping();
+            for (auto &pair : from)
+            {
+                auto it = into.find(pair.first);
+                if (it == into.end())
+                    into[pair.first] = std::move(pair.second);
+                else
+                    deepMerge(it->second, std::move(pair.second));
+            }
+            return;
         }
-        return *mappingValue_;
+        dst = std::move(src);
     }
 
-    const YamlValue::Mapping &YamlValue::asMapping() const
+    TreeResult loadTree(const std::string &dir, const TreeOptions &options)
     {
-        if (type_ != YamlType::MAPPING)
+        YAML_TRACE_SPAN("loadTree", dir);
+        TreeResult result;
+        detail::Clock::time_point start = detail::Clock::now();
+
+        std::string root = dir;
+        while (root.size() > 1 && root.back() == '/')
+            root.pop_back();
+
+        std::vector<std::string> relPaths;
+        std::vector<LoadedFile> dirErrors;
         {
-            throw YamlException("Value is not a mapping");
+            YAML_TRACE_SPAN("discover", root);
+            detail::discoverYaml(root, "", relPaths, dirErrors);
+            std::sort(relPaths.begin(), relPaths.end());
         }
-        return *mappingValue_;
-    }
+        result.discoverMs = detail::elapsedMs(start);
 
-    size_t YamlValue::size() const
-    {
-        switch (type_)
+        std::vector<std::string> fullPaths;
+        fullPaths.reserve(relPaths.size());
+        for (size_t i = 0; i < relPaths.size(); ++i)
         {
-        case YamlType::SEQUENCE:
-            return sequenceValue_->size();
-        case YamlType::MAPPING:
-            return mappingValue_->size();
-        case YamlType::STRING:
-            return stringValue_->size();
-        default:
-            return 0;
+            fullPaths.push_back(root + "/" + relPaths[i]);
         }
-    }
-
-    bool YamlValue::empty() const
-    {
-        return size() == 0;
-    }
+        result.files = loadFiles(fullPaths, options);
 
-    bool YamlValue::contains(const std::string &key) const
-    {
-        if (type_ != YamlType::MAPPING)
+        start = detail::Clock::now();
         {
-            return false;
+            YAML_TRACE_SPAN("merge", options.merge == MergePolicy::BY_PATH ? "by path" : "deep merge");
+            result.root = YamlValue(YamlValue::Mapping());
+            for (size_t i = 0; i < result.files.size(); ++i)
+            {
+                LoadedFile &file = result.files[i];
+                file.path = relPaths[i];
+                if (!file.ok)
+                    continue;
+
+                if (options.merge == MergePolicy::BY_PATH)
+                {
+                    result.root[file.path] = std::move(file.value);
+                }
+                else if (file.value.isMapping())
+                {
+                    deepMerge(result.root, std::move(file.value));
+                }
+                else if (!file.value.isNil())
+                {
+                    // Merging it would replace every earlier file
+                    file.ok = false;
+                    file.error = "Document root is not a mapping; cannot deep merge";
+                }
+                file.value.clear();
+            }
         }
-        return mappingValue_->find(key) != mappingValue_->end();
-    }
+        result.mergeMs = detail::elapsedMs(start);
 
-    void YamlValue::clear()
-    {
-        cleanup();
-        type_ = YamlType::NIL;
+        result.files.insert(result.files.end(), dirErrors.begin(), dirErrors.end());
+        return result;
     }
 
-    YamlValue &YamlValue::operator[](const std::string &key)
+    // ============================================================================
+    // DocumentTail Implementation
+    // ============================================================================
+
+    namespace detail
     {
-        if (type_ == YamlType::NIL)
+        // '-' for "---" and '.' for "..." at pos, alone on the line of len
+        // bytes (line break excluded) or followed by a blank; 0 otherwise
+        char separatorAt(const std::string &text, size_t pos, size_t len)
         {
-            type_ = YamlType::MAPPING;
-            mappingValue_ = new Mapping();
+            if (len < 3 || (text.compare(pos, 3, "---") != 0 && text.compare(pos, 3, "...") != 0))
+                return 0;
+            if (len > 3 && text[pos + 3] != ' ' && text[pos + 3] != '\t')
+                return 0;
+            return text[pos];
         }
-        if (type_ != YamlType::MAPPING)
+
+        bool blankText(const std::string &text, size_t begin, size_t end)
         {
-            throw YamlException("Value is not a mapping");
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (text[i] != ' ' && text[i] != '\t' && text[i] != '\r' && text[i] != '\n')
+                    return false;
+            }
+            return true;
         }
-        return (*mappingValue_)[key];
     }
 
-    const YamlValue &YamlValue::operator[](const std::string &key) const
+    std::vector<std::string> splitDocuments(const std::string &text)
     {
-        if (type_ != YamlType::MAPPING)
+        std::vector<std::string> docs;
+        size_t docStart = 0;
+        size_t pos = 0;
+        while (pos < text.size())
         {
-            throw YamlException("Value is not a mapping");
-        }
-        auto it = mappingValue_->find(key);
-        if (it == mappingValue_->end())
-        {
-            throw YamlException("Key not found: " + key);
+            size_t eol = text.find('\n', pos);
+            size_t next = eol == std::string::npos ? text.size() : eol + 1;
+            size_t len = (eol == std::string::npos ? text.size() : eol) - pos;
+            if (len > 0 && text[pos + len - 1] == '\r')
+                len--;
+            char marker = detail::separatorAt(text, pos, len);
+            if (marker)
+            {
+                if (!detail::blankText(text, docStart, pos))
+                    docs.push_back(text.substr(docStart, pos - docStart));
+                docStart = marker == '-' ? pos + 3 : next;
+            }
+            pos = next;
         }
-        return it->second;
+        if (!detail::blankText(text, docStart, text.size()))
+            docs.push_back(text.substr(docStart));
+        return docs;
     }
 
-    YamlValue &YamlValue::operator[](size_t index)
+    DocumentTail::DocumentTail(const std::string &path, uint64_t offset)
+        : path_(path), fd_(-1), watch_(-1), base_(offset), readPos_(offset), docStart_(0), scanPos_(0)
     {
-        if (type_ == YamlType::NIL)
-        {
-            type_ = YamlType::SEQUENCE;
-            sequenceValue_ = new Sequence();
-        }
-        if (type_ != YamlType::SEQUENCE)
+        fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0)
         {
-            throw YamlException("Value is not a sequence");
+            throw YamlException("Cannot open file: " + path);
         }
-        if (index >= sequenceValue_->size())
+#ifdef __linux__
+        watch_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch_ >= 0 && inotify_add_watch(watch_, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0)
         {
-            sequenceValue_->resize(index + 1);
+            close(watch_);
+            watch_ = -1;
         }
-        return (*sequenceValue_)[index];
+#endif
     }
 
-    const YamlValue &YamlValue::operator[](size_t index) const
+    DocumentTail::~DocumentTail()
     {
-        if (type_ != YamlType::SEQUENCE)
-        {
-            throw YamlException("Value is not a sequence");
-        }
-        if (index >= sequenceValue_->size())
+        if (watch_ >= 0)
+            close(watch_);
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    size_t DocumentTail::poll(std::vector<YamlValue> &out, int timeoutMs)
+    {
+        readAvailable_();
+        size_t added = extract_(out);
+        if (added == 0 && timeoutMs > 0)
         {
-            throw YamlException("Index out of bounds");
+            waitForData_(timeoutMs);
+            if (readAvailable_())
+                added = extract_(out);
         }
-        return (*sequenceValue_)[index];
+        return added;
     }
 
-    std::string YamlValue::serialize(int indent) const
+    size_t DocumentTail::flush(std::vector<YamlValue> &out)
     {
-        return serializeValue(indent);
+        readAvailable_();
+        size_t added = extract_(out);
+        std::string pending;
+        pending.swap(buffer_);
+        base_ = readPos_;
+        docStart_ = scanPos_ = 0;
+
+        if (pending.find_first_not_of(" \t\r\n") != std::string::npos)
+        {
+            out.push_back(parse(pending));
+            added++;
+        }
+        return added;
     }
 
-    std::string YamlValue::serializeValue(int indent, bool inArray) const
+    bool DocumentTail::readAvailable_()
     {
-        std::ostringstream oss;
-
-        switch (type_)
+        struct stat st;
+        if (fstat(fd_, &st) == 0 && static_cast<uint64_t>(st.st_size) < readPos_)
         {
-        case YamlType::NIL:
-            oss << "null";
-            break;
-
-        case YamlType::BOOLEAN:
-            oss << (boolValue_ ? "true" : "false");
-            break;
-
-        case YamlType::NUMBER:
-            if (numberValue_ == static_cast<int>(numberValue_))
-            {
-                oss << static_cast<int>(numberValue_);
-            }
-            else
-            {
-                oss << numberValue_;
-            }
-            break;
+            throw YamlException("File was truncated: " + path_);
+        }
 
-        case YamlType::STRING:
+        bool grew = false;
+        char chunk[64 * 1024];
+        for (;;)
         {
-            const std::string &str = *stringValue_;
-            bool needsQuotes = str.empty() ||
-                               str.find('\n') != std::string::npos ||
-                               str.find(':') != std::string::npos ||
-                               str.find('#') != std::string::npos ||
-                               str.find('[') != std::string::npos ||
-                               str.find(']') != std::string::npos ||
-                               str.find('{') != std::string::npos ||
-                               str.find('}') != std::string::npos ||
-                               (!str.empty() && (str.front() == ' ' || str.back() == ' '));
-
-            if (needsQuotes)
-            {
-                oss << "\"";
-                for (char c : str)
-                {
-                    switch (c)
-                    {
-                    case '"':
-                        oss << "\\\"";
-                        break;
-                    case '\\':
-                        oss << "\\\\";
-                        break;
-                    case '\n':
-                        oss << "\\n";
-                        break;
-                    case '\r':
-                        oss << "\\r";
-                        break;
-                    case '\t':
-                        oss << "\\t";
-                        break;
-                    default:
-                        oss << c;
-                        break;
-                    }
-                }
-                oss << "\"";
-            }
-            else
-            {
-                oss << str;
-            }
-            break;
+            ssize_t n = pread(fd_, chunk, sizeof(chunk), static_cast<off_t>(readPos_));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            buffer_.append(chunk, static_cast<size_t>(n));
+            readPos_ += static_cast<uint64_t>(n);
+            grew = true;
         }
+        return grew;
+    }
 
-        case YamlType::SEQUENCE:
+    void DocumentTail::waitForData_(int timeoutMs)
+    {
+#ifdef __linux__
+        if (watch_ >= 0)
         {
-            if (sequenceValue_->empty())
-            {
-                oss << "[]";
-            }
-            else
+            pollfd pfd;
+            pfd.fd = watch_;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (::poll(&pfd, 1, timeoutMs) > 0)
             {
-                for (size_t i = 0; i < sequenceValue_->size(); ++i)
+                char events[4096];
+                while (read(watch_, events, sizeof(events)) > 0)
                 {
-                    if (i > 0)
-                        oss << "\n";
-                    oss << std::string(indent, ' ') << "- ";
-                    std::string itemStr = (*sequenceValue_)[i].serializeValue(indent + 2, true);
-                    oss << itemStr;
                 }
             }
-            break;
+            return;
+        }
+#endif
+        // No change notification available: check the size every few ms
+        detail::Clock::time_point start = detail::Clock::now();
+        while (detail::elapsedMs(start) < timeoutMs)
+        {
+            struct stat st;
+            if (fstat(fd_, &st) == 0 && static_cast<uint64_t>(st.st_size) > readPos_)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
+    }
 
-        case YamlType::MAPPING:
+    size_t DocumentTail::extract_(std::vector<YamlValue> &out)
+    {
+        size_t added = 0;
+        std::string error;
+        int errorLine = 0;
+
+        // Only complete lines are inspected; scanPos_ never moves backwards
+        for (;;)
         {
-            if (mappingValue_->empty())
-            {
-                oss << "{}";
-            }
-            else
+            size_t eol = buffer_.find('\n', scanPos_);
+            if (eol == std::string::npos)
+                break;
+
+            size_t len = eol - scanPos_;
+            if (len > 0 && buffer_[eol - 1] == '\r')
+                len--;
+            char marker = detail::separatorAt(buffer_, scanPos_, len);
+            if (marker)
             {
-                bool first = true;
-                for (const auto &pair : *mappingValue_)
+                try
                 {
-                    if (!first)
-                        oss << "\n";
-                    first = false;
-
-                    if (!inArray)
-                    {
-                        oss << std::string(indent, ' ');
-                    }
-                    oss << pair.first << ": ";
-
-                    std::string valueStr = pair.second.serializeValue(indent + 2);
-                    if (pair.second.isMapping() && !pair.second.empty())
-                    {
-                        oss << "\n"
-                            << std::string(indent + 2, ' ') << valueStr;
-                    }
-                    else if (pair.second.isSequence() && !pair.second.empty())
-                    {
-                        oss << "\n"
-                            << valueStr;
-                    }
-                    else
+                    if (emit_(scanPos_, out))
+                        added++;
+                }
+                catch (const YamlException &e)
+                {
+                    if (error.empty())
                     {
-                        oss << valueStr;
+                        error = e.what();
+                        errorLine = e.line;
                     }
                 }
+                // "--- value" opens a document on the marker's own line
+                docStart_ = marker == '-' ? scanPos_ + 3 : eol + 1;
             }
-            break;
+            scanPos_ = eol + 1;
         }
-        }
-
-        return oss.str();
-    }
 
-    void YamlValue::trace() const
-    {
-        std::cout << "YamlValue Trace:" << std::endl;
-        std::cout << "Type: " << static_cast<int>(type_) << std::endl;
-        std::cout << "Size: " << size() << std::endl;
-        if (type_ == YamlType::STRING)
-        {
-            std::cout << "String Value: " << *stringValue_ << std::endl;
-        }
-        else if (type_ == YamlType::NUMBER)
-        {
-            std::cout << "Number Value: " << numberValue_ << std::endl;
-        }
-        else if (type_ == YamlType::BOOLEAN)
-        {
-            std::cout << "Boolean Value: " << (boolValue_ ? "true" : "false") << std::endl;
-        }
-        else if (type_ == YamlType::SEQUENCE)
-        {
-            std::cout << "Sequence Values:" << std::endl;
-            for (size_t i = 0; i < sequenceValue_->size(); ++i)
-            {
-                std::cout << "  [" << i << "] ";
-                (*sequenceValue_)[i].trace();
-            }
-        }
-        else if (type_ == YamlType::MAPPING)
-        {
-            std::cout << "Mapping Values:" << std::endl;
-            for (const auto &pair : *mappingValue_)
-            {
-                std::cout << "  Key: " << pair.first << std::endl;
-                pair.second.trace();
-            }
-        }
-        else
+        // Drop what has been handed out so the buffer only holds the pending document
+        if (docStart_ > 0)
         {
-            std::cout << "Nil Value" << std::endl;
+            buffer_.erase(0, docStart_);
+            base_ += docStart_;
+            scanPos_ -= docStart_;
+            docStart_ = 0;
         }
-    }
-
-    bool YamlValue::operator==(const YamlValue &other) const
-    {
-        if (type_ != other.type_)
-            return false;
 
-        switch (type_)
+        if (!error.empty())
         {
-        case YamlType::NIL:
-            return true;
-        case YamlType::BOOLEAN:
-            return boolValue_ == other.boolValue_;
-        case YamlType::NUMBER:
-            return numberValue_ == other.numberValue_;
-        case YamlType::STRING:
-            return *stringValue_ == *other.stringValue_;
-        case YamlType::SEQUENCE:
-            return *sequenceValue_ == *other.sequenceValue_;
-        case YamlType::MAPPING:
-            return *mappingValue_ == *other.mappingValue_;
+            throw YamlException(error, errorLine);
         }
-        return false;
+        return added;
     }
 
-    // ============================================================================
-    // Token Implementation
-    // ============================================================================
-
-    Token::Token() : type(TokenType::TOKEN_EOF), line(0), column(0), indent(0) {}
-
-    Token::Token(TokenType t, const std::string &val, int ln, int col, int ind)
-        : type(t), value(val), line(ln), column(col), indent(ind) {}
+    bool DocumentTail::emit_(size_t end, std::vector<YamlValue> &out)
+    {
+        std::string text = buffer_.substr(docStart_, end - docStart_);
+        if (text.find_first_not_of(" \t\r\n") == std::string::npos)
+            return false; // empty document, e.g. a leading "---"
+        out.push_back(parse(text));
+        return true;
+    }
 
     // ============================================================================
-    // Scanner Implementation
+    // Snapshot Implementation
     // ============================================================================
 
-    Scanner::Scanner(const std::string &src)
-        : s_(src), cur_(0), line_(1), col_(1), bol_(true)
+    namespace detail
     {
-        indents_.push_back(0); // Base indentation level
-    }
+        const size_t SNAPSHOT_HEADER = 12;
+        const size_t SNAPSHOT_NODE = 20;
 
-    Token Scanner::next()
-    {
-        if (!pending_.empty())
+        enum SnapshotField
         {
-            Token t = pending_.front();
-            pending_.erase(pending_.begin());
-            return t;
+            SNAP_TYPE,
+            SNAP_KEY,        // pool offset of the key, for mapping entries
+            SNAP_KEY_LENGTH,
+            SNAP_A,          // bool; string offset; first child; low word of a number
+            SNAP_B           // string length; child count; high word of a number
+        };
+
+        inline uint32_t loadU32(const unsigned char *p)
+        {
+            return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                   static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
         }
 
-        while (!isAtEnd_())
+        inline void storeU32(std::string &out, size_t at, uint32_t v)
         {
-            if (bol_)
+            out[at] = static_cast<char>(v & 0xff);
+            out[at + 1] = static_cast<char>((v >> 8) & 0xff);
+            out[at + 2] = static_cast<char>((v >> 16) & 0xff);
+            out[at + 3] = static_cast<char>(v >> 24);
+        }
+
+        class SnapshotWriter
+        {
+        public:
+            std::string write(const YamlValue &root)
             {
-                int spaces = measureIndent_();
-                if (spaces >= 0)
+                // Offset 0 is "", the key of every node outside a mapping
+                intern_(std::string());
+                order_.push_back(&root);
+                nodes_.push_back(Node());
+                // Breadth-first: a container's children are appended together
+                for (size_t i = 0; i < order_.size(); ++i)
                 {
-                    emitIndentChange_(spaces);
-                    bol_ = false;
-
-                    // Se temos tokens pendentes, retornar o primeiro
-                    if (!pending_.empty())
+                    const YamlValue &value = *order_[i];
+                    Node &node = nodes_[i];
+                    node.fields[SNAP_TYPE] = static_cast<uint32_t>(value.getType());
+                    switch (value.getType())
+                    {
+                    case YamlType::BOOLEAN:
+                        node.fields[SNAP_A] = value.asBool() ? 1 : 0;
+                        break;
+                    case YamlType::NUMBER:
+                    {
+                        double number = value.asNumber();
+                        uint64_t bits;
+                        std::memcpy(&bits, &number, sizeof(bits));
+                        node.fields[SNAP_A] = static_cast<uint32_t>(bits);
+                        node.fields[SNAP_B] = static_cast<uint32_t>(bits >> 32);
+                        break;
+                    }
+                    case YamlType::STRING:
+                        node.fields[SNAP_A] = intern_(value.asString());
+                        node.fields[SNAP_B] = count_(value.asString().size());
+                        break;
+                    case YamlType::SEQUENCE:
+                    {
+                        const YamlValue::Sequence &seq = value.asSequence();
+                        nodes_[i].fields[SNAP_A] = count_(nodes_.size());
+                        nodes_[i].fields[SNAP_B] = count_(seq.size());
+                        for (const YamlValue &item : seq)
+                            add_(item);
+                        break;
+                    }
+                    case YamlType::MAPPING:
                     {
-                        Token t = pending_.front();
-                        pending_.erase(pending_.begin());
-                        return t;
+                        const YamlValue::Mapping &map = value.asMapping();
+                        nodes_[i].fields[SNAP_A] = count_(nodes_.size());
+                        nodes_[i].fields[SNAP_B] = count_(map.size());
+                        for (const auto &entry : map)
+                        {
+                            uint32_t key = intern_(entry.first);
+                            Node &child = add_(entry.second);
+                            child.fields[SNAP_KEY] = key;
+                            child.fields[SNAP_KEY_LENGTH] = count_(entry.first.size());
+                        }
+                        break;
+                    }
+                    default:
+                        break;
                     }
                 }
-                else
+
+                std::string out(SNAPSHOT_HEADER + nodes_.size() * SNAPSHOT_NODE, '\0');
+                out.replace(0, 4, "YSN1");
+                storeU32(out, 4, count_(nodes_.size()));
+                storeU32(out, 8, count_(pool_.size()));
+                for (size_t i = 0; i < nodes_.size(); ++i)
                 {
-                    bol_ = false; // Linha vazia/comentário, continuar
+                    for (int f = 0; f < 5; ++f)
+                        storeU32(out, SNAPSHOT_HEADER + i * SNAPSHOT_NODE + f * 4, nodes_[i].fields[f]);
                 }
+                out += pool_;
+                return out;
             }
 
-            char c = peek_();
-
-            // Skip whitespace (except newlines)
-            if (isSpace_(c) && c != '\n')
+        private:
+            struct Node
             {
-                advance_();
-                continue;
-            }
+                uint32_t fields[5];
 
-            // Comments
-            if (c == '#')
-            {
-                skipToEOL_();
-                continue;
-            }
+                Node() { std::memset(fields, 0, sizeof(fields)); }
+            };
 
-            // Newlines
-            if (c == '\n')
+            std::vector<const YamlValue *> order_;
+            std::vector<Node> nodes_;
+            std::string pool_;
+            std::map<std::string, uint32_t> interned_; // repeated keys are stored once
+
+            Node &add_(const YamlValue &value)
             {
-                advance_();
-                bol_ = true;
-                return make_(TokenType::TOKEN_NEWLINE);
+                order_.push_back(&value);
+                nodes_.push_back(Node());
+                return nodes_.back();
             }
 
-            // Structural characters
-            switch (c)
+            uint32_t intern_(const std::string &s)
             {
-            case ':':
-                advance_();
-                return make_(TokenType::TOKEN_COLON);
-            case '-':
-                if (peekNext_() == ' ' || peekNext_() == '\n' || peekNext_() == '\0')
-                {
-                    advance_();
-                    return make_(TokenType::TOKEN_DASH);
-                }
-                // Fall through to string parsing
-                break;
-            case '[':
-                advance_();
-                return make_(TokenType::TOKEN_LBRACKET);
-            case ']':
-                advance_();
-                return make_(TokenType::TOKEN_RBRACKET);
-            case '{':
-                advance_();
-                return make_(TokenType::TOKEN_LBRACE);
-            case '}':
-                advance_();
-                return make_(TokenType::TOKEN_RBRACE);
-            case ',':
-                advance_();
-                return make_(TokenType::TOKEN_COMMA);
+                auto it = interned_.find(s);
+                if (it != interned_.end())
+                    return it->second;
+                uint32_t offset = count_(pool_.size());
+                pool_.append(s).push_back('\0');
+                interned_.insert(std::make_pair(s, offset));
+                return offset;
             }
 
-            // Quoted strings
-            if (c == '"' || c == '\'')
+            static uint32_t count_(size_t n)
             {
-                char quote = advance_();
-                std::string str;
-                while (!isAtEnd_() && peek_() != quote)
-                {
-                    if (peek_() == '\\')
-                    {
-                        advance_(); // Skip backslash
-                        if (!isAtEnd_())
-                        {
-                            char escaped = advance_();
-                            switch (escaped)
-                            {
-                            case 'n':
-                                str += '\n';
-                                break;
-                            case 't':
-                                str += '\t';
-                                break;
-                            case 'r':
-                                str += '\r';
-                                break;
-                            case '\\':
-                                str += '\\';
-                                break;
-                            case '"':
-                                str += '"';
-                                break;
-                            case '\'':
-                                str += '\'';
-                                break;
-                            default:
-                                str += escaped;
-                                break;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        str += advance_();
-                    }
-                }
-                if (!isAtEnd_())
-                    advance_(); // Skip closing quote
-                return make_(TokenType::TOKEN_STRING, str);
+                if (n > 0xffffffffu)
+                    throw YamlException("Document too large for a snapshot");
+                return static_cast<uint32_t>(n);
             }
+        };
 
-            // Everything else: read until delimiter
-            std::string str;
+        struct EmbeddedBlob
+        {
+            const unsigned char *data;
+            size_t size;
+        };
 
-            // Read until we hit a structural character
-            while (!isAtEnd_())
-            {
-                char ch = peek_();
+        // Filled by static initializers, so it must exist before the first one runs
+        std::map<std::string, EmbeddedBlob> &embeddedRegistry()
+        {
+            static std::map<std::string, EmbeddedBlob> registry;
+            return registry;
+        }
 
-                // Stop at YAML structural characters
-                if (ch == ':' || ch == '\n' || ch == '#' ||
-                    ch == '[' || ch == ']' || ch == '{' || ch == '}' || ch == ',')
-                {
-                    break;
-                }
+        // Whether [offset, offset + length] is a NUL-terminated string in the pool
+        bool poolString(const char *pool, uint32_t poolBytes, uint32_t offset, uint32_t length)
+        {
+            return offset < poolBytes && length < poolBytes - offset && pool[offset + length] == '\0';
+        }
 
-                // Stop at dash if it's a list item marker (dash followed by space)
-                if (ch == '-' && (cur_ + 1 >= s_.size() || s_[cur_ + 1] == ' ' || s_[cur_ + 1] == '\n'))
-                {
-                    break;
-                }
+        // Header check shared by readSnapshot and embedded; returns the node count
+        uint32_t snapshotHeader(const unsigned char *bytes, size_t size, uint32_t &poolBytes)
+        {
+            if (size < SNAPSHOT_HEADER || std::memcmp(bytes, "YSN1", 4) != 0)
+                throw YamlException("Not a YAML snapshot");
+            uint32_t count = loadU32(bytes + 4);
+            poolBytes = loadU32(bytes + 8);
+            if (count == 0 || (size - SNAPSHOT_HEADER) / SNAPSHOT_NODE < count ||
+                size - SNAPSHOT_HEADER - static_cast<size_t>(count) * SNAPSHOT_NODE != poolBytes)
+                throw YamlException("Truncated YAML snapshot");
+            return count;
+        }
+    } // namespace detail
 
-                str += advance_();
-            }
+    std::string writeSnapshot(const YamlValue &value)
+    {
+        detail::SnapshotWriter writer;
+        return writer.write(value);
+    }
 
-            // Trim trailing spaces
-            while (!str.empty() && str.back() == ' ')
-            {
-                str.pop_back();
-            }
+    uint32_t SnapshotRef::field_(int i) const
+    {
+        return detail::loadU32(nodes_ + static_cast<size_t>(index_) * detail::SNAPSHOT_NODE + i * 4);
+    }
 
-            if (!str.empty())
-            {
-                // Check for special values
-                if (str == "true" || str == "false")
-                {
-                    return make_(TokenType::TOKEN_BOOLEAN, str);
-                }
-                if (str == "null" || str == "~")
-                {
-                    return make_(TokenType::TOKEN_NULL, str);
-                }
+    YamlType SnapshotRef::getType() const
+    {
+        if (!nodes_)
+            return YamlType::NIL;
+        return static_cast<YamlType>(field_(detail::SNAP_TYPE));
+    }
 
-                // Check if it's a pure number (improved validation)
-                bool isNumber = true;
-                size_t pos = 0;
-                bool hasDecimal = false;
+    bool SnapshotRef::asBool() const
+    {
+        if (getType() != YamlType::BOOLEAN)
+            throw YamlException("Value is not a boolean");
+        return field_(detail::SNAP_A) != 0;
+    }
 
-                // Skip optional negative sign
-                if (pos < str.size() && str[pos] == '-')
-                    pos++;
+    double SnapshotRef::asNumber() const
+    {
+        if (getType() != YamlType::NUMBER)
+            throw YamlException("Value is not a number");
+        uint64_t bits = static_cast<uint64_t>(field_(detail::SNAP_B)) << 32 | field_(detail::SNAP_A);
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+        return number;
+    }
 
-                // Must have at least one digit
-                if (pos >= str.size() || !isDigit_(str[pos]))
-                {
-                    isNumber = false;
-                }
-                else
-                {
-                    // Read digits and optional single decimal point
-                    while (pos < str.size() && isDigit_(str[pos]))
-                        pos++;
+    std::string SnapshotRef::asString() const
+    {
+        return std::string(asCString(), field_(detail::SNAP_B));
+    }
 
-                    if (pos < str.size() && str[pos] == '.' && !hasDecimal)
-                    {
-                        hasDecimal = true;
-                        pos++;
-                        // Must have digits after decimal point
-                        if (pos >= str.size() || !isDigit_(str[pos]))
-                        {
-                            isNumber = false;
-                        }
-                        else
-                        {
-                            while (pos < str.size() && isDigit_(str[pos]))
-                                pos++;
-                        }
-                    }
+    const char *SnapshotRef::asCString() const
+    {
+        if (getType() != YamlType::STRING)
+            throw YamlException("Value is not a string");
+        return pool_ + field_(detail::SNAP_A);
+    }
 
-                    // Should have consumed entire string, no extra characters allowed
-                    if (pos != str.size())
-                        isNumber = false;
-                }
+    size_t SnapshotRef::size() const
+    {
+        YamlType type = getType();
+        if (type != YamlType::SEQUENCE && type != YamlType::MAPPING)
+            return 0;
+        return field_(detail::SNAP_B);
+    }
 
-                if (isNumber)
-                {
-                    return make_(TokenType::TOKEN_NUMBER, str);
-                }
-                else
-                {
-                    return make_(TokenType::TOKEN_STRING, str);
-                }
-            }
+    const char *SnapshotRef::key() const
+    {
+        if (!nodes_)
+            return "";
+        return pool_ + field_(detail::SNAP_KEY);
+    }
 
-            // Skip unknown single characters
-            advance_();
+    bool SnapshotRef::find_(const char *key, size_t length, uint32_t &child) const
+    {
+        uint32_t lo = field_(detail::SNAP_A);
+        uint32_t hi = lo + field_(detail::SNAP_B);
+        // std::string ordering: bytewise, then the shorter key first
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            SnapshotRef entry(nodes_, pool_, mid);
+            size_t entryLength = entry.field_(detail::SNAP_KEY_LENGTH);
+            int cmp = std::memcmp(pool_ + entry.field_(detail::SNAP_KEY), key, std::min(entryLength, length));
+            if (cmp == 0)
+                cmp = entryLength < length ? -1 : (entryLength > length ? 1 : 0);
+            if (cmp == 0)
+            {
+                child = mid;
+                return true;
+            }
+            if (cmp < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        return false;
+    }
+
+    bool SnapshotRef::contains(const std::string &key) const
+    {
+        return has_(key.data(), key.size());
+    }
+
+    SnapshotRef SnapshotRef::operator[](const std::string &key) const
+    {
+        return at_(key.data(), key.size());
+    }
+
+    bool SnapshotRef::has_(const char *key, size_t length) const
+    {
+        uint32_t child;
+        return isMapping() && find_(key, length, child);
+    }
+
+    SnapshotRef SnapshotRef::at_(const char *key, size_t length) const
+    {
+        if (!isMapping())
+            throw YamlException("Value is not a mapping");
+        uint32_t child;
+        if (!find_(key, length, child))
+            throw YamlException("Key not found: " + std::string(key, length));
+        return SnapshotRef(nodes_, pool_, child);
+    }
 
-        // Handle final dedents
-        while (indents_.size() > 1)
+    SnapshotRef SnapshotRef::operator[](size_t index) const
+    {
+        if (!isSequence() && !isMapping())
+            throw YamlException("Value is not a sequence");
+        if (index >= size())
+            throw YamlException("Index out of bounds");
+        return SnapshotRef(nodes_, pool_, field_(detail::SNAP_A) + static_cast<uint32_t>(index));
+    }
+
+    YamlValue SnapshotRef::toValue() const
+    {
+        switch (getType())
+        {
+        case YamlType::BOOLEAN:
+            return YamlValue(asBool());
+        case YamlType::NUMBER:
+            return YamlValue(asNumber());
+        case YamlType::STRING:
+            return YamlValue(asString());
+        case YamlType::SEQUENCE:
         {
-            indents_.pop_back();
-            pending_.push_back(make_(TokenType::TOKEN_DEDENT));
+            YamlValue::Sequence seq;
+            seq.reserve(size());
+            for (size_t i = 0; i < size(); ++i)
+                seq.push_back((*this)[i].toValue());
+            return YamlValue(std::move(seq));
         }
-
-        if (!pending_.empty())
+        case YamlType::MAPPING:
         {
-            Token t = pending_.front();
-            pending_.erase(pending_.begin());
-            return t;
+            YamlValue::Mapping map;
+            for (size_t i = 0; i < size(); ++i)
+            {
+                SnapshotRef entry = (*this)[i];
+                map.emplace_hint(map.end(), std::string(entry.key(), entry.field_(detail::SNAP_KEY_LENGTH)),
+                                 entry.toValue());
+            }
+            return YamlValue(std::move(map));
+        }
+        default:
+            return YamlValue();
         }
+    }
 
-        return make_(TokenType::TOKEN_EOF);
+    SnapshotRef readSnapshot(const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        uint32_t poolBytes;
+        uint32_t count = detail::snapshotHeader(bytes, size, poolBytes);
+        const unsigned char *nodes = bytes + detail::SNAPSHOT_HEADER;
+        const char *pool = reinterpret_cast<const char *>(nodes + static_cast<size_t>(count) * detail::SNAPSHOT_NODE);
+
+        // Every string must end inside the pool and every child range inside
+        // the table, after its parent, so that reads stay in bounds and
+        // toValue() terminates
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            SnapshotRef node(nodes, pool, i);
+            uint32_t type = node.field_(detail::SNAP_TYPE);
+            uint32_t a = node.field_(detail::SNAP_A);
+            uint32_t b = node.field_(detail::SNAP_B);
+            bool ok = type <= static_cast<uint32_t>(YamlType::MAPPING) &&
+                      detail::poolString(pool, poolBytes, node.field_(detail::SNAP_KEY),
+                                         node.field_(detail::SNAP_KEY_LENGTH));
+            if (type == static_cast<uint32_t>(YamlType::STRING))
+                ok = ok && detail::poolString(pool, poolBytes, a, b);
+            if (type == static_cast<uint32_t>(YamlType::SEQUENCE) || type == static_cast<uint32_t>(YamlType::MAPPING))
+                ok = ok && (b == 0 || (a > i && a <= count && b <= count - a));
+            if (!ok)
+                throw YamlException("Corrupt YAML snapshot");
+        }
+        return SnapshotRef(nodes, pool, 0);
     }
 
-    bool Scanner::isAtEnd_() const
+    EmbeddedRegistration::EmbeddedRegistration(const char *name, const unsigned char *data, size_t size)
     {
-        return cur_ >= s_.size();
+        detail::EmbeddedBlob blob = {data, size};
+        detail::embeddedRegistry()[name] = blob;
     }
 
-    char Scanner::peek_() const
+    SnapshotRef embedded(const std::string &name)
     {
-        if (isAtEnd_())
-            return '\0';
-        return s_[cur_];
+        const std::map<std::string, detail::EmbeddedBlob> &registry = detail::embeddedRegistry();
+        auto it = registry.find(name);
+        if (it == registry.end())
+            throw YamlException("No embedded document: " + name);
+        uint32_t poolBytes;
+        uint32_t count = detail::snapshotHeader(it->second.data, it->second.size, poolBytes);
+        const unsigned char *nodes = it->second.data + detail::SNAPSHOT_HEADER;
+        return SnapshotRef(nodes, reinterpret_cast<const char *>(nodes + static_cast<size_t>(count) * detail::SNAPSHOT_NODE),
+                           0);
     }
 
-    char Scanner::peekNext_() const
+    std::vector<std::string> embeddedNames()
     {
-        if (cur_ + 1 >= s_.size())
-            return '\0';
-        return s_[cur_ + 1];
+        std::vector<std::string> names;
+        for (const auto &entry : detail::embeddedRegistry())
+            names.push_back(entry.first);
+        return names;
     }
 
-    char Scanner::advance_()
+#ifdef YAML_TRACE
+    // ============================================================================
+    // Trace Implementation
+    // ============================================================================
+
+    namespace detail
     {
-        if (isAtEnd_())
-            return '\0';
-        char c = s_[cur_++];
-        if (c == '\n')
+        struct TraceEvent
         {
-            line_++;
-            col_ = 1;
+            const char *name;
+            std::string detail;
+            std::string args; // extra JSON members, may be empty
+            double startUs;   // since Trace::start()
+            double durationUs;
+            uint64_t asyncId; // nonzero: drawn on its own lane, may overlap others
+        };
+
+        // Events of one thread. Only the owning thread appends, under mutex,
+        // which start/stop/json take to clear, quiesce and read the buffer;
+        // the registry keeps the buffer alive after the thread exits.
+        struct TraceBuffer
+        {
+            int tid;
+            std::mutex mutex;
+            std::vector<TraceEvent> events;
+        };
+
+        // traceMutex guards the registry; activity and origin are atomic so
+        // writers only ever take their own buffer's mutex
+        std::atomic<bool> traceActive(false);
+        std::mutex traceMutex;
+        std::vector<std::shared_ptr<TraceBuffer>> traceBuffers;
+        std::atomic<Clock::rep> traceOrigin(0);
+        int traceNextTid = 0;
+        std::atomic<uint64_t> traceNextAsyncId(0);
+
+        TraceBuffer &traceBuffer()
+        {
+            thread_local std::shared_ptr<TraceBuffer> buffer;
+            if (!buffer)
+            {
+                std::lock_guard<std::mutex> lock(traceMutex);
+                buffer = std::make_shared<TraceBuffer>();
+                buffer->tid = ++traceNextTid;
+                traceBuffers.push_back(buffer);
+            }
+            return *buffer;
         }
-        else
+
+        void traceRecord(const char *name, const std::string &detail, Clock::time_point start,
+                         Clock::time_point end, const std::string &args, bool async)
         {
-            col_++;
+            if (!traceActive.load(std::memory_order_acquire))
+                return;
+            TraceBuffer &buffer = traceBuffer();
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            // Checked again under the lock: stop() and start() hold it while
+            // they quiesce or clear this buffer
+            if (!traceActive.load(std::memory_order_acquire))
+                return;
+            Clock::time_point origin(Clock::duration(traceOrigin.load(std::memory_order_acquire)));
+            TraceEvent event;
+            event.name = name;
+            event.detail = detail;
+            event.args = args;
+            event.startUs = std::chrono::duration<double, std::micro>(start - origin).count();
+            event.durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+            event.asyncId = async ? ++traceNextAsyncId : 0;
+            buffer.events.push_back(std::move(event));
         }
-        return c;
-    }
 
-    void Scanner::skipToEOL_()
-    {
-        while (!isAtEnd_() && peek_() != '\n')
+        void traceComplete(const char *name, const std::string &detail, Clock::time_point start,
+                           Clock::time_point end, const std::string &args)
         {
-            advance_();
+            traceRecord(name, detail, start, end, args, false);
         }
-    }
 
-    int Scanner::measureIndent_()
-    {
-        size_t start = cur_;
-        int spaces = 0;
+        void traceAsync(const char *name, const std::string &detail, Clock::time_point start,
+                        Clock::time_point end, const std::string &args)
+        {
+            traceRecord(name, detail, start, end, args, true);
+        }
 
-        while (cur_ < s_.size() && (s_[cur_] == ' ' || s_[cur_] == '\t'))
+        // Parses with scanner timing on and records parse, scan and build
+        template <typename Policy>
+        YamlValue traceParse(BasicParser<Policy> &parser)
         {
-            if (s_[cur_] == ' ')
+            ParseStats stats;
+            Clock::time_point start = Clock::now();
+            parser.collectStats(&stats);
+            YamlValue result;
+            try
             {
-                spaces++;
+                result = parser.parse();
             }
-            else
+            catch (...)
             {
-                spaces += 8; // Tab = 8 spaces
+                parser.collectStats(nullptr);
+                traceComplete("parse", std::string(), start, Clock::now(), "\"error\": true");
+                throw;
             }
-            cur_++;
-            col_++;
+            parser.collectStats(nullptr);
+            Clock::time_point end = Clock::now();
+
+            Clock::time_point scanEnd = start + std::chrono::duration_cast<Clock::duration>(
+                                                    std::chrono::duration<double, std::milli>(stats.scanMs));
+            scanEnd = std::min(scanEnd, end);
+            traceComplete("parse", std::string(), start, end, "\"tokens\": " + std::to_string(stats.totalTokens()));
+            traceComplete("scan", std::string(), start, scanEnd, "\"aggregate\": true");
+            traceComplete("build", std::string(), scanEnd, end, "\"aggregate\": true");
+            return result;
         }
 
-        // Check if line is empty or comment
-        if (cur_ >= s_.size() || s_[cur_] == '\n' || s_[cur_] == '#')
+        void writeTraceString(std::ostringstream &oss, const std::string &s)
         {
-            cur_ = start;   // Reset position
-            col_ -= spaces; // Reset column
-            return -1;      // Signal empty/comment line
+            oss << '"';
+            for (char c : s)
+            {
+                if (c == '"' || c == '\\')
+                    oss << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                    oss << buf;
+                }
+                else
+                    oss << c;
+            }
+            oss << '"';
         }
-
-        return spaces;
     }
 
-    void Scanner::emitIndentChange_(int spaces)
+    void Trace::start()
     {
-        int currentIndent = indents_.back();
-
-        if (spaces > currentIndent)
-        {
-            indents_.push_back(spaces);
-            pending_.push_back(make_(TokenType::TOKEN_INDENT));
-        }
-        else if (spaces < currentIndent)
+        std::lock_guard<std::mutex> lock(detail::traceMutex);
+        detail::traceOrigin.store(detail::Clock::now().time_since_epoch().count(), std::memory_order_release);
+        for (size_t i = 0; i < detail::traceBuffers.size(); ++i)
         {
-            while (indents_.size() > 1 && indents_.back() > spaces)
-            {
-                indents_.pop_back();
-                pending_.push_back(make_(TokenType::TOKEN_DEDENT));
-            }
-            // Verificar se o nível de indentação é válido
-            if (indents_.back() != spaces)
-            {
-                throw YamlException("Invalid indentation level", line_, col_);
-            }
+            std::lock_guard<std::mutex> bufferLock(detail::traceBuffers[i]->mutex);
+            detail::traceBuffers[i]->events.clear();
         }
+        detail::traceActive.store(true, std::memory_order_release);
     }
 
-    bool Scanner::isSpace_(char c)
+    void Trace::stop()
     {
-        return c == ' ' || c == '\t' || c == '\r';
+        std::lock_guard<std::mutex> lock(detail::traceMutex);
+        detail::traceActive.store(false, std::memory_order_release);
+        // Wait out appends already past their first check
+        for (size_t i = 0; i < detail::traceBuffers.size(); ++i)
+            std::lock_guard<std::mutex> bufferLock(detail::traceBuffers[i]->mutex);
     }
 
-    bool Scanner::isDigit_(char c)
+    bool Trace::active()
     {
-        return c >= '0' && c <= '9';
+        return detail::traceActive.load(std::memory_order_acquire);
     }
 
-    bool Scanner::isAlpha_(char c)
+    size_t Trace::eventCount()
     {
-        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        std::lock_guard<std::mutex> lock(detail::traceMutex);
+        size_t n = 0;
+        for (size_t i = 0; i < detail::traceBuffers.size(); ++i)
+        {
+            std::lock_guard<std::mutex> bufferLock(detail::traceBuffers[i]->mutex);
+            n += detail::traceBuffers[i]->events.size();
+        }
+        return n;
     }
 
-    bool Scanner::isAlnum_(char c)
+    std::string Trace::json()
     {
-        return isAlpha_(c) || isDigit_(c);
+        std::lock_guard<std::mutex> lock(detail::traceMutex);
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(3);
+        oss << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool first = true;
+        for (size_t i = 0; i < detail::traceBuffers.size(); ++i)
+        {
+            detail::TraceBuffer &buffer = *detail::traceBuffers[i];
+            std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+            if (buffer.events.empty())
+                continue;
+            oss << (first ? "\n" : ",\n");
+            first = false;
+            oss << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.tid
+                << ", \"args\": {\"name\": \"yaml thread " << buffer.tid << "\"}}";
+            for (size_t j = 0; j < buffer.events.size(); ++j)
+            {
+                const detail::TraceEvent &e = buffer.events[j];
+                oss << ",\n{\"name\": ";
+                detail::writeTraceString(oss, e.name);
+                if (e.asyncId)
+                    oss << ", \"cat\": \"yaml\", \"ph\": \"b\", \"id\": " << e.asyncId;
+                else
+                    oss << ", \"cat\": \"yaml\", \"ph\": \"X\", \"dur\": " << e.durationUs;
+                oss << ", \"pid\": 1, \"tid\": " << buffer.tid << ", \"ts\": " << e.startUs << ", \"args\": {";
+                if (!e.detail.empty())
+                {
+                    oss << "\"detail\": ";
+                    detail::writeTraceString(oss, e.detail);
+                    if (!e.args.empty())
+                        oss << ", ";
+                }
+                oss << e.args << "}}";
+                if (e.asyncId)
+                {
+                    oss << ",\n{\"name\": ";
+                    detail::writeTraceString(oss, e.name);
+                    oss << ", \"cat\": \"yaml\", \"ph\": \"e\", \"id\": " << e.asyncId << ", \"pid\": 1, \"tid\": "
+                        << buffer.tid << ", \"ts\": " << e.startUs + e.durationUs << "}";
+                }
+            }
+        }
+        oss << "\n]}\n";
+        return oss.str();
     }
 
-    Token Scanner::make_(TokenType t, const std::string &v)
+    bool Trace::writeJson(const std::string &path)
     {
-        return Token(t, v, line_, col_, 0);
+        std::ofstream out(path.c_str(), std::ios::out | std::ios::binary);
+        if (!out)
+            return false;
+        out << json();
+        return static_cast<bool>(out);
     }
 
-    int Scanner::countSpaces_(const std::string &s, size_t pos, size_t &outPos)
+    TraceSpan::TraceSpan(const char *name, const std::string &detail)
+        : name_(name), recording_(Trace::active())
     {
-        int spaces = 0;
-        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t'))
+        if (recording_)
         {
-            spaces += (s[pos] == ' ') ? 1 : 8;
-            pos++;
+            detail_ = detail;
+            start_ = std::chrono::steady_clock::now();
         }
-        outPos = pos;
-        return spaces;
     }
 
+    TraceSpan::~TraceSpan()
+    {
+        if (recording_)
+            detail::traceComplete(name_, detail_, start_, std::chrono::steady_clock::now());
+    }
+#endif
+
+#ifdef YAML_ACCESS_PROFILE
     // ============================================================================
-    // Parser Implementation
+    // Access Profiling
     // ============================================================================
 
-    Parser::Parser(const std::string &src) : sc_(src)
+    namespace detail
     {
-        advance_(); // Load first token
-        advance_(); // Load second token (lookahead)
+        // Lookups per (container, key); sequence indices are stored in decimal
+        struct AccessTable
+        {
+            std::map<std::pair<const YamlValue *, std::string>, uint64_t> hits;
+            uint64_t total;
 
-        // Debug: imprimir os primeiros tokens
-        /*
-        std::cout << "First token: " << static_cast<int>(cur_.type) << " = '" << cur_.value << "'" << std::endl;
-        std::cout << "Second token: " << static_cast<int>(nxt_.type) << " = '" << nxt_.value << "'" << std::endl;
-        */
-    }
+            AccessTable() : total(0) {}
+        };
 
-    YamlValue Parser::parse()
-    {
-        while (cur_.type == TokenType::TOKEN_NEWLINE || cur_.type == TokenType::TOKEN_INDENT)
+        // Counts of one thread for one profile. Only the owning thread adds,
+        // under mutex, which reports, clear() and stop() take to read, reset
+        // and quiesce it, so recording threads never wait on each other.
+        struct AccessShard : AccessTable
         {
-            advance_();
-        }
+            std::mutex mutex;
+        };
 
-        if (cur_.type == TokenType::TOKEN_EOF)
+        struct AccessCounts
         {
-            return YamlValue(); // Documento vazio
-        }
+            uint64_t id; // unique per profile, so a thread notices a new one
+            std::vector<std::shared_ptr<AccessShard>> shards;
 
-        return parseValue_();
-    }
+            AccessCounts();
+        };
 
-    void Parser::advance_()
-    {
-        cur_ = nxt_;
-        nxt_ = sc_.next();
-    }
+        // accessMutex guards activeAccess and the shard lists; lookups only
+        // read activeAccessId (0: nothing records) and lock their own shard
+        std::mutex accessMutex;
+        AccessCounts *activeAccess = nullptr;
+        std::atomic<uint64_t> activeAccessId(0);
+        std::atomic<uint64_t> nextAccessId(0);
 
-    bool Parser::match_(TokenType t)
-    {
-        if (cur_.type == t)
+        AccessCounts::AccessCounts() : id(++nextAccessId) {}
+
+        thread_local uint64_t accessShardId = 0;
+        thread_local std::shared_ptr<AccessShard> accessShard;
+
+        // Registers this thread's shard with the profile recording as id
+        bool joinAccessProfile(uint64_t id)
         {
-            advance_();
+            std::lock_guard<std::mutex> lock(accessMutex);
+            if (!activeAccess || activeAccess->id != id)
+                return false;
+            accessShard = std::make_shared<AccessShard>();
+            accessShardId = id;
+            activeAccess->shards.push_back(accessShard);
             return true;
         }
-        return false;
-    }
 
-    void Parser::expect_(TokenType t, const char *msg)
-    {
-        if (!match_(t))
+        void recordAccess(const YamlValue *node, const char *key, size_t length)
         {
-            throw YamlException(msg, cur_.line, cur_.column);
+            uint64_t id = activeAccessId.load(std::memory_order_acquire);
+            if (!id || (id != accessShardId && !joinAccessProfile(id)))
+                return;
+            AccessShard &shard = *accessShard;
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            // Checked again under the lock: stop() holds it to quiesce the shard
+            if (activeAccessId.load(std::memory_order_acquire) != id)
+                return;
+            shard.hits[std::make_pair(node, std::string(key, length))]++;
+            shard.total++;
         }
-    }
 
-    YamlValue Parser::parseValue_()
-    {
-        // Skip newlines
-        while (cur_.type == TokenType::TOKEN_NEWLINE)
+        void recordAccess(const YamlValue *node, size_t index)
         {
-            advance_();
+            if (activeAccessId.load(std::memory_order_relaxed))
+            {
+                std::string key = std::to_string(index);
+                recordAccess(node, key.data(), key.size());
+            }
         }
 
-        switch (cur_.type)
+        // Every thread's counts summed; call with accessMutex held
+        AccessTable mergeAccess(const AccessCounts &counts)
         {
-        case TokenType::TOKEN_LBRACE:
-            return parseFlowMap_();
-        case TokenType::TOKEN_LBRACKET:
-            return parseFlowSeq_();
-        case TokenType::TOKEN_DASH:
-            return parseSequence_();
-        case TokenType::TOKEN_INDENT:
-            advance_(); // consume indent
-            return parseValue_();
-        default:
-            if (cur_.type == TokenType::TOKEN_STRING && nxt_.type == TokenType::TOKEN_COLON)
+            AccessTable merged;
+            for (size_t i = 0; i < counts.shards.size(); ++i)
             {
-                return parseMapping_();
+                AccessShard &shard = *counts.shards[i];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (const auto &hit : shard.hits)
+                    merged.hits[hit.first] += hit.second;
+                merged.total += shard.total;
             }
-            return parseScalar_();
+            return merged;
         }
-    }
-
-    YamlValue Parser::parseFlowSeq_()
-    {
-        expect_(TokenType::TOKEN_LBRACKET, "Expected '['");
 
-        YamlValue::Sequence seq;
+        typedef std::map<std::pair<const YamlValue *, std::string>, uint64_t>::const_iterator HitIter;
 
-        while (cur_.type != TokenType::TOKEN_RBRACKET && cur_.type != TokenType::TOKEN_EOF)
+        // Child reached from node by a recorded key, or nullptr if absent
+        const YamlValue *accessChild(const YamlValue &node, const std::string &key)
         {
-            seq.push_back(parseValue_());
-
-            if (cur_.type == TokenType::TOKEN_COMMA)
+            if (node.isMapping())
             {
-                advance_();
+                const YamlValue::Mapping &map = node.asMapping();
+                YamlValue::Mapping::const_iterator it = map.find(key);
+                return it == map.end() ? nullptr : &it->second;
             }
-            else if (cur_.type != TokenType::TOKEN_RBRACKET)
+            if (node.isSequence() && !key.empty() && key.find_first_not_of("0123456789") == std::string::npos)
             {
-                break;
+                const YamlValue::Sequence &seq = node.asSequence();
+                size_t index = std::strtoul(key.c_str(), nullptr, 10);
+                return index < seq.size() ? &seq[index] : nullptr;
             }
+            return nullptr;
         }
 
-        expect_(TokenType::TOKEN_RBRACKET, "Expected ']'");
-        return YamlValue(seq);
-    }
+        uint64_t edgeHits(const AccessTable &counts, const YamlValue *node, const std::string &key)
+        {
+            HitIter it = counts.hits.find(std::make_pair(node, key));
+            return it == counts.hits.end() ? 0 : it->second;
+        }
 
-    YamlValue Parser::parseFlowMap_()
-    {
-        expect_(TokenType::TOKEN_LBRACE, "Expected '{'");
+        // Lookups made anywhere below each container, keyed by address
+        uint64_t subtreeHits(const AccessTable &counts, const YamlValue &node,
+                             std::map<const YamlValue *, uint64_t> &out)
+        {
+            uint64_t sum = 0;
+            if (node.isMapping())
+            {
+                for (const auto &pair : node.asMapping())
+                    sum += edgeHits(counts, &node, pair.first) + subtreeHits(counts, pair.second, out);
+            }
+            else if (node.isSequence())
+            {
+                const YamlValue::Sequence &seq = node.asSequence();
+                for (size_t i = 0; i < seq.size(); ++i)
+                    sum += edgeHits(counts, &node, std::to_string(i)) + subtreeHits(counts, seq[i], out);
+            }
+            else
+                return 0;
+            out[&node] = sum;
+            return sum;
+        }
 
-        YamlValue::Mapping map;
+        uint64_t subtreeOf(const std::map<const YamlValue *, uint64_t> &subtree, const YamlValue *node)
+        {
+            std::map<const YamlValue *, uint64_t>::const_iterator it = subtree.find(node);
+            return it == subtree.end() ? 0 : it->second;
+        }
 
-        while (cur_.type != TokenType::TOKEN_RBRACE && cur_.type != TokenType::TOKEN_EOF)
+        void collectHits(const AccessTable &counts, const YamlValue &node,
+                         const std::map<const YamlValue *, uint64_t> &subtree,
+                         std::vector<PathStep> &steps, std::vector<PathHits> &out)
         {
-            if (cur_.type != TokenType::TOKEN_STRING)
+            HitIter it = counts.hits.lower_bound(std::make_pair(&node, std::string()));
+            for (; it != counts.hits.end() && it->first.first == &node; ++it)
             {
-                throw YamlException("Expected string key in mapping", cur_.line, cur_.column);
+                const std::string &key = it->first.second;
+                PathStep step;
+                if (node.isSequence())
+                {
+                    step.isIndex = true;
+                    step.index = std::strtoul(key.c_str(), nullptr, 10);
+                }
+                else
+                    step.key = key;
+                steps.push_back(step);
+
+                const YamlValue *child = accessChild(node, key);
+                PathHits entry;
+                entry.steps = steps;
+                entry.hits = it->second;
+                entry.subtree = it->second + subtreeOf(subtree, child);
+                entry.present = child != nullptr;
+                out.push_back(entry);
+                if (child)
+                    collectHits(counts, *child, subtree, steps, out);
+                steps.pop_back();
             }
 
-            std::string key = cur_.value;
-            advance_();
-
-            expect_(TokenType::TOKEN_COLON, "Expected ':' after key");
+            // Containers only iterated over, with lookups further down
+            if (node.isMapping())
+            {
+                for (const auto &pair : node.asMapping())
+                {
+                    if (counts.hits.count(std::make_pair(&node, pair.first)) || !subtreeOf(subtree, &pair.second))
+                        continue;
+                    PathStep step;
+                    step.key = pair.first;
+                    steps.push_back(step);
+                    PathHits entry;
+                    entry.steps = steps;
+                    entry.subtree = subtreeOf(subtree, &pair.second);
+                    out.push_back(entry);
+                    collectHits(counts, pair.second, subtree, steps, out);
+                    steps.pop_back();
+                }
+            }
+            else if (node.isSequence())
+            {
+                const YamlValue::Sequence &seq = node.asSequence();
+                for (size_t i = 0; i < seq.size(); ++i)
+                {
+                    if (counts.hits.count(std::make_pair(&node, std::to_string(i))) || !subtreeOf(subtree, &seq[i]))
+                        continue;
+                    PathStep step;
+                    step.isIndex = true;
+                    step.index = i;
+                    steps.push_back(step);
+                    PathHits entry;
+                    entry.steps = steps;
+                    entry.subtree = subtreeOf(subtree, &seq[i]);
+                    out.push_back(entry);
+                    collectHits(counts, seq[i], subtree, steps, out);
+                    steps.pop_back();
+                }
+            }
+        }
 
-            map[key] = parseValue_();
+        std::string formatPath(const std::vector<PathStep> &steps)
+        {
+            std::string path;
+            for (size_t i = 0; i < steps.size(); ++i)
+            {
+                if (steps[i].isIndex)
+                    path += "[" + std::to_string(steps[i].index) + "]";
+                else
+                    path += (i ? "." : "") + steps[i].key;
+            }
+            return path;
+        }
 
-            if (cur_.type == TokenType::TOKEN_COMMA)
+        // Copies node visiting children by descending weight; each child is
+        // built right after the container slot that holds it is allocated
+        YamlValue relayoutNode(const AccessTable &counts, const YamlValue &node,
+                               const std::map<const YamlValue *, uint64_t> &subtree)
+        {
+            if (node.isMapping())
             {
-                advance_();
+                std::vector<std::pair<uint64_t, YamlValue::Mapping::const_iterator>> order;
+                const YamlValue::Mapping &map = node.asMapping();
+                for (YamlValue::Mapping::const_iterator it = map.begin(); it != map.end(); ++it)
+                    order.push_back(std::make_pair(edgeHits(counts, &node, it->first) + subtreeOf(subtree, &it->second), it));
+                std::stable_sort(order.begin(), order.end(),
+                                 [](const std::pair<uint64_t, YamlValue::Mapping::const_iterator> &a,
+                                    const std::pair<uint64_t, YamlValue::Mapping::const_iterator> &b) { return a.first > b.first; });
+
+                YamlValue out{YamlValue::Mapping()};
+                YamlValue::Mapping &into = out.asMapping();
+                for (size_t i = 0; i < order.size(); ++i)
+                {
+                    YamlValue &slot = into[order[i].second->first];
+                    slot = relayoutNode(counts, order[i].second->second, subtree);
+                }
+                return out;
             }
-            else if (cur_.type != TokenType::TOKEN_RBRACE)
+            if (node.isSequence())
             {
-                break;
+                const YamlValue::Sequence &seq = node.asSequence();
+                std::vector<std::pair<uint64_t, size_t>> order;
+                for (size_t i = 0; i < seq.size(); ++i)
+                    order.push_back(std::make_pair(edgeHits(counts, &node, std::to_string(i)) + subtreeOf(subtree, &seq[i]), i));
+                std::stable_sort(order.begin(), order.end(),
+                                 [](const std::pair<uint64_t, size_t> &a, const std::pair<uint64_t, size_t> &b) {
+                                     return a.first > b.first;
+                                 });
+
+                YamlValue::Sequence into;
+                into.resize(seq.size());
+                for (size_t i = 0; i < order.size(); ++i)
+                    into[order[i].second] = relayoutNode(counts, seq[order[i].second], subtree);
+                return YamlValue(std::move(into));
             }
+            return node;
         }
+    }
 
-        expect_(TokenType::TOKEN_RBRACE, "Expected '}'");
-        return YamlValue(map);
+    AccessProfile::AccessProfile() : counts_(new detail::AccessCounts()) {}
+
+    AccessProfile::~AccessProfile()
+    {
+        stop();
     }
 
-    YamlValue Parser::parseScalar_()
+    void AccessProfile::start()
     {
-        switch (cur_.type)
-        {
-        case TokenType::TOKEN_NULL:
-            advance_();
-            return YamlValue();
-        case TokenType::TOKEN_BOOLEAN:
+        std::lock_guard<std::mutex> lock(detail::accessMutex);
+        detail::activeAccess = counts_.get();
+        detail::activeAccessId.store(counts_->id, std::memory_order_release);
+    }
+
+    void AccessProfile::stop()
+    {
+        std::lock_guard<std::mutex> lock(detail::accessMutex);
+        if (detail::activeAccess != counts_.get())
+            return;
+        detail::activeAccess = nullptr;
+        detail::activeAccessId.store(0, std::memory_order_release);
+        // Wait out lookups already past their first check
+        for (size_t i = 0; i < counts_->shards.size(); ++i)
+            std::lock_guard<std::mutex> shardLock(counts_->shards[i]->mutex);
+    }
+
+    bool AccessProfile::recording() const
+    {
+        return detail::activeAccessId.load(std::memory_order_acquire) == counts_->id;
+    }
+
+    void AccessProfile::clear()
+    {
+        std::lock_guard<std::mutex> lock(detail::accessMutex);
+        for (size_t i = 0; i < counts_->shards.size(); ++i)
         {
-            bool val = (cur_.value == "true");
-            advance_();
-            return YamlValue(val);
+            detail::AccessShard &shard = *counts_->shards[i];
+            std::lock_guard<std::mutex> shardLock(shard.mutex);
+            shard.hits.clear();
+            shard.total = 0;
         }
-        case TokenType::TOKEN_NUMBER:
+    }
+
+    uint64_t AccessProfile::totalHits() const
+    {
+        std::lock_guard<std::mutex> lock(detail::accessMutex);
+        uint64_t total = 0;
+        for (size_t i = 0; i < counts_->shards.size(); ++i)
         {
-            double val = std::stod(cur_.value);
-            advance_();
-            return YamlValue(val);
+            std::lock_guard<std::mutex> shardLock(counts_->shards[i]->mutex);
+            total += counts_->shards[i]->total;
         }
-        case TokenType::TOKEN_STRING:
+        return total;
+    }
+
+    std::vector<PathHits> AccessProfile::hottest(const YamlValue &root, size_t limit) const
+    {
+        detail::AccessTable counts;
         {
-            std::string val = cur_.value;
-            advance_();
-            return YamlValue(val);
-        }
-        case TokenType::TOKEN_DEDENT:
-            // Se chegamos aqui com DEDENT, significa que não há valor
-            throw YamlException("Missing value after key", cur_.line, cur_.column);
-        default:
-            throw YamlException("Expected scalar value", cur_.line, cur_.column);
+            std::lock_guard<std::mutex> lock(detail::accessMutex);
+            counts = detail::mergeAccess(*counts_);
         }
+        std::map<const YamlValue *, uint64_t> subtree;
+        detail::subtreeHits(counts, root, subtree);
+
+        std::vector<PathHits> out;
+        std::vector<PathStep> steps;
+        detail::collectHits(counts, root, subtree, steps, out);
+        for (size_t i = 0; i < out.size(); ++i)
+            out[i].path = detail::formatPath(out[i].steps);
+
+        std::stable_sort(out.begin(), out.end(), [](const PathHits &a, const PathHits &b) {
+            if (a.hits != b.hits)
+                return a.hits > b.hits;
+            return a.subtree > b.subtree;
+        });
+        if (limit && out.size() > limit)
+            out.resize(limit);
+        return out;
     }
-    YamlValue Parser::parseMapping_()
-    {
-        YamlValue::Mapping map;
 
-        while (cur_.type == TokenType::TOKEN_STRING && nxt_.type == TokenType::TOKEN_COLON)
+    YamlValue AccessProfile::relayout(const YamlValue &root) const
+    {
+        detail::AccessTable counts;
         {
-            std::string key = cur_.value;
-            advance_(); // consume key
-            advance_(); // consume colon
+            std::lock_guard<std::mutex> lock(detail::accessMutex);
+            counts = detail::mergeAccess(*counts_);
+        }
+        std::map<const YamlValue *, uint64_t> subtree;
+        detail::subtreeHits(counts, root, subtree);
+        return detail::relayoutNode(counts, root, subtree);
+    }
+#endif
 
-            // Skip newlines após colon
-            while (cur_.type == TokenType::TOKEN_NEWLINE)
-            {
-                advance_();
-            }
+#ifdef YAML_ALLOC_STATS
+    // ============================================================================
+    // Allocation Accounting
+    // ============================================================================
 
-            map[key] = parseValue_();
+    namespace detail
+    {
+        struct AllocCells
+        {
+            std::atomic<uint64_t> allocations;
+            std::atomic<uint64_t> frees;
+            std::atomic<uint64_t> bytes;
+            std::atomic<uint64_t> freedBytes;
+        };
 
-            // Skip newlines entre entries
-            while (cur_.type == TokenType::TOKEN_NEWLINE)
-            {
-                advance_();
-            }
+        // Static storage: zeroed before any operator new can run
+        AllocCells allocCells[AllocStats::PHASES];
+        thread_local int allocPhase = 0;
 
-            // Consumir DEDENTs
-            while (cur_.type == TokenType::TOKEN_DEDENT)
-            {
-                advance_();
-            }
+        // Every block carries its size and phase ahead of the user pointer
+        struct AllocHeader
+        {
+            size_t size;
+            int phase;
+        };
+        const size_t ALLOC_HEADER_SIZE =
+            (sizeof(AllocHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) *
+            alignof(std::max_align_t);
 
-            // Check se ainda há mais pares key:value
-            if (!(cur_.type == TokenType::TOKEN_STRING && nxt_.type == TokenType::TOKEN_COLON))
-            {
-                break;
-            }
+        void *countedAlloc(size_t size)
+        {
+            char *raw = static_cast<char *>(std::malloc(ALLOC_HEADER_SIZE + size));
+            if (!raw)
+                return nullptr;
+            int phase = allocPhase;
+            AllocHeader *header = reinterpret_cast<AllocHeader *>(raw);
+            header->size = size;
+            header->phase = phase;
+            allocCells[phase].allocations.fetch_add(1, std::memory_order_relaxed);
+            allocCells[phase].bytes.fetch_add(size, std::memory_order_relaxed);
+            return raw + ALLOC_HEADER_SIZE;
         }
 
-        return YamlValue(map);
+        void countedFree(void *p)
+        {
+            if (!p)
+                return;
+            char *raw = static_cast<char *>(p) - ALLOC_HEADER_SIZE;
+            AllocHeader *header = reinterpret_cast<AllocHeader *>(raw);
+            allocCells[header->phase].frees.fetch_add(1, std::memory_order_relaxed);
+            allocCells[header->phase].freedBytes.fetch_add(header->size, std::memory_order_relaxed);
+            std::free(raw);
+        }
     }
-    YamlValue Parser::parseSequence_()
+
+    AllocStats AllocStats::capture()
     {
-        YamlValue::Sequence seq;
+        AllocStats stats;
+        for (int i = 0; i < PHASES; ++i)
+        {
+            const detail::AllocCells &cells = detail::allocCells[i];
+            stats.phases[i].allocations = cells.allocations.load(std::memory_order_relaxed);
+            stats.phases[i].frees = cells.frees.load(std::memory_order_relaxed);
+            stats.phases[i].bytes = cells.bytes.load(std::memory_order_relaxed);
+            stats.phases[i].freedBytes = cells.freedBytes.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
 
-        while (cur_.type == TokenType::TOKEN_DASH)
+    void AllocStats::reset()
+    {
+        for (int i = 0; i < PHASES; ++i)
         {
-            advance_(); // consume dash
-            seq.push_back(parseValue_());
+            detail::AllocCells &cells = detail::allocCells[i];
+            cells.allocations.store(0, std::memory_order_relaxed);
+            cells.frees.store(0, std::memory_order_relaxed);
+            cells.bytes.store(0, std::memory_order_relaxed);
+            cells.freedBytes.store(0, std::memory_order_relaxed);
+        }
+    }
 
-            // Skip newlines
-            while (cur_.type == TokenType::TOKEN_NEWLINE)
-            {
-                advance_();
-            }
+    AllocCounters AllocStats::total() const
+    {
+        AllocCounters sum;
+        for (int i = 0; i < PHASES; ++i)
+        {
+            sum.allocations += phases[i].allocations;
+            sum.frees += phases[i].frees;
+            sum.bytes += phases[i].bytes;
+            sum.freedBytes += phases[i].freedBytes;
+        }
+        return sum;
+    }
 
-            // Se não há mais dashes, parar
-            if (cur_.type != TokenType::TOKEN_DASH)
-            {
-                break;
-            }
+    AllocStats AllocStats::operator-(const AllocStats &before) const
+    {
+        AllocStats delta;
+        for (int i = 0; i < PHASES; ++i)
+        {
+            delta.phases[i].allocations = phases[i].allocations - before.phases[i].allocations;
+            delta.phases[i].frees = phases[i].frees - before.phases[i].frees;
+            delta.phases[i].bytes = phases[i].bytes - before.phases[i].bytes;
+            delta.phases[i].freedBytes = phases[i].freedBytes - before.phases[i].freedBytes;
         }
+        return delta;
+    }
+
+    AllocScope::AllocScope(AllocPhase phase)
+        : previous_(static_cast<AllocPhase>(detail::allocPhase))
+    {
+        detail::allocPhase = static_cast<int>(phase);
+    }
 
-        return YamlValue(seq);
+    AllocScope::~AllocScope()
+    {
+        detail::allocPhase = static_cast<int>(previous_);
     }
+#endif
+
+    template class BasicScanner<DefaultPolicy>;
+    template class BasicParser<DefaultPolicy>;
+    template class BasicScanner<CompactPolicy>;
+    template class BasicParser<CompactPolicy>;
+    template class BasicScanner<StrictPolicy>;
+    template class BasicParser<StrictPolicy>;
 
 } // namespace yaml
 
+#ifdef YAML_ALLOC_STATS
+// Replacement global allocation functions; every form routes through the
+// counting pair so any new/delete combination stays consistent
+void *operator new(std::size_t size)
+{
+    void *p = yaml::detail::countedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    void *p = yaml::detail::countedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return yaml::detail::countedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return yaml::detail::countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept { yaml::detail::countedFree(p); }
+void operator delete[](void *p) noexcept { yaml::detail::countedFree(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { yaml::detail::countedFree(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { yaml::detail::countedFree(p); }
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, std::size_t) noexcept { yaml::detail::countedFree(p); }
+void operator delete[](void *p, std::size_t) noexcept { yaml::detail::countedFree(p); }
+#endif
+#endif
+
 #endif // YAML_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,325 @@
+// Scanner-only throughput: runs Scanner::next over whole inputs with no
+// Parser and no YamlValue construction.
+//
+//   make tokbench
+//   ./yaml_tokbench [--reps N] [--min-ms N] [--no-breakdown] [files...]
+//   ./yaml_tokbench --dump file.yaml
+//
+// Without files a built-in sample mixing plain and quoted scalars, comments,
+// flow collections and deep indentation is scanned.
+//
+// The breakdown pass times every next() call and charges it, with the bytes
+// it consumed, to the type of the token it returned. Work that produces no
+// token of its own (comments, blank lines, indentation) is charged to the
+// token that follows it: comment-heavy input shows up as NEWLINE bytes,
+// deep indentation under the first token of each line.
+
+#include "yaml.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *tokenName(yaml::TokenType t)
+{
+    switch (t)
+    {
+    case yaml::TokenType::TOKEN_STRING:
+        return "STRING";
+    case yaml::TokenType::TOKEN_NUMBER:
+        return "NUMBER";
+    case yaml::TokenType::TOKEN_BOOLEAN:
+        return "BOOLEAN";
+    case yaml::TokenType::TOKEN_NULL:
+        return "NULL";
+    case yaml::TokenType::TOKEN_COLON:
+        return "COLON";
+    case yaml::TokenType::TOKEN_DASH:
+        return "DASH";
+    case yaml::TokenType::TOKEN_COMMA:
+        return "COMMA";
+    case yaml::TokenType::TOKEN_NEWLINE:
+        return "NEWLINE";
+    case yaml::TokenType::TOKEN_LBRACKET:
+        return "LBRACKET";
+    case yaml::TokenType::TOKEN_RBRACKET:
+        return "RBRACKET";
+    case yaml::TokenType::TOKEN_LBRACE:
+        return "LBRACE";
+    case yaml::TokenType::TOKEN_RBRACE:
+        return "RBRACE";
+    case yaml::TokenType::TOKEN_PIPE:
+        return "PIPE";
+    case yaml::TokenType::TOKEN_FOLD:
+        return "FOLD";
+    case yaml::TokenType::TOKEN_ANCHOR:
+        return "ANCHOR";
+    case yaml::TokenType::TOKEN_ALIAS:
+        return "ALIAS";
+    case yaml::TokenType::TOKEN_EOF:
+        return "EOF";
+    case yaml::TokenType::TOKEN_ERROR:
+        return "ERROR";
+    case yaml::TokenType::TOKEN_TAG:
+        return "TAG";
+    }
+    return "?";
+}
+
+static const int TOKEN_TYPES = yaml::ParseStats::TOKEN_TYPES;
+
+// ====================================================================================
+// Inputs
+// ====================================================================================
+
+struct Input
+{
+    std::string name;
+    std::string text;
+};
+
+static bool readFile(const std::string &path, std::string &out)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+static std::string builtinSample()
+{
+    std::string s;
+    char line[160];
+    for (int block = 0; s.size() < 256 * 1024; ++block)
+    {
+        std::snprintf(line, sizeof(line), "# service %d: generated entry for the scanner benchmark\n", block);
+        s += line;
+        std::snprintf(line, sizeof(line), "service_%d:\n", block);
+        s += line;
+        s += "  name: plain scalar with several words\n";
+        s += "  quoted: \"escaped \\\"text\\\" with \\t tabs and \\n newlines\"\n";
+        s += "  single: 'single quoted value'\n";
+        s += "  replicas: 3\n  ratio: 0.75\n  enabled: true\n  owner: null  # trailing comment\n";
+        s += "  tags: [web, api, \"edge\", 42]\n";
+        s += "  limits: {cpu: 500, memory: 256, burst: false}\n";
+        s += "  ports:\n    - 80\n    - 443\n";
+        s += "  deep:\n";
+        for (int d = 2; d < 12; ++d)
+            s += std::string(d * 2, ' ') + "level:\n";
+        s += std::string(24, ' ') + "leaf: value\n";
+    }
+    return s;
+}
+
+// ====================================================================================
+// Measurement
+// ====================================================================================
+
+static size_t scanAll(const std::string &text)
+{
+    yaml::Scanner sc(text);
+    size_t count = 0;
+    for (;;)
+    {
+        yaml::Token t = sc.next();
+        ++count;
+        if (t.type == yaml::TokenType::TOKEN_EOF)
+            break;
+    }
+    return count;
+}
+
+// Best per-scan time in ns over reps, each repeating for at least minMs
+static double timeScan(const std::string &text, int reps, double minMs, size_t &tokens)
+{
+    double best = 1e300;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+        size_t iterations = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed;
+        do
+        {
+            tokens = scanAll(text);
+            ++iterations;
+            elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        } while (elapsed < minMs * 1e6);
+        best = std::min(best, elapsed / iterations);
+    }
+    return best;
+}
+
+// Cost of one Clock::now() pair, subtracted from each timed next() call
+static double clockOverheadNs()
+{
+    const int n = 100000;
+    Clock::time_point start = Clock::now();
+    Clock::time_point last = start;
+    for (int i = 0; i < n; ++i)
+        last = Clock::now();
+    return std::chrono::duration<double, std::nano>(last - start).count() / n;
+}
+
+struct TypeCost
+{
+    size_t count;
+    size_t bytes;
+    double ns;
+
+    TypeCost() : count(0), bytes(0), ns(0) {}
+};
+
+static void breakdown(const std::string &text, double overhead, TypeCost costs[])
+{
+    yaml::Scanner sc(text);
+    for (;;)
+    {
+        size_t before = sc.offset();
+        Clock::time_point start = Clock::now();
+        yaml::Token t = sc.next();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() - overhead;
+        TypeCost &c = costs[static_cast<int>(t.type)];
+        c.count++;
+        c.bytes += sc.offset() - before;
+        c.ns += ns > 0 ? ns : 0;
+        if (t.type == yaml::TokenType::TOKEN_EOF)
+            break;
+    }
+}
+
+static void dump(const std::string &text)
+{
+    yaml::Scanner sc(text);
+    for (;;)
+    {
+        yaml::Token t = sc.next();
+        std::printf("%5d:%-4d %-9s", t.line, t.column, tokenName(t.type));
+        if (t.indent >= 0)
+            std::printf(" @%d", t.indent);
+        if (!t.value.empty())
+        {
+            std::string shown;
+            for (char c : t.value)
+            {
+                if (c == '\n')
+                    shown += "\\n";
+                else if (c == '\t')
+                    shown += "\\t";
+                else
+                    shown += c;
+            }
+            std::printf(" '%s'", shown.c_str());
+        }
+        std::printf("\n");
+        if (t.type == yaml::TokenType::TOKEN_EOF)
+            break;
+    }
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: yaml_tokbench [--reps N] [--min-ms N] [--no-breakdown] [files...]\n"
+                 "       yaml_tokbench --dump file...\n");
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 5;
+    double minMs = 50;
+    bool showBreakdown = true;
+    bool dumpOnly = false;
+    std::vector<Input> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--reps" && hasValue)
+            reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-ms" && hasValue)
+            minMs = std::atof(argv[++i]);
+        else if (arg == "--no-breakdown")
+            showBreakdown = false;
+        else if (arg == "--dump")
+            dumpOnly = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+        {
+            Input in;
+            in.name = arg;
+            if (!readFile(arg, in.text))
+            {
+                std::fprintf(stderr, "yaml_tokbench: cannot read %s\n", arg.c_str());
+                return 1;
+            }
+            inputs.push_back(in);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        if (dumpOnly)
+        {
+            usage();
+            return 2;
+        }
+        Input in;
+        in.name = "(built-in sample)";
+        in.text = builtinSample();
+        inputs.push_back(in);
+    }
+
+    if (dumpOnly)
+    {
+        for (const auto &in : inputs)
+            dump(in.text);
+        return 0;
+    }
+
+    double overhead = showBreakdown ? clockOverheadNs() : 0;
+    for (const auto &in : inputs)
+    {
+        size_t tokens = 0;
+        double ns = timeScan(in.text, reps, minMs, tokens);
+        double seconds = ns / 1e9;
+        std::printf("%s: %zu bytes, %zu tokens, %.3f ms/scan, %.1f MB/s, %.2f Mtokens/s, %.1f ns/token\n",
+                    in.name.c_str(), in.text.size(), tokens, ns / 1e6,
+                    in.text.size() / seconds / 1e6, tokens / seconds / 1e6, ns / tokens);
+
+        if (!showBreakdown)
+            continue;
+
+        TypeCost costs[TOKEN_TYPES];
+        breakdown(in.text, overhead, costs);
+        double totalNs = 0;
+        for (int i = 0; i < TOKEN_TYPES; ++i)
+            totalNs += costs[i].ns;
+
+        std::printf("  %-9s %10s %12s %8s %10s %8s\n", "token", "count", "bytes", "bytes/tk", "ns/token", "time %");
+        for (int i = 0; i < TOKEN_TYPES; ++i)
+        {
+            const TypeCost &c = costs[i];
+            if (!c.count)
+                continue;
+            std::printf("  %-9s %10zu %12zu %8.1f %10.1f %7.1f%%\n",
+                        tokenName(static_cast<yaml::TokenType>(i)), c.count, c.bytes,
+                        static_cast<double>(c.bytes) / c.count, c.ns / c.count,
+                        totalNs > 0 ? 100.0 * c.ns / totalNs : 0.0);
+        }
+    }
+    return 0;
+}